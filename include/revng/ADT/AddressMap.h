@@ -0,0 +1,260 @@
+#ifndef ADDRESSMAP_H
+#define ADDRESSMAP_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/iterator.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+
+/// \brief Compact map from addresses to values
+///
+/// The entries are stored in a flat vector, while a hash table maps each
+/// address to its position in the vector. Lookups, insertions and removals
+/// take constant time.
+///
+/// Removing an entry leaves a tombstone in the vector, which is skipped while
+/// iterating over the map. The tombstones are dropped, preserving the order of
+/// the other entries, when they outnumber the entries or upon sort().
+///
+/// Iterating over the map visits the entries in the order of the vector, which
+/// is the ascending address order as long as the entries are inserted in
+/// ascending order, which is the common case. Otherwise, sort() restores it.
+/// Iterating never modifies the map: only insertions, removals and sort()
+/// invalidate the iterators and the references to the entries.
+///
+/// The two highest addresses are reserved.
+template<typename T>
+class AddressMap {
+public:
+  using key_type = uint64_t;
+  using mapped_type = T;
+  using value_type = std::pair<uint64_t, T>;
+
+private:
+  using Container = std::vector<value_type>;
+  using KeyInfo = llvm::DenseMapInfo<uint64_t>;
+
+  /// \brief Iterator over the entries of the vector that skips tombstones
+  template<typename WrappedIterator>
+  class EntryIterator
+    : public llvm::iterator_adaptor_base<EntryIterator<WrappedIterator>,
+                                         WrappedIterator,
+                                         std::forward_iterator_tag> {
+  private:
+    using Base = llvm::iterator_adaptor_base<EntryIterator<WrappedIterator>,
+                                             WrappedIterator,
+                                             std::forward_iterator_tag>;
+
+  public:
+    EntryIterator() = default;
+
+    EntryIterator(WrappedIterator It, WrappedIterator End) :
+      Base(It),
+      End(End) {
+      skipTombstones();
+    }
+
+    /// \brief Allow the conversion from iterator to const_iterator
+    template<typename OtherIterator>
+    EntryIterator(const EntryIterator<OtherIterator> &Other) :
+      Base(Other.wrapped()),
+      End(Other.wrappedEnd()) {}
+
+    const WrappedIterator &wrapped() const { return this->I; }
+    const WrappedIterator &wrappedEnd() const { return End; }
+
+    using Base::operator++;
+    EntryIterator &operator++() {
+      ++this->I;
+      skipTombstones();
+      return *this;
+    }
+
+  private:
+    void skipTombstones() {
+      while (this->I != End and isTombstone(this->I->first))
+        ++this->I;
+    }
+
+  private:
+    WrappedIterator End;
+  };
+
+public:
+  using iterator = EntryIterator<typename Container::iterator>;
+  using const_iterator = EntryIterator<typename Container::const_iterator>;
+
+public:
+  AddressMap() : IsSorted(true) {}
+
+  bool empty() const { return Index.empty(); }
+  size_t size() const { return Index.size(); }
+
+  void reserve(size_t Size) {
+    Entries.reserve(Size);
+    Index.reserve(Size);
+  }
+
+  void clear() {
+    Entries.clear();
+    Index.clear();
+    IsSorted = true;
+  }
+
+  void swap(AddressMap &Other) {
+    Entries.swap(Other.Entries);
+    Index.swap(Other.Index);
+    std::swap(IsSorted, Other.IsSorted);
+  }
+
+  iterator begin() { return iterator(Entries.begin(), Entries.end()); }
+  iterator end() { return iterator(Entries.end(), Entries.end()); }
+
+  const_iterator begin() const {
+    return const_iterator(Entries.begin(), Entries.end());
+  }
+
+  const_iterator end() const {
+    return const_iterator(Entries.end(), Entries.end());
+  }
+
+  /// \brief Whether iterating visits the entries in ascending address order
+  bool isSorted() const { return IsSorted; }
+
+  /// \brief Drop the tombstones and sort the entries by address
+  void sort() {
+    compact();
+
+    if (IsSorted)
+      return;
+
+    auto Compare = [](const value_type &A, const value_type &B) {
+      return A.first < B.first;
+    };
+    std::sort(Entries.begin(), Entries.end(), Compare);
+
+    for (size_t I = 0; I < Entries.size(); I++)
+      Index[Entries[I].first] = I;
+
+    IsSorted = true;
+  }
+
+  size_t count(uint64_t Address) const { return Index.count(Address); }
+
+  iterator find(uint64_t Address) {
+    auto It = Index.find(Address);
+    if (It == Index.end())
+      return end();
+    return iterator(Entries.begin() + It->second, Entries.end());
+  }
+
+  const_iterator find(uint64_t Address) const {
+    auto It = Index.find(Address);
+    if (It == Index.end())
+      return end();
+    return const_iterator(Entries.begin() + It->second, Entries.end());
+  }
+
+  T &at(uint64_t Address) {
+    auto It = find(Address);
+    revng_assert(It != end());
+    return It->second;
+  }
+
+  const T &at(uint64_t Address) const {
+    auto It = find(Address);
+    revng_assert(It != end());
+    return It->second;
+  }
+
+  T &operator[](uint64_t Address) {
+    return insert({ Address, T() }).first->second;
+  }
+
+  std::pair<iterator, bool> insert(value_type Entry) {
+    revng_assert(isValid(Entry.first));
+
+    auto It = Index.find(Entry.first);
+    if (It != Index.end())
+      return { iterator(Entries.begin() + It->second, Entries.end()), false };
+
+    if (Entries.size() - Index.size() > Index.size())
+      compact();
+
+    Index[Entry.first] = Entries.size();
+
+    // The last entry is never a tombstone
+    if (not Entries.empty() and Entries.back().first > Entry.first)
+      IsSorted = false;
+
+    Entries.push_back(std::move(Entry));
+    return { iterator(Entries.end() - 1, Entries.end()), true };
+  }
+
+  size_t erase(uint64_t Address) {
+    auto It = Index.find(Address);
+    if (It == Index.end())
+      return 0;
+
+    // Leave a tombstone, release the value right away
+    value_type &Entry = Entries[It->second];
+    Entry.first = KeyInfo::getTombstoneKey();
+    Entry.second = T();
+    Index.erase(It);
+
+    // Don't leave tombstones at the end
+    while (not Entries.empty() and isTombstone(Entries.back().first))
+      Entries.pop_back();
+
+    return 1;
+  }
+
+private:
+  static bool isTombstone(uint64_t Address) {
+    return Address == KeyInfo::getTombstoneKey();
+  }
+
+  static bool isValid(uint64_t Address) {
+    return Address != KeyInfo::getEmptyKey() and not isTombstone(Address);
+  }
+
+  /// \brief Drop the tombstones, preserving the order of the entries
+  void compact() {
+    if (Entries.size() == Index.size())
+      return;
+
+    size_t Last = 0;
+    for (size_t I = 0; I < Entries.size(); I++) {
+      if (isTombstone(Entries[I].first))
+        continue;
+
+      if (Last != I) {
+        Entries[Last] = std::move(Entries[I]);
+        Index[Entries[Last].first] = Last;
+      }
+      Last++;
+    }
+
+    Entries.erase(Entries.begin() + Last, Entries.end());
+  }
+
+private:
+  Container Entries;
+  llvm::DenseMap<uint64_t, size_t> Index;
+  bool IsSorted;
+};
+
+#endif // ADDRESSMAP_H
@@ -0,0 +1,158 @@
+#ifndef INTERVALINDEX_H
+#define INTERVALINDEX_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/ArrayRef.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+
+/// \brief Compact sorted index of half-open intervals of addresses
+///
+/// The intervals are identified by their position in the list used to build
+/// the index and are stored sorted by their start address, along with the
+/// highest end address seen up to each of them. This allows to answer queries
+/// with a binary search, and to handle overlapping intervals correctly,
+/// although the common case is a handful of disjoint intervals.
+///
+/// The index is immutable: build a new one if the intervals change.
+class IntervalIndex {
+public:
+  using Interval = std::pair<uint64_t, uint64_t>;
+  // An enumerator, unlike a static data member, can be bound to a reference
+  // (e.g., by BOOST_TEST) without an out-of-line definition
+  enum : unsigned { NotFound = std::numeric_limits<unsigned>::max() };
+
+private:
+  struct Entry {
+    Interval Range;
+    uint64_t MaxEnd; ///< Highest end address of this and the previous entries
+    unsigned ID;
+  };
+
+public:
+  IntervalIndex() {}
+
+  explicit IntervalIndex(llvm::ArrayRef<Interval> Intervals) {
+    Entries.reserve(Intervals.size());
+    unsigned ID = 0;
+    for (const Interval &I : Intervals) {
+      if (I.first < I.second)
+        Entries.push_back({ I, 0, ID });
+      ID++;
+    }
+
+    auto Compare = [](const Entry &A, const Entry &B) {
+      return A.Range.first < B.Range.first;
+    };
+    std::stable_sort(Entries.begin(), Entries.end(), Compare);
+
+    uint64_t MaxEnd = 0;
+    for (Entry &E : Entries) {
+      MaxEnd = std::max(MaxEnd, E.Range.second);
+      E.MaxEnd = MaxEnd;
+    }
+  }
+
+  /// \brief Merge overlapping and adjacent intervals
+  ///
+  /// \return the resulting disjoint intervals, sorted.
+  static std::vector<Interval> merge(std::vector<Interval> Intervals) {
+    std::sort(Intervals.begin(), Intervals.end());
+
+    std::vector<Interval> Result;
+    for (const Interval &I : Intervals) {
+      if (I.first >= I.second)
+        continue;
+
+      if (Result.size() != 0 and I.first <= Result.back().second)
+        Result.back().second = std::max(Result.back().second, I.second);
+      else
+        Result.push_back(I);
+    }
+
+    return Result;
+  }
+
+public:
+  bool empty() const { return Entries.empty(); }
+  size_t size() const { return Entries.size(); }
+
+  /// \brief Lowest address contained in an interval
+  uint64_t lowest() const {
+    revng_assert(not empty());
+    return Entries.front().Range.first;
+  }
+
+  /// \brief Address following the highest address contained in an interval
+  uint64_t highest() const {
+    revng_assert(not empty());
+    return Entries.back().MaxEnd;
+  }
+
+  /// \brief Get the sorted intervals
+  std::vector<Interval> intervals() const {
+    std::vector<Interval> Result;
+    Result.reserve(Entries.size());
+    for (const Entry &E : Entries)
+      Result.push_back(E.Range);
+    return Result;
+  }
+
+  /// \brief Find an interval containing \p Address
+  ///
+  /// \return the identifier of the interval, or NotFound. If multiple intervals
+  ///         contain \p Address, the one starting last is returned.
+  unsigned find(uint64_t Address) const {
+    return find(Address, Address);
+  }
+
+  /// \brief Find an interval containing both \p First and \p Last
+  ///
+  /// \return the identifier of the interval, or NotFound.
+  unsigned find(uint64_t First, uint64_t Last) const {
+    // Consider the entries starting at or before First, from the last one,
+    // until none of the remaining ones can reach First
+    auto It = std::upper_bound(Entries.begin(),
+                               Entries.end(),
+                               First,
+                               [](uint64_t Address, const Entry &E) {
+                                 return Address < E.Range.first;
+                               });
+
+    while (It != Entries.begin()) {
+      --It;
+      if (It->MaxEnd <= First)
+        break;
+
+      const Interval &Range = It->Range;
+      if (First < Range.second and Range.first <= Last and Last < Range.second)
+        return It->ID;
+    }
+
+    return NotFound;
+  }
+
+  bool contains(uint64_t Address) const { return find(Address) != NotFound; }
+
+  /// \brief Return true if \p First and \p Last are in the same interval
+  bool contains(uint64_t First, uint64_t Last) const {
+    return find(First, Last) != NotFound;
+  }
+
+private:
+  std::vector<Entry> Entries;
+};
+
+#endif // INTERVALINDEX_H
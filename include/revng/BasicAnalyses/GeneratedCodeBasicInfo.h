@@ -11,6 +11,7 @@
 #include <utility>
 
 // LLVM includes
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Casting.h"
 
@@ -28,6 +29,9 @@ class MDNode;
 
 static const char *BlockTypeMDName = "revng.block.type";
 static const char *JTReasonMDName = "revng.jt.reasons";
+static const char *JTReasonMaskMDName = "revng.jt.reasons.mask";
+static const char *NoReturnMDName = "noreturn";
+static const char *FunctionMemberOfMDName = "func.member.of";
 
 /// \brief Pass to collect basic information about the generated code
 ///
@@ -39,6 +43,10 @@ static const char *JTReasonMDName = "revng.jt.reasons";
 /// provides information about the generated basic blocks, distinguishing
 /// between basic blocks generated due to translation and dispatcher-related
 /// basic blocks.
+///
+/// The metadata describing each basic block is decoded once, in runOnModule,
+/// and cached by metadata node, so that queries don't have to look up the
+/// metadata kinds by name nor compare strings.
 class GeneratedCodeBasicInfo : public llvm::ModulePass {
 public:
   static char ID;
@@ -54,7 +62,11 @@ public:
     AnyPC(nullptr),
     UnexpectedPC(nullptr),
     PCRegSize(0),
-    RootFunction(nullptr) {}
+    RootFunction(nullptr),
+    BlockTypeMDKind(0),
+    JTReasonMDKind(0),
+    JTReasonMaskMDKind(0),
+    NoReturnMDKind(0) {}
 
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
     AU.setPreservesAll();
@@ -71,7 +83,7 @@ public:
     using namespace llvm;
 
     revng_assert(T != nullptr);
-    MDNode *MD = T->getMetadata(BlockTypeMDName);
+    MDNode *MD = T->getMetadata(BlockTypeMDKind);
 
     BasicBlock *BB = T->getParent();
     if (BB == &BB->getParent()->getEntryBlock())
@@ -86,10 +98,8 @@ public:
       return UntypedBlock;
     }
 
-    auto *BlockTypeMD = cast<MDTuple>(MD);
-
-    QuickMetadata QMD(getContext(T));
-    return BlockType(QMD.extract<uint32_t>(BlockTypeMD, 0));
+    auto *BlockTypeMD = cast<ConstantAsMetadata>(MD->getOperand(0));
+    return BlockType(getLimitedValue(BlockTypeMD->getValue()));
   }
 
   uint32_t getJTReasons(llvm::BasicBlock *BB) const {
@@ -98,18 +108,21 @@ public:
 
   uint32_t getJTReasons(llvm::TerminatorInst *T) const {
     using namespace llvm;
-    uint32_t Result = 0;
-
-    MDNode *Node = T->getMetadata(JTReasonMDName);
-    auto *Tuple = cast_or_null<MDTuple>(Node);
-    revng_assert(Tuple != nullptr);
 
-    for (Metadata *ReasonMD : Tuple->operands()) {
-      StringRef Text = cast<MDString>(ReasonMD)->getString();
-      Result |= static_cast<uint32_t>(JTReason::fromName(Text));
+    // Prefer the bitmask, if available
+    if (MDNode *Mask = T->getMetadata(JTReasonMaskMDKind)) {
+      auto *MaskMD = cast<ConstantAsMetadata>(Mask->getOperand(0));
+      return getLimitedValue(MaskMD->getValue());
     }
 
-    return Result;
+    MDNode *Node = T->getMetadata(JTReasonMDKind);
+    revng_assert(Node != nullptr);
+
+    auto It = JTReasons.find(Node);
+    if (It != JTReasons.end())
+      return It->second;
+
+    return decodeJTReasons(Node);
   }
 
   KillReason::Values getKillReason(llvm::BasicBlock *BB) const {
@@ -119,13 +132,16 @@ public:
   KillReason::Values getKillReason(llvm::TerminatorInst *T) const {
     using namespace llvm;
 
-    auto *NoReturnMD = T->getMetadata("noreturn");
-    if (auto *NoreturnTuple = dyn_cast_or_null<MDTuple>(NoReturnMD)) {
-      QuickMetadata QMD(getContext(T));
-      return KillReason::fromName(QMD.extract<StringRef>(NoreturnTuple, 0));
-    }
+    MDNode *Node = T->getMetadata(NoReturnMDKind);
+    auto *NoReturnMD = dyn_cast_or_null<MDTuple>(Node);
+    if (NoReturnMD == nullptr)
+      return KillReason::NonKiller;
 
-    return KillReason::NonKiller;
+    auto It = KillReasons.find(NoReturnMD);
+    if (It != KillReasons.end())
+      return It->second;
+
+    return decodeKillReason(NoReturnMD);
   }
 
   bool isKiller(llvm::BasicBlock *BB) const {
@@ -260,6 +276,10 @@ public:
   llvm::BasicBlock *anyPC() { return AnyPC; }
   llvm::BasicBlock *unexpectedPC() { return UnexpectedPC; }
 
+private:
+  static uint32_t decodeJTReasons(const llvm::MDNode *Node);
+  static KillReason::Values decodeKillReason(const llvm::MDNode *Node);
+
 private:
   uint32_t InstructionAlignment;
   uint32_t DelaySlotSize;
@@ -272,6 +292,16 @@ private:
   std::map<uint64_t, llvm::BasicBlock *> JumpTargets;
   unsigned PCRegSize;
   llvm::Function *RootFunction;
+
+  unsigned BlockTypeMDKind;
+  unsigned JTReasonMDKind;
+  unsigned JTReasonMaskMDKind;
+  unsigned NoReturnMDKind;
+
+  /// Decoded `revng.jt.reasons` metadata nodes
+  llvm::DenseMap<const llvm::MDNode *, uint32_t> JTReasons;
+  /// Decoded `noreturn` metadata nodes
+  llvm::DenseMap<const llvm::MDNode *, KillReason::Values> KillReasons;
 };
 
 template<>
@@ -0,0 +1,44 @@
+#ifndef LOWERDISPATCHERS_H
+#define LOWERDISPATCHERS_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// LLVM includes
+#include "llvm/Pass.h"
+
+// Local libraries includes
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
+
+/// \brief Replace the dispatchers with lookups in constant tables
+///
+/// The dispatcher of `root` and the `function_dispatcher` produced by function
+/// isolation are switches on the program counter with a case for each jump
+/// target (or function). With hundreds of thousands of cases they are slow to
+/// compile and lead to large jump tables and comparison trees. This pass
+/// replaces each of them with a call to a function looking up the program
+/// counter in a sorted table, followed by an `indirectbr` (or an indirect
+/// call).
+///
+/// The other passes expect the switches, therefore this pass has to run last,
+/// right before the module is compiled.
+class LowerDispatchers : public llvm::ModulePass {
+public:
+  static char ID;
+
+public:
+  LowerDispatchers() : ModulePass(ID) {}
+
+  bool runOnModule(llvm::Module &M) override;
+
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
+    AU.addRequired<GeneratedCodeBasicInfo>();
+  }
+
+private:
+  bool lowerRootDispatcher(llvm::Module &M);
+  bool lowerFunctionDispatcher(llvm::Module &M);
+};
+
+#endif // LOWERDISPATCHERS_H
@@ -0,0 +1,55 @@
+#ifndef SHARDROOT_H
+#define SHARDROOT_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// LLVM includes
+#include "llvm/Pass.h"
+
+// Local libraries includes
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
+
+/// \brief Partition the code of `root` in region functions
+///
+/// The jump targets are grouped in regions by address range or, if requested
+/// and available, by the function they belong to. The blocks of each region
+/// are moved to a function of their own, which has a dispatcher for its jump
+/// targets. When a jump leaves a region, the program counter is set, the
+/// region function returns to `root`, and the `root` dispatcher calls the
+/// function of the right region. This way, the cost of the function-level
+/// analyses and transformations of the backend scales with the size of the
+/// regions, and not with the size of the whole program.
+///
+/// Regions that can't be separated (e.g., because an SSA value flows from one
+/// to the other) are merged, possibly with `root`. The blocks reached by more
+/// than one region stay in `root`, while simple landing pads are copied in
+/// each region unwinding to them.
+///
+/// The analyses expect all the code in `root`, therefore this pass has to run
+/// after them, right before the module is compiled. As a consequence, it only
+/// bounds the cost of optimizing and compiling the module.
+///
+/// \note Sharding `root` during the lifting is not implemented: the analyses
+///       of the harvest still take `M.getFunction("root")` and work on the
+///       whole program. In particular, OSRA computes the dominator and
+///       post-dominator trees of the whole `root`, verifyModule checks all of
+///       it, and so does SROA in the harvest cleanup, unless
+///       `-region-harvest-cleanup` limits the cleanup to the code changed
+///       since the previous harvest.
+class ShardRoot : public llvm::ModulePass {
+public:
+  static char ID;
+
+public:
+  ShardRoot() : ModulePass(ID) {}
+
+  bool runOnModule(llvm::Module &M) override;
+
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
+    AU.addRequired<GeneratedCodeBasicInfo>();
+  }
+};
+
+#endif // SHARDROOT_H
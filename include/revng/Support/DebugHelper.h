@@ -14,6 +14,7 @@
 #include "llvm/IR/DIBuilder.h"
 
 // Local libraries includes
+#include "revng/Support/PTCTable.h"
 #include "revng/Support/revng.h"
 
 namespace llvm {
@@ -61,7 +62,11 @@ public:
   /// \param Scope the scope, typically a `DISubprogram`.
   /// \param DebugInfo whether to decorate the IR being serialized with debug
   ///        metadata refering to the produce IR itself or not.
-  DebugAnnotationWriter(llvm::LLVMContext &Context, bool DebugInfo);
+  /// \param Table the table of the PTC instructions, if the module has been
+  ///        produced using one, or nullptr.
+  DebugAnnotationWriter(llvm::LLVMContext &Context,
+                        bool DebugInfo,
+                        const PTCTable *Table);
 
   virtual void
   emitInstructionAnnot(const llvm::Instruction *TheInstruction,
@@ -73,6 +78,7 @@ private:
   unsigned PTCInstrMDKind;
   unsigned DbgMDKind;
   bool DebugInfo;
+  const PTCTable *Table;
 };
 
 /// \brief Handle printing the IR in textual form, possibly with debug
@@ -102,7 +108,15 @@ public:
   /// Copy the debug file to the output path, if they are the same
   bool copySource();
 
+  /// \brief Use \p Table to obtain the text of the PTC instructions
+  ///
+  /// If not set, the table is loaded on demand from `OUTPUT.ptc-table`, if
+  /// present.
+  void setPTCTable(const PTCTable *Table);
+
 private:
+  const PTCTable *ptcTable();
+
   /// Create a new AssemblyAnnotationWriter
   ///
   /// \param DebugInfo whether to create an annotator producing with debug
@@ -122,6 +136,10 @@ private:
 
   DebugInfoType::Values DebugInfo;
   std::string DebugPath;
+
+  const PTCTable *Table;
+  std::unique_ptr<PTCTable> OwnedTable;
+  bool TableLoaded;
 };
 
 #endif // DEBUGHELPER_H
@@ -0,0 +1,79 @@
+#ifndef PTCTABLE_H
+#define PTCTABLE_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+/// \brief Address-indexed table of the textual representation of the PTC
+///        instructions
+///
+/// For each original instruction, identified by its program counter, the table
+/// records the textual representation of each of the PTC instructions it has
+/// been translated into, identified by their index w.r.t. the
+/// `debug_insn_start` of the original instruction. Each string is stored only
+/// once.
+///
+/// The same original instruction is not always translated in the same way:
+/// for instance, libtinycode drops the computation of the flags that are
+/// overwritten later in the same translation block. Therefore, each program
+/// counter can have multiple translations, identified by an ID. Identical
+/// translations are stored only once.
+///
+/// This allows to avoid attaching a distinct string to each generated
+/// instruction, which is rather expensive both in terms of memory and in terms
+/// of size of the serialized module.
+class PTCTable {
+public:
+  PTCTable() { Strings.emplace_back(); }
+
+  /// \brief Record a translation of the instruction at \p PC
+  ///
+  /// \param Texts the text of each PTC instruction of the translation, by
+  ///        index.
+  ///
+  /// \return the ID of the translation, which is the ID of an existing one if
+  ///         it's identical.
+  unsigned add(uint64_t PC, llvm::ArrayRef<std::string> Texts);
+
+  /// \brief Get the text of the PTC instruction with index \p Index in the
+  ///        translation \p Translation of the instruction at \p PC, or an
+  ///        empty string
+  llvm::StringRef get(uint64_t PC, unsigned Translation, unsigned Index) const;
+
+  bool empty() const { return Instructions.empty(); }
+
+  void serialize(std::ostream &Output) const;
+
+  /// \brief Load the content of a table produced by serialize
+  ///
+  /// \return true in case of success.
+  bool load(std::istream &Input);
+
+private:
+  unsigned intern(llvm::StringRef Text);
+
+private:
+  /// Interned strings, the first one is always the empty string
+  std::vector<std::string> Strings;
+  llvm::StringMap<unsigned> StringIDs;
+
+  /// Map from the PC of an instruction to its translations, each one being the
+  /// IDs of the strings of its PTC instructions
+  std::map<uint64_t, std::vector<std::vector<unsigned>>> Instructions;
+};
+
+#endif // PTCTABLE_H
@@ -0,0 +1,132 @@
+#ifndef PHASEREPORT_H
+#define PHASEREPORT_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ManagedStatic.h"
+
+namespace llvm {
+class Module;
+}
+
+/// \brief Resources used by the process up to a certain point in time
+struct ResourceUsage {
+  double WallTime; ///< Seconds since an arbitrary point in time
+  double CPUTime; ///< User plus system time, in seconds
+  uint64_t PeakRSS; ///< Peak resident set size, in kilobytes
+
+  static ResourceUsage now();
+};
+
+/// \brief Record the resources used by each phase of a program
+///
+/// Each phase is identified by a name, phases can be nested and executed
+/// multiple times. For each phase the report holds the number of executions,
+/// the total wall and CPU time spent in it, the peak RSS of the process at the
+/// end of its last execution and, if a module has been specified, its number
+/// of instructions and basic blocks at that time.
+///
+/// Unless enable is called, measuring a phase has no cost.
+class PhaseReport {
+public:
+  /// \brief Measures a phase from its creation until its destruction or a call
+  ///        to end
+  class Scope {
+  public:
+    Scope(PhaseReport *Report, llvm::StringRef Name, const llvm::Module *M) :
+      Report(Report->isEnabled() ? Report : nullptr),
+      Name(Name),
+      M(M) {
+      if (this->Report != nullptr)
+        Begin = ResourceUsage::now();
+    }
+
+    Scope(Scope &&Other) :
+      Report(Other.Report),
+      Name(std::move(Other.Name)),
+      M(Other.M),
+      Begin(Other.Begin) {
+      Other.Report = nullptr;
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    Scope &operator=(Scope &&) = delete;
+
+    ~Scope() { end(); }
+
+    void end() {
+      if (Report != nullptr)
+        Report->record(Name, Begin, M);
+      Report = nullptr;
+    }
+
+  private:
+    PhaseReport *Report;
+    std::string Name;
+    const llvm::Module *M;
+    ResourceUsage Begin;
+  };
+
+public:
+  PhaseReport() : Enabled(false) {}
+
+  void enable() {
+    Enabled = true;
+    Start = ResourceUsage::now();
+  }
+
+  bool isEnabled() const { return Enabled; }
+
+  /// \brief Start measuring the phase \p Name
+  ///
+  /// \param M the module whose size has to be recorded at the end of the
+  ///        phase, if any.
+  Scope scope(llvm::StringRef Name, const llvm::Module *M = nullptr) {
+    return Scope(this, Name, M);
+  }
+
+  /// \brief Write the report in JSON format
+  void serialize(std::ostream &Output) const;
+
+private:
+  void record(llvm::StringRef Name,
+              const ResourceUsage &Begin,
+              const llvm::Module *M);
+
+private:
+  struct Phase {
+    std::string Name;
+    uint64_t Count;
+    double WallTime;
+    double CPUTime;
+    uint64_t PeakRSS;
+    bool HasModule;
+    uint64_t Instructions;
+    uint64_t BasicBlocks;
+  };
+
+private:
+  bool Enabled;
+  ResourceUsage Start;
+
+  /// Phases in order of first execution
+  std::vector<Phase> Phases;
+  llvm::StringMap<size_t> PhaseIndex;
+};
+
+/// \brief The report of the phases of the current program
+extern llvm::ManagedStatic<PhaseReport> Phases;
+
+#endif // PHASEREPORT_H
@@ -31,6 +31,32 @@ bool GeneratedCodeBasicInfo::runOnModule(llvm::Module &M) {
 
   RootFunction = &F;
 
+  LLVMContext &Context = M.getContext();
+  BlockTypeMDKind = Context.getMDKindID(BlockTypeMDName);
+  JTReasonMDKind = Context.getMDKindID(JTReasonMDName);
+  JTReasonMaskMDKind = Context.getMDKindID(JTReasonMaskMDName);
+  NoReturnMDKind = Context.getMDKindID(NoReturnMDName);
+
+  // Decode each distinct metadata node once
+  JTReasons.clear();
+  KillReasons.clear();
+  for (Function &Current : M) {
+    for (BasicBlock &BB : Current) {
+      TerminatorInst *T = BB.getTerminator();
+      if (T == nullptr)
+        continue;
+
+      MDNode *Node = T->getMetadata(JTReasonMDKind);
+      if (Node != nullptr and JTReasons.count(Node) == 0)
+        JTReasons[Node] = decodeJTReasons(Node);
+
+      Node = T->getMetadata(NoReturnMDKind);
+      auto *Tuple = dyn_cast_or_null<MDTuple>(Node);
+      if (Tuple != nullptr and KillReasons.count(Tuple) == 0)
+        KillReasons[Tuple] = decodeKillReason(Tuple);
+    }
+  }
+
   const char *MDName = "revng.input.architecture";
   NamedMDNode *InputArchMD = M.getOrInsertNamedMetadata(MDName);
   auto *Tuple = dyn_cast<MDTuple>(InputArchMD->getOperand(0));
@@ -90,6 +116,21 @@ bool GeneratedCodeBasicInfo::runOnModule(llvm::Module &M) {
   return false;
 }
 
+uint32_t GeneratedCodeBasicInfo::decodeJTReasons(const MDNode *Node) {
+  uint32_t Result = 0;
+  for (const MDOperand &ReasonMD : Node->operands()) {
+    StringRef Text = cast<MDString>(ReasonMD)->getString();
+    Result |= static_cast<uint32_t>(JTReason::fromName(Text));
+  }
+
+  return Result;
+}
+
+KillReason::Values
+GeneratedCodeBasicInfo::decodeKillReason(const MDNode *Node) {
+  return KillReason::fromName(cast<MDString>(Node->getOperand(0))->getString());
+}
+
 std::pair<uint64_t, uint64_t>
 GeneratedCodeBasicInfo::getPC(Instruction *TheInstruction) const {
   CallInst *NewPCCall = nullptr;
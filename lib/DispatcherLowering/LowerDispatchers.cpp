@@ -0,0 +1,490 @@
+/// \file lowerdispatchers.cpp
+/// \brief Implements the LowerDispatchers pass, which replaces the switches of
+///        the dispatchers with lookups in constant tables.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+
+// Local libraries includes
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
+#include "revng/DispatcherLowering/LowerDispatchers.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/IRHelpers.h"
+
+using namespace llvm;
+
+char LowerDispatchers::ID = 0;
+static RegisterPass<LowerDispatchers> X("lower-dispatchers",
+                                        "Lower Dispatchers Pass",
+                                        false,
+                                        false);
+
+static Logger<> Log("lower-dispatchers");
+
+namespace TableForm {
+
+/// \brief Layout of the table used to look up the program counter
+enum Values {
+  /// Choose between Paged and Hierarchical depending on the density
+  Auto,
+  /// A binary search on the whole table
+  Sorted,
+  /// A directory with an entry for each page in the covered address range,
+  /// followed by a binary search in the page
+  Paged,
+  /// A binary search on the non-empty pages, followed by a binary search in
+  /// the page
+  Hierarchical
+};
+
+} // namespace TableForm
+
+static cl::opt<TableForm::Values>
+  Form("dispatcher-table",
+       cl::desc("layout of the tables of the lowered dispatchers"),
+       cl::values(clEnumValN(TableForm::Auto,
+                             "auto",
+                             "paged or hierarchical, depending on the "
+                             "density of the jump targets"),
+                  clEnumValN(TableForm::Sorted,
+                             "sorted",
+                             "binary search on all the jump targets"),
+                  clEnumValN(TableForm::Paged,
+                             "paged",
+                             "direct lookup of the page, then binary search"),
+                  clEnumValN(TableForm::Hierarchical,
+                             "hierarchical",
+                             "binary search of the page, then of the jump "
+                             "target")),
+       cl::init(TableForm::Auto));
+
+static cl::opt<unsigned> PageBits("dispatcher-page-bits",
+                                  cl::desc("log2 of the size of the pages of "
+                                           "the dispatcher tables, less than "
+                                           "64"),
+                                  cl::init(12));
+
+/// Tables smaller than this are always searched as a whole
+static const size_t MinimumPagedEntries = 64;
+
+/// Maximum ratio between the covered pages and the non-empty pages for the
+/// paged form to be chosen automatically
+static const uint64_t MaximumPagedSparseness = 4;
+
+/// A program counter and the associated value
+using TableEntry = std::pair<uint64_t, Constant *>;
+
+static TableForm::Values chooseForm(const std::vector<TableEntry> &Entries,
+                                    IntegerType *PCType) {
+  // The pages have to be smaller than the address space
+  if (PageBits >= PCType->getBitWidth())
+    return TableForm::Sorted;
+
+  if (Form != TableForm::Auto)
+    return Form;
+
+  if (Entries.size() < MinimumPagedEntries)
+    return TableForm::Sorted;
+
+  uint64_t Pages = 0;
+  uint64_t LastPage = 0;
+  for (const TableEntry &Entry : Entries) {
+    uint64_t Page = Entry.first >> PageBits;
+    if (Pages == 0 or Page != LastPage)
+      Pages++;
+    LastPage = Page;
+  }
+
+  uint64_t FirstPage = Entries.front().first >> PageBits;
+  uint64_t Covered = LastPage - FirstPage + 1;
+  if (Covered <= Pages * MaximumPagedSparseness)
+    return TableForm::Paged;
+  else
+    return TableForm::Hierarchical;
+}
+
+static GlobalVariable *createTable(Module &M,
+                                   const Twine &Name,
+                                   Type *ElementType,
+                                   ArrayRef<Constant *> Elements) {
+  auto *TableType = ArrayType::get(ElementType, Elements.size());
+  return new GlobalVariable(M,
+                            TableType,
+                            true,
+                            GlobalValue::InternalLinkage,
+                            ConstantArray::get(TableType, Elements),
+                            Name);
+}
+
+static GlobalVariable *createTable(Module &M,
+                                   const Twine &Name,
+                                   IntegerType *ElementType,
+                                   ArrayRef<uint64_t> Elements) {
+  std::vector<Constant *> Constants;
+  Constants.reserve(Elements.size());
+  for (uint64_t Element : Elements)
+    Constants.push_back(ConstantInt::get(ElementType, Element));
+  return createTable(M, Name, ElementType, Constants);
+}
+
+static Value *
+loadElement(IRBuilder<> &Builder, GlobalVariable *Table, Value *Index) {
+  Value *Zero = ConstantInt::get(Index->getType(), 0);
+  return Builder.CreateLoad(Builder.CreateInBoundsGEP(Table, { Zero, Index }));
+}
+
+/// \brief Emit a binary search of \p Key in the elements [\p Low, \p High) of
+///        the sorted \p Table
+///
+/// \return the index of \p Key in \p Table, available at the insertion point
+///         of \p Builder. If \p Key is not found, the search jumps to \p Fail.
+static Value *emitSearch(IRBuilder<> &Builder,
+                         GlobalVariable *Table,
+                         Value *Key,
+                         Value *Low,
+                         Value *High,
+                         BasicBlock *Fail) {
+  LLVMContext &C = Builder.getContext();
+  BasicBlock *Preheader = Builder.GetInsertBlock();
+  Function *F = Preheader->getParent();
+  Type *IndexType = Low->getType();
+  StringRef Name = Table->getName();
+
+  auto *Loop = BasicBlock::Create(C, Name + ".loop", F);
+  auto *Body = BasicBlock::Create(C, Name + ".body", F);
+  auto *Step = BasicBlock::Create(C, Name + ".step", F);
+  auto *Found = BasicBlock::Create(C, Name + ".found", F);
+  Builder.CreateBr(Loop);
+
+  // Keep searching while the range is not empty
+  Builder.SetInsertPoint(Loop);
+  PHINode *LowPHI = Builder.CreatePHI(IndexType, 2);
+  PHINode *HighPHI = Builder.CreatePHI(IndexType, 2);
+  LowPHI->addIncoming(Low, Preheader);
+  HighPHI->addIncoming(High, Preheader);
+  Builder.CreateCondBr(Builder.CreateICmpULT(LowPHI, HighPHI), Body, Fail);
+
+  // Compare the key with the element in the middle of the range
+  Builder.SetInsertPoint(Body);
+  Value *Width = Builder.CreateSub(HighPHI, LowPHI);
+  Value *Middle = Builder.CreateAdd(LowPHI, Builder.CreateLShr(Width, 1));
+  Value *Current = loadElement(Builder, Table, Middle);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Current, Key), Found, Step);
+
+  // Continue in the half which can contain the key
+  Builder.SetInsertPoint(Step);
+  Value *IsLower = Builder.CreateICmpULT(Current, Key);
+  Value *One = ConstantInt::get(IndexType, 1);
+  Value *AfterMiddle = Builder.CreateAdd(Middle, One);
+  LowPHI->addIncoming(Builder.CreateSelect(IsLower, AfterMiddle, LowPHI), Step);
+  HighPHI->addIncoming(Builder.CreateSelect(IsLower, HighPHI, Middle), Step);
+  Builder.CreateBr(Loop);
+
+  Builder.SetInsertPoint(Found);
+  return Middle;
+}
+
+/// \brief Create a function returning the value associated to a program
+///        counter in \p Entries, or null if there's none
+///
+/// \param Entries the program counters and their values, sorted and unique.
+static Function *createLookup(Module &M,
+                              StringRef Name,
+                              IntegerType *PCType,
+                              PointerType *ValueType,
+                              const std::vector<TableEntry> &Entries) {
+  revng_assert(Entries.size() != 0);
+
+  LLVMContext &C = M.getContext();
+  IntegerType *IndexType = Type::getInt64Ty(C);
+  IntegerType *PageStartType = Type::getInt32Ty(C);
+  revng_assert(Entries.size() <= PageStartType->getBitMask());
+
+  auto *LookupType = FunctionType::get(ValueType, { PCType }, false);
+  auto *Lookup = Function::Create(LookupType,
+                                  GlobalValue::InternalLinkage,
+                                  Name,
+                                  &M);
+  Value *PC = &*Lookup->arg_begin();
+
+  auto *Entry = BasicBlock::Create(C, "", Lookup);
+  auto *Fail = BasicBlock::Create(C, "fail", Lookup);
+  ReturnInst::Create(C, ConstantPointerNull::get(ValueType), Fail);
+
+  std::vector<uint64_t> Addresses;
+  std::vector<Constant *> Values;
+  Addresses.reserve(Entries.size());
+  Values.reserve(Entries.size());
+  for (const TableEntry &Entry : Entries) {
+    Addresses.push_back(Entry.first);
+    Values.push_back(Entry.second);
+  }
+  auto *AddressesTable = createTable(M, Name + ".addresses", PCType, Addresses);
+  auto *ValuesTable = createTable(M, Name + ".values", ValueType, Values);
+
+  IRBuilder<> Builder(Entry);
+  Value *Low = ConstantInt::get(IndexType, 0);
+  Value *High = ConstantInt::get(IndexType, Entries.size());
+
+  TableForm::Values Chosen = chooseForm(Entries, PCType);
+
+  if (Chosen != TableForm::Sorted) {
+    // Collect the non-empty pages and the index of their first entry
+    std::vector<uint64_t> Pages;
+    std::vector<uint64_t> PageStarts;
+    for (size_t I = 0; I < Entries.size(); I++) {
+      uint64_t Page = Entries[I].first >> PageBits;
+      if (Pages.empty() or Pages.back() != Page) {
+        Pages.push_back(Page);
+        PageStarts.push_back(I);
+      }
+    }
+    PageStarts.push_back(Entries.size());
+
+    Value *Page = Builder.CreateLShr(PC, PageBits);
+    Value *Index = nullptr;
+    GlobalVariable *StartsTable = nullptr;
+
+    if (Chosen == TableForm::Paged) {
+      // For each page in the covered range, the index of the first entry at or
+      // after it
+      uint64_t FirstPage = Pages.front();
+      uint64_t Covered = Pages.back() - FirstPage + 1;
+      std::vector<uint64_t> Directory;
+      Directory.reserve(Covered + 1);
+      size_t Next = 0;
+      for (uint64_t Offset = 0; Offset <= Covered; Offset++) {
+        while (Next < Pages.size() and Pages[Next] < FirstPage + Offset)
+          Next++;
+        Directory.push_back(PageStarts[Next]);
+      }
+
+      StartsTable = createTable(M,
+                                Name + ".directory",
+                                PageStartType,
+                                Directory);
+
+      Value *Offset = Builder.CreateSub(Page, ConstantInt::get(PCType,
+                                                               FirstPage));
+      Index = Builder.CreateZExt(Offset, IndexType);
+      auto *InRange = BasicBlock::Create(C, "inrange", Lookup);
+      Value *IsInRange = Builder.CreateICmpULT(Index,
+                                               ConstantInt::get(IndexType,
+                                                                Covered));
+      Builder.CreateCondBr(IsInRange, InRange, Fail);
+      Builder.SetInsertPoint(InRange);
+    } else {
+      // Search the page first
+      auto *PagesTable = createTable(M, Name + ".pages", PCType, Pages);
+      StartsTable = createTable(M,
+                                Name + ".page_starts",
+                                PageStartType,
+                                PageStarts);
+
+      Value *PagesCount = ConstantInt::get(IndexType, Pages.size());
+      Index = emitSearch(Builder, PagesTable, Page, Low, PagesCount, Fail);
+    }
+
+    // Restrict the search to the entries of the page
+    Value *NextIndex = Builder.CreateAdd(Index, ConstantInt::get(IndexType, 1));
+    Low = Builder.CreateZExt(loadElement(Builder, StartsTable, Index),
+                             IndexType);
+    High = Builder.CreateZExt(loadElement(Builder, StartsTable, NextIndex),
+                              IndexType);
+  }
+
+  Value *Index = emitSearch(Builder, AddressesTable, PC, Low, High, Fail);
+  Builder.CreateRet(loadElement(Builder, ValuesTable, Index));
+
+  return Lookup;
+}
+
+static bool compareEntries(const TableEntry &A, const TableEntry &B) {
+  return A.first < B.first;
+}
+
+bool LowerDispatchers::lowerRootDispatcher(Module &M) {
+  Function *Root = M.getFunction("root");
+  if (Root == nullptr or Root->empty())
+    return false;
+
+  auto &GCBI = getAnalysis<GeneratedCodeBasicInfo>();
+  BasicBlock *Dispatcher = nullptr;
+  for (BasicBlock &BB : *Root) {
+    if (BB.getTerminator() != nullptr
+        and GCBI.getType(&BB) == DispatcherBlock) {
+      Dispatcher = &BB;
+      break;
+    }
+  }
+
+  if (Dispatcher == nullptr)
+    return false;
+
+  auto *Switch = cast<SwitchInst>(Dispatcher->getTerminator());
+  BasicBlock *Default = Switch->getDefaultDest();
+
+  std::vector<TableEntry> Entries;
+  std::vector<BasicBlock *> Targets;
+  SmallPtrSet<BasicBlock *, 16> Seen;
+  for (auto &Case : Switch->cases()) {
+    BasicBlock *Target = Case.getCaseSuccessor();
+    if (Target == Default)
+      continue;
+
+    uint64_t PC = Case.getCaseValue()->getZExtValue();
+    Entries.emplace_back(PC, BlockAddress::get(Root, Target));
+    if (Seen.insert(Target).second)
+      Targets.push_back(Target);
+  }
+
+  if (Entries.empty())
+    return false;
+
+  std::sort(Entries.begin(), Entries.end(), compareEntries);
+
+  LLVMContext &C = M.getContext();
+  auto *PCType = cast<IntegerType>(Switch->getCondition()->getType());
+  PointerType *AddressType = Type::getInt8PtrTy(C);
+  Function *Lookup = createLookup(M,
+                                  "root_dispatcher_lookup",
+                                  PCType,
+                                  AddressType,
+                                  Entries);
+
+  // Look up the target and jump to it, or to the default destination if
+  // there's none
+  auto *Indirect = BasicBlock::Create(C, "dispatcher.indirect", Root);
+  IRBuilder<> Builder(Switch);
+  Value *Address = Builder.CreateCall(Lookup, { Switch->getCondition() });
+  Value *IsNull = Builder.CreateICmpEQ(Address,
+                                       ConstantPointerNull::get(AddressType));
+  auto *Branch = Builder.CreateCondBr(IsNull, Default, Indirect);
+  Branch->setMetadata(BlockTypeMDName, Switch->getMetadata(BlockTypeMDName));
+
+  Builder.SetInsertPoint(Indirect);
+  IndirectBrInst *Jump = Builder.CreateIndirectBr(Address, Targets.size());
+  for (BasicBlock *Target : Targets) {
+    Jump->addDestination(Target);
+
+    // The incoming edge now comes from the indirect branch
+    for (Instruction &I : *Target) {
+      auto *Phi = dyn_cast<PHINode>(&I);
+      if (Phi == nullptr)
+        break;
+
+      int Index = Phi->getBasicBlockIndex(Dispatcher);
+      if (Index >= 0)
+        Phi->setIncomingBlock(Index, Indirect);
+    }
+  }
+
+  Switch->eraseFromParent();
+
+  revng_log(Log,
+            "Root dispatcher lowered: " << Entries.size() << " jump targets, "
+                                        << Targets.size() << " destinations");
+
+  return true;
+}
+
+bool LowerDispatchers::lowerFunctionDispatcher(Module &M) {
+  Function *FunctionDispatcher = M.getFunction("function_dispatcher");
+  if (FunctionDispatcher == nullptr or FunctionDispatcher->empty()
+      or not FunctionDispatcher->getReturnType()->isVoidTy())
+    return false;
+
+  BasicBlock *Dispatcher = &FunctionDispatcher->getEntryBlock();
+  auto *Switch = dyn_cast<SwitchInst>(Dispatcher->getTerminator());
+  if (Switch == nullptr)
+    return false;
+
+  BasicBlock *Default = Switch->getDefaultDest();
+
+  // Each case jumps to a trampoline calling an isolated function and returning
+  LLVMContext &C = M.getContext();
+  auto *CalleeType = FunctionType::get(Type::getVoidTy(C), false);
+  PointerType *CalleePointerType = CalleeType->getPointerTo();
+  std::vector<TableEntry> Entries;
+  std::vector<BasicBlock *> Trampolines;
+  SmallPtrSet<BasicBlock *, 16> Seen;
+  for (auto &Case : Switch->cases()) {
+    BasicBlock *Trampoline = Case.getCaseSuccessor();
+    auto *Call = dyn_cast<CallInst>(&Trampoline->front());
+    if (Call == nullptr or Call->getNumArgOperands() != 0
+        or not isa<ReturnInst>(Call->getNextNode()))
+      return false;
+
+    Function *Callee = Call->getCalledFunction();
+    if (Callee == nullptr)
+      return false;
+
+    uint64_t PC = Case.getCaseValue()->getZExtValue();
+    auto *Pointer = ConstantExpr::getBitCast(Callee, CalleePointerType);
+    Entries.emplace_back(PC, Pointer);
+    if (Seen.insert(Trampoline).second)
+      Trampolines.push_back(Trampoline);
+  }
+
+  if (Entries.empty())
+    return false;
+
+  std::sort(Entries.begin(), Entries.end(), compareEntries);
+
+  auto *PCType = cast<IntegerType>(Switch->getCondition()->getType());
+  Function *Lookup = createLookup(M,
+                                  "function_dispatcher_lookup",
+                                  PCType,
+                                  CalleePointerType,
+                                  Entries);
+
+  // Look up the function and call it, or go to the default destination if
+  // there's none
+  auto *CallBlock = BasicBlock::Create(C,
+                                       "function_dispatcher.call",
+                                       FunctionDispatcher);
+  IRBuilder<> Builder(Switch);
+  Value *Callee = Builder.CreateCall(Lookup, { Switch->getCondition() });
+  Value *IsNull = Builder.CreateICmpEQ(Callee,
+                                       ConstantPointerNull::get(
+                                         CalleePointerType));
+  Builder.CreateCondBr(IsNull, Default, CallBlock);
+  Switch->eraseFromParent();
+
+  Builder.SetInsertPoint(CallBlock);
+  Builder.CreateCall(Callee);
+  Builder.CreateRetVoid();
+
+  // The trampolines are now unreachable
+  for (BasicBlock *Trampoline : Trampolines)
+    if (pred_empty(Trampoline))
+      Trampoline->eraseFromParent();
+
+  revng_log(Log, "Function dispatcher lowered: " << Entries.size()
+                                                 << " functions");
+
+  return true;
+}
+
+bool LowerDispatchers::runOnModule(Module &M) {
+  revng_check(PageBits < 64, "-dispatcher-page-bits must be less than 64");
+
+  bool Changed = lowerRootDispatcher(M);
+  Changed = lowerFunctionDispatcher(M) or Changed;
+  return Changed;
+}
@@ -786,7 +786,7 @@ void IFI::run() {
     // We iterate over all the metadata that represent the functions a basic
     // block belongs to, and add the basic block in each function
     TerminatorInst *Terminator = BB.getTerminator();
-    if (MDNode *Node = Terminator->getMetadata("func.member.of")) {
+    if (MDNode *Node = Terminator->getMetadata(FunctionMemberOfMDName)) {
       auto *Tuple = cast<MDTuple>(Node);
       for (const MDOperand &Op : Tuple->operands()) {
         auto *FunctionMD = cast<MDTuple>(Op);
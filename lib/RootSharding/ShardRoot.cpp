@@ -0,0 +1,659 @@
+/// \file shardroot.cpp
+/// \brief Implements the ShardRoot pass, which partitions the code of `root`
+///        in region functions.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DIBuilder.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+// Local libraries includes
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
+#include "revng/RootSharding/ShardRoot.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/IRHelpers.h"
+
+using namespace llvm;
+
+char ShardRoot::ID = 0;
+static RegisterPass<ShardRoot> X("shard-root", "Shard Root Pass", false, false);
+
+static Logger<> Log("shard-root");
+
+namespace ShardingCriterion {
+
+/// \brief How the jump targets are grouped in regions
+enum Values {
+  /// Jump targets in the same address range
+  Range,
+  /// Jump targets in the same function, if any, or in the same address range
+  Function
+};
+
+} // namespace ShardingCriterion
+
+static cl::opt<ShardingCriterion::Values>
+  Criterion("shard-by",
+            cl::desc("criterion to group the jump targets in regions"),
+            cl::values(clEnumValN(ShardingCriterion::Range,
+                                  "range",
+                                  "address range"),
+                       clEnumValN(ShardingCriterion::Function,
+                                  "function",
+                                  "function, as identified by the function "
+                                  "boundaries detection, or address range")),
+            cl::init(ShardingCriterion::Range));
+
+static cl::opt<unsigned> RangeBits("shard-range-bits",
+                                   cl::desc("log2 of the size of the address "
+                                            "ranges of the regions"),
+                                   cl::init(16));
+
+/// The region of the blocks that stay in root
+static const unsigned RootRegion = 0;
+
+/// The value returned by a region to have root run the dispatcher
+static const unsigned DispatchCode = 0;
+
+static uint64_t getJumpTargetPC(BasicBlock *BB) {
+  auto *Call = cast<CallInst>(&*BB->begin());
+  return getLimitedValue(Call->getArgOperand(0));
+}
+
+/// \brief Check if \p BB is a landing pad that can be copied in each region
+///        unwinding to it
+///
+/// This is the case of a landing pad without PHIs and successors, whose values
+/// are used only within the block itself, such as the one shared by all the
+/// invokes emitted by the function isolation.
+static bool isCloneableLandingPad(BasicBlock *BB) {
+  if (not BB->isLandingPad() or isa<PHINode>(BB->front()))
+    return false;
+
+  if (BB->getTerminator()->getNumSuccessors() != 0)
+    return false;
+
+  for (Instruction &I : *BB) {
+    for (Value *Operand : I.operands()) {
+      auto *Definition = dyn_cast<Instruction>(Operand);
+      if (isa<Argument>(Operand)
+          or (Definition != nullptr and Definition->getParent() != BB))
+        return false;
+    }
+
+    for (User *U : I.users())
+      if (cast<Instruction>(U)->getParent() != BB)
+        return false;
+  }
+
+  return true;
+}
+
+/// \brief Get the name of the first function \p BB belongs to, if any
+static MDString *getFunctionName(BasicBlock *BB, QuickMetadata &QMD) {
+  MDNode *Node = BB->getTerminator()->getMetadata(FunctionMemberOfMDName);
+  auto *Tuple = cast_or_null<MDTuple>(Node);
+  if (Tuple == nullptr or Tuple->getNumOperands() == 0)
+    return nullptr;
+
+  auto *FunctionMD = cast<MDTuple>(Tuple->getOperand(0));
+  auto *FunctionEntryMD = QMD.extract<MDTuple *>(FunctionMD, 0);
+  return QMD.extract<MDString *>(FunctionEntryMD, 0);
+}
+
+class ShardRootImpl {
+public:
+  ShardRootImpl(Function *Root, GeneratedCodeBasicInfo &GCBI) :
+    M(*Root->getParent()),
+    C(M.getContext()),
+    Root(Root),
+    GCBI(GCBI),
+    PCReg(GCBI.pcReg()),
+    PCType(cast<IntegerType>(PCReg->getType()->getPointerElementType())),
+    CodeType(Type::getInt32Ty(C)),
+    Dispatcher(nullptr),
+    RootReturn(nullptr) {}
+
+  bool run();
+
+private:
+  /// \brief Assign each jump target, and the blocks it reaches without going
+  ///        through other jump targets, to a region
+  void assignRegions();
+
+  /// \brief Merge the regions that can't be in different functions
+  void mergeInseparable();
+
+  Function *
+  createRegionFunction(unsigned Region, ArrayRef<BasicBlock *> Blocks);
+
+  /// \brief Get a block of \p F leaving it to reach \p Target
+  ///
+  /// Landing pads can't be reached by returning from \p F, they are copied
+  /// into \p F instead.
+  BasicBlock *getExit(Function *F, BasicBlock *Target);
+
+  /// \brief Move to root \p BB and the untyped blocks it reaches
+  void moveToRoot(BasicBlock *BB);
+
+  /// \brief Get a block of root returning from it
+  BasicBlock *getRootReturn() {
+    if (RootReturn == nullptr) {
+      RootReturn = BasicBlock::Create(C, "", Root);
+      ReturnInst::Create(C, RootReturn);
+    }
+    return RootReturn;
+  }
+
+  /// \brief Replace \p Return with a return of the exit code of root's return
+  void replaceReturn(ReturnInst *Return) {
+    revng_assert(Return->getReturnValue() == nullptr);
+    unsigned Code = getExitCode(getRootReturn());
+    ReturnInst::Create(C, ConstantInt::get(CodeType, Code), Return);
+    Return->eraseFromParent();
+  }
+
+  /// \brief Connect root to the region functions
+  void createTrampolines();
+
+  void moveAllocas();
+
+  void updateDebugInfo();
+
+  unsigned getExitCode(BasicBlock *Target) {
+    auto It = ExitCodes.find(Target);
+    if (It != ExitCodes.end())
+      return It->second;
+
+    unsigned Code = ExitTargets.size();
+    ExitCodes[Target] = Code;
+    ExitTargets.push_back(Target);
+    return Code;
+  }
+
+  unsigned newRegion() {
+    Parents.push_back(Parents.size());
+    return Parents.size() - 1;
+  }
+
+  unsigned find(unsigned Region) {
+    while (Parents[Region] != Region) {
+      Parents[Region] = Parents[Parents[Region]];
+      Region = Parents[Region];
+    }
+    return Region;
+  }
+
+  /// \brief Merge two regions, root absorbs any region merged with it
+  void merge(unsigned A, unsigned B) {
+    A = find(A);
+    B = find(B);
+    if (A < B)
+      Parents[B] = A;
+    else if (B < A)
+      Parents[A] = B;
+  }
+
+  unsigned regionOf(BasicBlock *BB) {
+    auto It = BlockRegions.find(BB);
+    if (It == BlockRegions.end())
+      return RootRegion;
+    return find(It->second);
+  }
+
+private:
+  Module &M;
+  LLVMContext &C;
+  Function *Root;
+  GeneratedCodeBasicInfo &GCBI;
+  GlobalVariable *PCReg;
+  IntegerType *PCType;
+  IntegerType *CodeType;
+  SwitchInst *Dispatcher;
+  BasicBlock *RootReturn;
+
+  /// Union-find forest of the regions
+  std::vector<unsigned> Parents;
+  DenseMap<BasicBlock *, unsigned> BlockRegions;
+
+  /// Function of each region
+  std::map<unsigned, Function *> Functions;
+
+  /// Exit blocks of each region function, by target
+  DenseMap<std::pair<Function *, BasicBlock *>, BasicBlock *> Exits;
+
+  /// The blocks of root reached by returning an exit code from a region
+  std::vector<BasicBlock *> ExitTargets;
+  DenseMap<BasicBlock *, unsigned> ExitCodes;
+};
+
+void ShardRootImpl::assignRegions() {
+  QuickMetadata QMD(C);
+  std::map<uint64_t, unsigned> RangeRegions;
+  DenseMap<MDString *, unsigned> FunctionRegions;
+  std::vector<BasicBlock *> JumpTargets;
+
+  revng_assert(Parents.empty());
+  newRegion();
+
+  for (BasicBlock &BB : *Root) {
+    if (BB.empty() or GCBI.getType(&BB) != JumpTargetBlock)
+      continue;
+
+    MDString *Name = nullptr;
+    if (Criterion == ShardingCriterion::Function)
+      Name = getFunctionName(&BB, QMD);
+
+    unsigned Region;
+    if (Name != nullptr) {
+      auto It = FunctionRegions.find(Name);
+      if (It == FunctionRegions.end())
+        It = FunctionRegions.insert({ Name, newRegion() }).first;
+      Region = It->second;
+    } else {
+      uint64_t Range = getJumpTargetPC(&BB) >> RangeBits;
+      auto It = RangeRegions.find(Range);
+      if (It == RangeRegions.end())
+        It = RangeRegions.insert({ Range, newRegion() }).first;
+      Region = It->second;
+    }
+
+    BlockRegions[&BB] = Region;
+    JumpTargets.push_back(&BB);
+  }
+
+  // The untyped blocks reachable from more than one region, such as the
+  // blocks handling the return from the invokes of the function isolation,
+  // stay in root, so that they don't merge the regions reaching them
+  for (BasicBlock *JumpTarget : JumpTargets) {
+    unsigned Region = BlockRegions[JumpTarget];
+    std::vector<BasicBlock *> WorkList = { JumpTarget };
+    while (not WorkList.empty()) {
+      BasicBlock *BB = WorkList.back();
+      WorkList.pop_back();
+
+      // Blocks moved to root in the meantime have already been handled
+      if (BlockRegions[BB] == RootRegion)
+        continue;
+
+      for (BasicBlock *Successor : successors(BB)) {
+        if (Successor->empty() or GCBI.getType(Successor) != UntypedBlock
+            or isCloneableLandingPad(Successor))
+          continue;
+
+        auto Result = BlockRegions.insert({ Successor, Region });
+        if (Result.second)
+          WorkList.push_back(Successor);
+        else if (Result.first->second != RootRegion
+                 and Result.first->second != Region)
+          moveToRoot(Successor);
+      }
+    }
+  }
+}
+
+void ShardRootImpl::moveToRoot(BasicBlock *BB) {
+  std::vector<BasicBlock *> WorkList = { BB };
+  while (not WorkList.empty()) {
+    BasicBlock *Current = WorkList.back();
+    WorkList.pop_back();
+
+    BlockRegions[Current] = RootRegion;
+    for (BasicBlock *Successor : successors(Current)) {
+      if (Successor->empty() or GCBI.getType(Successor) != UntypedBlock
+          or isCloneableLandingPad(Successor))
+        continue;
+
+      auto It = BlockRegions.find(Successor);
+      if (It == BlockRegions.end() or It->second != RootRegion)
+        WorkList.push_back(Successor);
+    }
+  }
+}
+
+void ShardRootImpl::mergeInseparable() {
+  for (BasicBlock &BB : *Root) {
+    unsigned Region = regionOf(&BB);
+
+    // SSA values can't flow between regions, with the exception of the
+    // allocas, which are handled later
+    for (Instruction &I : BB) {
+      for (Value *Operand : I.operands()) {
+        if (auto *Definition = dyn_cast<Instruction>(Operand)) {
+          if (not isa<AllocaInst>(Definition))
+            merge(Region, regionOf(Definition->getParent()));
+        } else if (isa<Argument>(Operand)) {
+          merge(Region, RootRegion);
+        }
+      }
+
+      if (auto *Phi = dyn_cast<PHINode>(&I))
+        for (BasicBlock *Incoming : Phi->blocks())
+          merge(Region, regionOf(Incoming));
+    }
+
+    // The region functions return exit codes, not what root returns, they can
+    // only have root return nothing
+    auto *Return = dyn_cast<ReturnInst>(BB.getTerminator());
+    if (Return != nullptr and Return->getReturnValue() != nullptr)
+      merge(Region, RootRegion);
+
+    // Jumps between regions go through root, therefore they can only target
+    // jump targets or blocks of root, and they can't have PHIs
+    for (BasicBlock *Successor : successors(&BB)) {
+      unsigned SuccessorRegion = regionOf(Successor);
+      if (find(Region) == SuccessorRegion)
+        continue;
+
+      bool IsJumpTarget = GCBI.getType(Successor) == JumpTargetBlock;
+      if (isa<PHINode>(Successor->front())
+          or (SuccessorRegion != RootRegion and not IsJumpTarget))
+        merge(Region, SuccessorRegion);
+    }
+  }
+
+  // Each alloca can be moved to the region using it, if there's only one
+  for (Instruction &I : Root->getEntryBlock()) {
+    auto *Alloca = dyn_cast<AllocaInst>(&I);
+    if (Alloca == nullptr)
+      continue;
+
+    unsigned Region = RootRegion;
+    bool First = true;
+    for (User *U : Alloca->users()) {
+      unsigned UserRegion = regionOf(cast<Instruction>(U)->getParent());
+      if (First)
+        Region = UserRegion;
+      else
+        merge(Region, UserRegion);
+      First = false;
+    }
+  }
+}
+
+BasicBlock *ShardRootImpl::getExit(Function *F, BasicBlock *Target) {
+  BasicBlock *&Exit = Exits[{ F, Target }];
+  if (Exit != nullptr)
+    return Exit;
+
+  if (isCloneableLandingPad(Target)) {
+    ValueToValueMapTy Map;
+    Exit = CloneBasicBlock(Target, Map, "", F);
+    for (Instruction &I : *Exit)
+      RemapInstruction(&I,
+                       Map,
+                       RF_NoModuleLevelChanges | RF_IgnoreMissingLocals);
+
+    if (auto *Return = dyn_cast<ReturnInst>(Exit->getTerminator()))
+      replaceReturn(Return);
+
+    return Exit;
+  }
+
+  Exit = BasicBlock::Create(C, "", F);
+  if (GCBI.getType(Target) == JumpTargetBlock) {
+    // Have root dispatch to the jump target
+    auto *PC = ConstantInt::get(PCType, getJumpTargetPC(Target));
+    new StoreInst(PC, PCReg, Exit);
+    ReturnInst::Create(C, ConstantInt::get(CodeType, DispatchCode), Exit);
+  } else {
+    // Have root jump to the target
+    unsigned Code = getExitCode(Target);
+    ReturnInst::Create(C, ConstantInt::get(CodeType, Code), Exit);
+  }
+
+  return Exit;
+}
+
+Function *ShardRootImpl::createRegionFunction(unsigned Region,
+                                              ArrayRef<BasicBlock *> Blocks) {
+  std::vector<BasicBlock *> JumpTargets;
+  uint64_t LowestPC = std::numeric_limits<uint64_t>::max();
+  for (BasicBlock *BB : Blocks) {
+    if (GCBI.getType(BB) == JumpTargetBlock) {
+      JumpTargets.push_back(BB);
+      LowestPC = std::min(LowestPC, getJumpTargetPC(BB));
+    }
+  }
+  revng_assert(JumpTargets.size() != 0);
+
+  auto *RegionType = FunctionType::get(CodeType, false);
+  auto *F = Function::Create(RegionType,
+                             GlobalValue::InternalLinkage,
+                             Twine("region_0x") + Twine::utohexstr(LowestPC),
+                             &M);
+  F->addFnAttr(Attribute::NoInline);
+  if (Root->hasPersonalityFn())
+    F->setPersonalityFn(Root->getPersonalityFn());
+
+  // The local dispatcher
+  auto *Entry = BasicBlock::Create(C, "dispatcher", F);
+
+  // Move the blocks, along with the references to their addresses
+  auto &RootBlocks = Root->getBasicBlockList();
+  for (BasicBlock *BB : Blocks) {
+    BlockAddress *OldAddress = nullptr;
+    if (BB->hasAddressTaken())
+      OldAddress = BlockAddress::get(Root, BB);
+
+    F->getBasicBlockList().splice(F->end(), RootBlocks, BB->getIterator());
+
+    if (OldAddress != nullptr) {
+      OldAddress->replaceAllUsesWith(BlockAddress::get(F, BB));
+      OldAddress->destroyConstant();
+    }
+  }
+
+  IRBuilder<> Builder(Entry);
+  BasicBlock *Default = getExit(F, Dispatcher->getDefaultDest());
+  auto *Switch = Builder.CreateSwitch(Builder.CreateLoad(PCReg),
+                                      Default,
+                                      JumpTargets.size());
+  for (BasicBlock *JumpTarget : JumpTargets) {
+    auto *PC = ConstantInt::get(PCType, getJumpTargetPC(JumpTarget));
+    Switch->addCase(PC, JumpTarget);
+  }
+
+  // Leave the region when jumping out of it or returning from root
+  for (BasicBlock *BB : Blocks) {
+    TerminatorInst *T = BB->getTerminator();
+    if (auto *Return = dyn_cast<ReturnInst>(T)) {
+      replaceReturn(Return);
+      continue;
+    }
+
+    for (unsigned I = 0; I < T->getNumSuccessors(); I++) {
+      BasicBlock *Successor = T->getSuccessor(I);
+      if (regionOf(Successor) != Region)
+        T->setSuccessor(I, getExit(F, Successor));
+    }
+  }
+
+  return F;
+}
+
+void ShardRootImpl::createTrampolines() {
+  DISubprogram *RootSubprogram = Root->getSubprogram();
+
+  // Call the function of the region and handle its exit code
+  std::map<unsigned, BasicBlock *> Trampolines;
+  for (auto &P : Functions) {
+    auto *Trampoline = BasicBlock::Create(C, "", Root);
+    IRBuilder<> Builder(Trampoline);
+    CallInst *Call = Builder.CreateCall(P.second);
+    if (RootSubprogram != nullptr)
+      Call->setDebugLoc(DILocation::get(C, 0, 0, RootSubprogram));
+
+    BasicBlock *DispatcherBlock = Dispatcher->getParent();
+    auto *Switch = Builder.CreateSwitch(Call,
+                                        DispatcherBlock,
+                                        ExitTargets.size());
+    for (unsigned Code = 0; Code < ExitTargets.size(); Code++)
+      if (Code != DispatchCode)
+        Switch->addCase(ConstantInt::get(CodeType, Code), ExitTargets[Code]);
+
+    Trampolines[P.first] = Trampoline;
+  }
+
+  // The dispatcher of root dispatches the jump targets of the regions to their
+  // trampoline, which will in turn dispatch to the jump target
+  for (auto &Case : Dispatcher->cases()) {
+    unsigned Region = regionOf(Case.getCaseSuccessor());
+    if (Region != RootRegion)
+      Case.setSuccessor(Trampolines.at(Region));
+  }
+
+  // The other jumps from root to a region set the PC and go through the
+  // dispatcher
+  DenseMap<BasicBlock *, BasicBlock *> Stubs;
+  std::vector<BasicBlock *> RootBlocks;
+  for (BasicBlock &BB : *Root)
+    RootBlocks.push_back(&BB);
+
+  for (BasicBlock *BB : RootBlocks) {
+    TerminatorInst *T = BB->getTerminator();
+    for (unsigned I = 0; I < T->getNumSuccessors(); I++) {
+      BasicBlock *Successor = T->getSuccessor(I);
+      if (Successor->getParent() == Root)
+        continue;
+
+      BasicBlock *&Stub = Stubs[Successor];
+      if (Stub == nullptr) {
+        Stub = BasicBlock::Create(C, "", Root);
+        auto *PC = ConstantInt::get(PCType, getJumpTargetPC(Successor));
+        new StoreInst(PC, PCReg, Stub);
+        BranchInst::Create(Dispatcher->getParent(), Stub);
+      }
+
+      T->setSuccessor(I, Stub);
+    }
+  }
+}
+
+void ShardRootImpl::moveAllocas() {
+  std::vector<AllocaInst *> Allocas;
+  for (Instruction &I : Root->getEntryBlock())
+    if (auto *Alloca = dyn_cast<AllocaInst>(&I))
+      Allocas.push_back(Alloca);
+
+  for (AllocaInst *Alloca : Allocas) {
+    if (Alloca->use_empty())
+      continue;
+
+    Function *User = cast<Instruction>(*Alloca->user_begin())->getFunction();
+    if (User != Root)
+      Alloca->moveBefore(&*User->getEntryBlock().getFirstInsertionPt());
+  }
+}
+
+void ShardRootImpl::updateDebugInfo() {
+  DISubprogram *RootSubprogram = Root->getSubprogram();
+  if (RootSubprogram == nullptr)
+    return;
+
+  // Give each region a subprogram and move its debug locations there
+  DIBuilder Builder(M, true, RootSubprogram->getUnit());
+  for (auto &P : Functions) {
+    Function *F = P.second;
+    auto *Subprogram = Builder.createFunction(RootSubprogram->getFile(),
+                                              F->getName(),
+                                              StringRef(),
+                                              RootSubprogram->getFile(),
+                                              RootSubprogram->getLine(),
+                                              RootSubprogram->getType(),
+                                              false,
+                                              true,
+                                              RootSubprogram->getScopeLine(),
+                                              DINode::FlagPrototyped,
+                                              false);
+    F->setSubprogram(Subprogram);
+
+    for (BasicBlock &BB : *F) {
+      for (Instruction &I : BB) {
+        const DebugLoc &Location = I.getDebugLoc();
+        if (not Location)
+          continue;
+
+        if (Location->getScope() == RootSubprogram) {
+          I.setDebugLoc(DILocation::get(C,
+                                        Location.getLine(),
+                                        Location.getCol(),
+                                        Subprogram));
+        } else {
+          I.setDebugLoc(DebugLoc());
+        }
+      }
+    }
+  }
+
+  Builder.finalize();
+}
+
+bool ShardRootImpl::run() {
+  for (BasicBlock &BB : *Root) {
+    if (not BB.empty() and GCBI.getType(&BB) == DispatcherBlock) {
+      Dispatcher = cast<SwitchInst>(BB.getTerminator());
+      break;
+    }
+  }
+
+  if (Dispatcher == nullptr)
+    return false;
+
+  assignRegions();
+  mergeInseparable();
+
+  // Collect the blocks of each region, in their original order
+  std::map<unsigned, std::vector<BasicBlock *>> Regions;
+  for (BasicBlock &BB : *Root) {
+    unsigned Region = regionOf(&BB);
+    if (Region != RootRegion)
+      Regions[Region].push_back(&BB);
+  }
+
+  if (Regions.empty())
+    return false;
+
+  getExitCode(Dispatcher->getParent());
+  revng_assert(ExitCodes[Dispatcher->getParent()] == DispatchCode);
+
+  for (auto &P : Regions)
+    Functions[P.first] = createRegionFunction(P.first, P.second);
+
+  createTrampolines();
+  moveAllocas();
+  updateDebugInfo();
+
+  revng_log(Log,
+            "Sharded root in " << Regions.size() << " regions, "
+                               << Root->size() << " blocks left in root");
+
+  return true;
+}
+
+bool ShardRoot::runOnModule(Module &M) {
+  Function *Root = M.getFunction("root");
+  if (Root == nullptr or Root->empty())
+    return false;
+
+  ShardRootImpl Impl(Root, getAnalysis<GeneratedCodeBasicInfo>());
+  return Impl.run();
+}
@@ -266,7 +266,7 @@ void StackAnalysis<AnalyzeABI>::serializeMetadata(Function &F) {
 
   // Apply `func.member.of`
   for (auto &P : MemberOf)
-    P.first->setMetadata("func.member.of", QMD.tuple(P.second));
+    P.first->setMetadata(FunctionMemberOfMDName, QMD.tuple(P.second));
 }
 
 template void StackAnalysis<true>::serializeMetadata(Function &F);
@@ -7,9 +7,13 @@
 
 // Standard includes
 #include <fstream>
+#include <set>
 #include <string>
+#include <utility>
 
 // LLVM includes
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/Instruction.h"
@@ -21,6 +25,7 @@
 // Local libraries includes
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/DebugHelper.h"
+#include "revng/Support/IRHelpers.h"
 
 using namespace llvm;
 
@@ -57,6 +62,92 @@ static StringRef getText(const Instruction *Instruction, unsigned Kind) {
   }
 }
 
+/// \brief Get the ID of the translation and the index of the PTC instruction
+///        associated to \p I, if its "pi" metadata refers to a PTCTable
+static Optional<std::pair<unsigned, unsigned>>
+getPTCReference(const Instruction *I, unsigned Kind) {
+  auto *Node = cast_or_null<MDNode>(I->getMetadata(Kind));
+  if (Node == nullptr or Node->getNumOperands() != 2)
+    return {};
+
+  auto GetInteger = [Node](unsigned OperandIndex) -> Optional<unsigned> {
+    Metadata *Operand = Node->getOperand(OperandIndex).get();
+    if (auto *CAM = dyn_cast_or_null<ConstantAsMetadata>(Operand))
+      if (auto *Value = dyn_cast<ConstantInt>(CAM->getValue()))
+        return Value->getLimitedValue();
+    return {};
+  };
+
+  Optional<unsigned> Index = GetInteger(0);
+  Optional<unsigned> Translation = GetInteger(1);
+  if (not Index or not Translation)
+    return {};
+
+  return std::make_pair(*Translation, *Index);
+}
+
+/// \brief Find the call to newpc marking the original instruction \p I belongs
+///        to
+static const CallInst *getNewPCCall(const Instruction *I) {
+  const BasicBlock *BB = I->getParent();
+  std::set<const BasicBlock *> Visited;
+
+  while (BB != nullptr and Visited.insert(BB).second) {
+    for (; I != nullptr; I = I->getPrevNode())
+      if (isCallTo(I, "newpc"))
+        return cast<CallInst>(I);
+
+    // The translation of an original instruction can span multiple blocks
+    BB = BB->getUniquePredecessor();
+    if (BB != nullptr)
+      I = &BB->back();
+  }
+
+  return nullptr;
+}
+
+/// \brief Get the disassembly of the original instruction associated to \p I
+///
+/// If a PTCTable has been used, the instructions do not have the "oi"
+/// metadata, in this case we obtain the disassembly from the newpc call.
+static StringRef
+getOriginalText(const Instruction *I, unsigned OIKind, unsigned PIKind) {
+  StringRef Result = getText(I, OIKind);
+  if (not Result.empty() or not getPTCReference(I, PIKind))
+    return Result;
+
+  const CallInst *NewPC = getNewPCCall(I);
+  if (NewPC == nullptr)
+    return StringRef();
+
+  auto *Cast = dyn_cast<ConstantExpr>(NewPC->getArgOperand(3));
+  if (Cast == nullptr)
+    return StringRef();
+
+  auto *GV = cast<GlobalVariable>(Cast->getOperand(0));
+  auto *Initializer = GV->getInitializer();
+  return cast<ConstantDataArray>(Initializer)->getAsString().drop_back();
+}
+
+/// \brief Get the text of the PTC instruction associated to \p I, possibly
+///        looking it up in \p Table
+static StringRef
+getPTCText(const Instruction *I, unsigned PIKind, const PTCTable *Table) {
+  auto Reference = getPTCReference(I, PIKind);
+  if (not Reference)
+    return getText(I, PIKind);
+
+  if (Table == nullptr)
+    return StringRef();
+
+  const CallInst *NewPC = getNewPCCall(I);
+  if (NewPC == nullptr)
+    return StringRef();
+
+  uint64_t PC = getLimitedValue(NewPC->getArgOperand(0));
+  return Table->get(PC, Reference->first, Reference->second);
+}
+
 static void
 replaceAll(std::string &Input, const std::string &From, const std::string &To) {
   if (From.empty())
@@ -69,15 +160,16 @@ replaceAll(std::string &Input, const std::string &From, const std::string &To) {
   }
 }
 
-/// Writes the text contained in the metadata with the specified kind ID to the
-/// output stream, unless that metadata is exactly the same as in the previous
-/// instruction.
+using TextGetter = function_ref<StringRef(const Instruction *)>;
+
+/// Writes the text obtained through \p GetText to the output stream, unless it
+/// is exactly the same as in the previous instruction.
 static void writeMetadataIfNew(const Instruction *TheInstruction,
-                               unsigned MDKind,
+                               TextGetter GetText,
                                formatted_raw_ostream &Output,
                                StringRef Prefix) {
   auto BeginIt = TheInstruction->getParent()->begin();
-  StringRef Text = getText(TheInstruction, MDKind);
+  StringRef Text = GetText(TheInstruction);
   if (Text.size()) {
     StringRef LastText;
 
@@ -86,7 +178,7 @@ static void writeMetadataIfNew(const Instruction *TheInstruction,
         TheInstruction = nullptr;
       } else {
         TheInstruction = TheInstruction->getPrevNode();
-        LastText = getText(TheInstruction, MDKind);
+        LastText = GetText(TheInstruction);
       }
     } while (TheInstruction != nullptr && LastText.size() == 0);
 
@@ -108,9 +200,12 @@ static void addModuleFlag(Module *TheModule, StringRef Flag, uint32_t Value) {
 
 using DAW = DebugAnnotationWriter;
 
-DAW::DebugAnnotationWriter(LLVMContext &Context, bool DebugInfo) :
+DAW::DebugAnnotationWriter(LLVMContext &Context,
+                           bool DebugInfo,
+                           const PTCTable *Table) :
   Context(Context),
-  DebugInfo(DebugInfo) {
+  DebugInfo(DebugInfo),
+  Table(Table) {
   OriginalInstrMDKind = Context.getMDKindID("oi");
   PTCInstrMDKind = Context.getMDKindID("pi");
   DbgMDKind = Context.getMDKindID("dbg");
@@ -126,8 +221,14 @@ void DAW::emitInstructionAnnot(const Instruction *Instr,
       or not(FunctionName == "root" or FunctionName.startswith("bb.")))
     return;
 
-  writeMetadataIfNew(Instr, OriginalInstrMDKind, Output, "\n  ; ");
-  writeMetadataIfNew(Instr, PTCInstrMDKind, Output, "\n  ; ");
+  auto GetOriginal = [this](const Instruction *I) {
+    return getOriginalText(I, OriginalInstrMDKind, PTCInstrMDKind);
+  };
+  auto GetPTC = [this](const Instruction *I) {
+    return getPTCText(I, PTCInstrMDKind, Table);
+  };
+  writeMetadataIfNew(Instr, GetOriginal, Output, "\n  ; ");
+  writeMetadataIfNew(Instr, GetPTC, Output, "\n  ; ");
 
   if (DebugInfo) {
     // If DebugInfo is activated the generated LLVM IR textual representation
@@ -158,7 +259,9 @@ DebugHelper::DebugHelper(std::string Output,
   Builder(*TheModule),
   TheModule(TheModule),
   DebugInfo(DebugInfo),
-  DebugPath(DebugPath) {
+  DebugPath(DebugPath),
+  Table(nullptr),
+  TableLoaded(false) {
 
   OriginalInstrMDKind = TheModule->getContext().getMDKindID("oi");
   PTCInstrMDKind = TheModule->getContext().getMDKindID("pi");
@@ -223,9 +326,13 @@ void DebugHelper::generateDebugInfo() {
     // Generate the source file and the debugging information in tandem
 
     unsigned LineIndex = 1;
-    unsigned MetadataKind = DebugInfo == DebugInfoType::PTC ?
-                              PTCInstrMDKind :
-                              OriginalInstrMDKind;
+    const PTCTable *Table = ptcTable();
+    auto GetText = [this, Table](const Instruction *I) {
+      if (DebugInfo == DebugInfoType::PTC)
+        return getPTCText(I, PTCInstrMDKind, Table);
+      else
+        return getOriginalText(I, OriginalInstrMDKind, PTCInstrMDKind);
+    };
 
     StringRef Last;
     std::ofstream Source(DebugPath);
@@ -237,7 +344,7 @@ void DebugHelper::generateDebugInfo() {
       if (DISubprogram *CurrentSubprogram = F.getSubprogram()) {
         for (BasicBlock &Block : F) {
           for (Instruction &Instruction : Block) {
-            StringRef Body = getText(&Instruction, MetadataKind);
+            StringRef Body = GetText(&Instruction);
 
             if (Body.size() != 0 && Last != Body) {
               Last = Body;
@@ -296,6 +403,30 @@ bool DebugHelper::copySource() {
 }
 
 DAW *DebugHelper::annotator(bool DebugInfo) {
-  Annotator.reset(new DAW(TheModule->getContext(), DebugInfo));
+  Annotator.reset(new DAW(TheModule->getContext(), DebugInfo, ptcTable()));
   return Annotator.get();
 }
+
+void DebugHelper::setPTCTable(const PTCTable *NewTable) {
+  Table = NewTable;
+  TableLoaded = true;
+}
+
+const PTCTable *DebugHelper::ptcTable() {
+  if (TableLoaded)
+    return Table;
+
+  TableLoaded = true;
+
+  std::ifstream Input(OutputPath + ".ptc-table");
+  if (not Input.is_open())
+    return nullptr;
+
+  std::unique_ptr<PTCTable> Loaded(new PTCTable);
+  if (not Loaded->load(Input))
+    return nullptr;
+
+  OwnedTable = std::move(Loaded);
+  Table = OwnedTable.get();
+  return Table;
+}
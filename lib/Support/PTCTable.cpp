@@ -0,0 +1,151 @@
+/// \file ptctable.cpp
+/// \brief This file implements the table of the textual representation of the
+///        PTC instructions.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <algorithm>
+#include <sstream>
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+#include "revng/Support/PTCTable.h"
+
+using namespace llvm;
+
+// The serialized table is a line-oriented text file. The first line contains
+// the number of interned strings, excluding the empty string, followed by a
+// line for each of them, with backslashes and newlines escaped. Each of the
+// remaining lines describes a translation of an original instruction: its PC,
+// in hexadecimal, followed by the IDs of the strings of its PTC instructions.
+// The translations of the same PC appear in order of ID.
+
+static void writeEscaped(std::ostream &Output, StringRef Text) {
+  for (char C : Text) {
+    if (C == '\\')
+      Output << "\\\\";
+    else if (C == '\n')
+      Output << "\\n";
+    else
+      Output << C;
+  }
+  Output << "\n";
+}
+
+static std::string unescape(StringRef Text) {
+  std::string Result;
+  Result.reserve(Text.size());
+
+  for (size_t I = 0; I < Text.size(); I++) {
+    if (Text[I] == '\\' and I + 1 < Text.size()) {
+      I++;
+      Result.push_back(Text[I] == 'n' ? '\n' : Text[I]);
+    } else {
+      Result.push_back(Text[I]);
+    }
+  }
+
+  return Result;
+}
+
+unsigned PTCTable::intern(StringRef Text) {
+  if (Text.empty())
+    return 0;
+
+  auto It = StringIDs.find(Text);
+  if (It != StringIDs.end())
+    return It->second;
+
+  unsigned ID = Strings.size();
+  Strings.push_back(Text.str());
+  StringIDs[Text] = ID;
+  return ID;
+}
+
+unsigned PTCTable::add(uint64_t PC, ArrayRef<std::string> Texts) {
+  std::vector<unsigned> IDs;
+  IDs.reserve(Texts.size());
+  for (const std::string &Text : Texts)
+    IDs.push_back(intern(Text));
+
+  // Reuse an identical translation, if any
+  std::vector<std::vector<unsigned>> &Translations = Instructions[PC];
+  auto It = std::find(Translations.begin(), Translations.end(), IDs);
+  if (It != Translations.end())
+    return It - Translations.begin();
+
+  Translations.push_back(std::move(IDs));
+  return Translations.size() - 1;
+}
+
+StringRef
+PTCTable::get(uint64_t PC, unsigned Translation, unsigned Index) const {
+  auto It = Instructions.find(PC);
+  if (It == Instructions.end() or Translation >= It->second.size())
+    return StringRef();
+
+  const std::vector<unsigned> &IDs = It->second[Translation];
+  if (Index >= IDs.size())
+    return StringRef();
+
+  return Strings[IDs[Index]];
+}
+
+void PTCTable::serialize(std::ostream &Output) const {
+  Output << std::dec << Strings.size() - 1 << "\n";
+  for (size_t I = 1; I < Strings.size(); I++)
+    writeEscaped(Output, Strings[I]);
+
+  for (auto &P : Instructions) {
+    for (const std::vector<unsigned> &IDs : P.second) {
+      Output << "0x" << std::hex << P.first << std::dec;
+      for (unsigned ID : IDs)
+        Output << " " << ID;
+      Output << "\n";
+    }
+  }
+}
+
+bool PTCTable::load(std::istream &Input) {
+  Strings.resize(1);
+  StringIDs.clear();
+  Instructions.clear();
+
+  std::string Line;
+  if (not std::getline(Input, Line))
+    return false;
+
+  unsigned long long StringsCount;
+  if (StringRef(Line).getAsInteger(10, StringsCount))
+    return false;
+
+  for (unsigned long long I = 0; I < StringsCount; I++) {
+    if (not std::getline(Input, Line))
+      return false;
+
+    std::string String = unescape(Line);
+    StringIDs[String] = Strings.size();
+    Strings.push_back(std::move(String));
+  }
+
+  while (std::getline(Input, Line)) {
+    std::stringstream Stream(Line);
+    uint64_t PC;
+    if (not(Stream >> std::hex >> PC))
+      return false;
+
+    Instructions[PC].emplace_back();
+    std::vector<unsigned> &IDs = Instructions[PC].back();
+    unsigned ID;
+    while (Stream >> std::dec >> ID) {
+      if (ID >= Strings.size())
+        return false;
+      IDs.push_back(ID);
+    }
+  }
+
+  return true;
+}
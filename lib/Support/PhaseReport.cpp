@@ -0,0 +1,120 @@
+/// \file phasereport.cpp
+/// \brief Implementation of the report of the resources used by each phase
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <chrono>
+#include <iomanip>
+extern "C" {
+#include <sys/resource.h>
+#include <sys/time.h>
+}
+
+// LLVM includes
+#include "llvm/IR/Module.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+#include "revng/Support/PhaseReport.h"
+
+using namespace llvm;
+
+llvm::ManagedStatic<PhaseReport> Phases;
+
+static double toSeconds(const struct timeval &Time) {
+  return Time.tv_sec + Time.tv_usec / 1000000.0;
+}
+
+ResourceUsage ResourceUsage::now() {
+  using namespace std::chrono;
+
+  struct rusage Usage;
+  int Result = getrusage(RUSAGE_SELF, &Usage);
+  revng_assert(Result == 0);
+
+  ResourceUsage Now;
+  auto SinceEpoch = steady_clock::now().time_since_epoch();
+  Now.WallTime = duration_cast<duration<double>>(SinceEpoch).count();
+  Now.CPUTime = toSeconds(Usage.ru_utime) + toSeconds(Usage.ru_stime);
+
+  // On Linux ru_maxrss is expressed in kilobytes
+  Now.PeakRSS = Usage.ru_maxrss;
+
+  return Now;
+}
+
+void PhaseReport::record(StringRef Name,
+                         const ResourceUsage &Begin,
+                         const Module *M) {
+  ResourceUsage End = ResourceUsage::now();
+
+  auto It = PhaseIndex.find(Name);
+  if (It == PhaseIndex.end()) {
+    It = PhaseIndex.insert({ Name, Phases.size() }).first;
+    Phases.push_back({ Name, 0, 0.0, 0.0, 0, false, 0, 0 });
+  }
+
+  Phase &P = Phases[It->second];
+  P.Count++;
+  P.WallTime += End.WallTime - Begin.WallTime;
+  P.CPUTime += End.CPUTime - Begin.CPUTime;
+  P.PeakRSS = End.PeakRSS;
+
+  if (M != nullptr) {
+    P.HasModule = true;
+    P.Instructions = 0;
+    P.BasicBlocks = 0;
+    for (const Function &F : *M) {
+      P.BasicBlocks += F.size();
+      for (const BasicBlock &BB : F)
+        P.Instructions += BB.size();
+    }
+  }
+}
+
+static void writeJSONString(std::ostream &Output, StringRef Text) {
+  Output << '"';
+  for (char C : Text) {
+    if (C == '"' or C == '\\')
+      Output << '\\';
+    Output << C;
+  }
+  Output << '"';
+}
+
+void PhaseReport::serialize(std::ostream &Output) const {
+  ResourceUsage End = ResourceUsage::now();
+
+  Output << std::fixed << std::setprecision(6);
+  Output << "{\n";
+  Output << "  \"wall_time\": " << End.WallTime - Start.WallTime << ",\n";
+  Output << "  \"cpu_time\": " << End.CPUTime - Start.CPUTime << ",\n";
+  Output << "  \"peak_rss_kb\": " << End.PeakRSS << ",\n";
+  Output << "  \"phases\": [";
+
+  const char *Separator = "\n";
+  for (const Phase &P : Phases) {
+    Output << Separator;
+    Output << "    {\n";
+    Output << "      \"name\": ";
+    writeJSONString(Output, P.Name);
+    Output << ",\n";
+    Output << "      \"count\": " << P.Count << ",\n";
+    Output << "      \"wall_time\": " << P.WallTime << ",\n";
+    Output << "      \"cpu_time\": " << P.CPUTime << ",\n";
+    Output << "      \"peak_rss_kb\": " << P.PeakRSS;
+    if (P.HasModule) {
+      Output << ",\n";
+      Output << "      \"instructions\": " << P.Instructions << ",\n";
+      Output << "      \"basic_blocks\": " << P.BasicBlocks;
+    }
+    Output << "\n    }";
+    Separator = ",\n";
+  }
+
+  Output << "\n  ]\n";
+  Output << "}\n";
+}
@@ -367,12 +367,19 @@ void newpc(uint64_t pc,
 bool is_executable(uint64_t pc) {
   assert(segments_count != 0);
 
-  // Check if the pc is inside one of the executable segments
-  for (int i = 0; i < segments_count; i++)
-    if (pc >= segment_boundaries[2 * i] && pc < segment_boundaries[2 * i + 1])
-      return true;
+  // Check if the pc is inside one of the executable segments, which are sorted
+  // and disjoint: find the last one starting at or before pc
+  uint64_t low = 0;
+  uint64_t high = segments_count;
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    if (segment_boundaries[2 * middle] <= pc)
+      low = middle + 1;
+    else
+      high = middle;
+  }
 
-  return false;
+  return low != 0 && pc < segment_boundaries[2 * (low - 1) + 1];
 }
 
 void handle_sigsegv(int signo, siginfo_t *info, void *opaque_context) {
@@ -53,6 +53,23 @@ set(TEST_ARGS_printf_three "one two three")
 set(TEST_RUNS_global "default")
 set(TEST_ARGS_global_default "nope")
 
+# Additional translations of each program, each with its own options for
+# `revng translate`, whose output has to match the native one
+set(TRANSLATION_VARIANTS "sharded" "isolated_sharded")
+set(TRANSLATION_OPTIONS_sharded "--shard-root")
+set(TRANSLATION_OPTIONS_isolated_sharded "-i --shard-root")
+
+# Each layout of the tables of the lowered dispatchers
+foreach(LAYOUT "sorted" "paged" "hierarchical")
+  list(APPEND TRANSLATION_VARIANTS "table_${LAYOUT}")
+  set(TRANSLATION_OPTIONS_table_${LAYOUT} "--table-dispatchers --dispatcher-table ${LAYOUT}")
+endforeach()
+
+# A variant can also forward options to revng-lift, through
+# TRANSLATION_LIFT_OPTIONS_${VARIANT}
+list(APPEND TRANSLATION_VARIANTS "csv_access_threads")
+set(TRANSLATION_LIFT_OPTIONS_csv_access_threads "--csv-access-threads 2")
+
 # Create native executable and tests
 foreach(TEST_NAME ${TESTS})
   # Build the static native version
@@ -205,6 +222,48 @@ foreach(ARCH ${SUPPORTED_ARCHITECTURES})
 
     endforeach()
 
+    foreach(VARIANT ${TRANSLATION_VARIANTS})
+      set(LIFT_OPTIONS "")
+      if(TRANSLATION_LIFT_OPTIONS_${VARIANT})
+        set(LIFT_OPTIONS "-- ${TRANSLATION_LIFT_OPTIONS_${VARIANT}}")
+      endif()
+
+      # Translate the compiled binary with the options of the variant
+      add_test(NAME translate-${VARIANT}-${TEST_NAME}-${ARCH}
+        COMMAND sh -c "cp ${BINARY} ${BINARY}.${VARIANT} && ${CMAKE_BINARY_DIR}/revng translate ${TRANSLATION_OPTIONS_${VARIANT}} ${BINARY}.${VARIANT} ${LIFT_OPTIONS}")
+      set_tests_properties(translate-${VARIANT}-${TEST_NAME}-${ARCH}
+        PROPERTIES LABELS "runtime;translate-${VARIANT};${TEST_NAME};${ARCH}")
+
+      foreach(RUN_NAME ${TEST_RUNS_${TEST_NAME}})
+        # Test to run the program translated with the options of the variant
+        add_test(NAME run-translated-${VARIANT}-test-${TEST_NAME}-${RUN_NAME}-${ARCH}
+          COMMAND sh -c "${BINARY}.${VARIANT}.translated ${TEST_ARGS_${TEST_NAME}_${RUN_NAME}} > ${BINARY}-run-translated-${VARIANT}-test-${RUN_NAME}-${ARCH}.log")
+        set_tests_properties(run-translated-${VARIANT}-test-${TEST_NAME}-${RUN_NAME}-${ARCH}
+          PROPERTIES DEPENDS translate-${VARIANT}-${TEST_NAME}-${ARCH}
+                     LABELS "runtime;run-translated-test;${VARIANT};${TEST_NAME};${RUN_NAME};${ARCH}")
+
+        # Check its output corresponds to the native's one
+        add_test(NAME check-${VARIANT}-with-native-${TEST_NAME}-${RUN_NAME}-${ARCH}
+          COMMAND "${DIFF}" "${BINARY}-run-translated-${VARIANT}-test-${RUN_NAME}-${ARCH}.log" "${CMAKE_CURRENT_BINARY_DIR}/tests/run-test-native-${TEST_NAME}-${RUN_NAME}.log")
+        set(DEPS "")
+        list(APPEND DEPS "run-translated-${VARIANT}-test-${TEST_NAME}-${RUN_NAME}-${ARCH}")
+        list(APPEND DEPS "run-test-native-${TEST_NAME}-${RUN_NAME}")
+        set_tests_properties(check-${VARIANT}-with-native-${TEST_NAME}-${RUN_NAME}-${ARCH}
+          PROPERTIES DEPENDS "${DEPS}"
+                     LABELS "runtime;check-with-native;${VARIANT};${TEST_NAME};${RUN_NAME};${ARCH}")
+
+        # Check its output corresponds to the one of the default translation
+        add_test(NAME check-${VARIANT}-with-default-${TEST_NAME}-${RUN_NAME}-${ARCH}
+          COMMAND "${DIFF}" "${BINARY}-run-translated-${VARIANT}-test-${RUN_NAME}-${ARCH}.log" "${BINARY}-run-translated-test-${RUN_NAME}-${ARCH}.log")
+        set(DEPS "")
+        list(APPEND DEPS "run-translated-${VARIANT}-test-${TEST_NAME}-${RUN_NAME}-${ARCH}")
+        list(APPEND DEPS "run-translated-test-${TEST_NAME}-${RUN_NAME}-${ARCH}")
+        set_tests_properties(check-${VARIANT}-with-default-${TEST_NAME}-${RUN_NAME}-${ARCH}
+          PROPERTIES DEPENDS "${DEPS}"
+                     LABELS "runtime;check-with-default;${VARIANT};${TEST_NAME};${RUN_NAME};${ARCH}")
+      endforeach()
+    endforeach()
+
   endforeach()
 
 endforeach()
@@ -25,6 +25,38 @@ target_link_libraries(test_lazysmallbitvector
   ${LLVM_LIBRARIES})
 add_test(NAME test_lazysmallbitvector COMMAND test_lazysmallbitvector)
 
+#
+# test_intervalindex
+#
+
+add_executable(test_intervalindex "${SRC}/intervalindex.cpp")
+target_include_directories(test_intervalindex
+  PRIVATE "${CMAKE_SOURCE_DIR}"
+          "${Boost_INCLUDE_DIRS}")
+target_compile_definitions(test_intervalindex
+  PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_link_libraries(test_intervalindex
+  revngSupport
+  ${Boost_UNIT_TEST_FRAMEWORK_LIBRARY}
+  ${LLVM_LIBRARIES})
+add_test(NAME test_intervalindex COMMAND test_intervalindex)
+
+#
+# test_addressmap
+#
+
+add_executable(test_addressmap "${SRC}/addressmap.cpp")
+target_include_directories(test_addressmap
+  PRIVATE "${CMAKE_SOURCE_DIR}"
+          "${Boost_INCLUDE_DIRS}")
+target_compile_definitions(test_addressmap
+  PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_link_libraries(test_addressmap
+  revngSupport
+  ${Boost_UNIT_TEST_FRAMEWORK_LIBRARY}
+  ${LLVM_LIBRARIES})
+add_test(NAME test_addressmap COMMAND test_addressmap)
+
 #
 # test_stackanalysis
 #
@@ -92,3 +124,34 @@ target_link_libraries(test_irhelpers
   ${Boost_UNIT_TEST_FRAMEWORK_LIBRARY}
   ${LLVM_LIBRARIES})
 add_test(NAME test_irhelpers COMMAND test_irhelpers)
+
+#
+# test_ptcdecoderpool
+#
+
+# Decode the entry point of the calc runtime test of each architecture
+if(SUPPORTED_ARCHITECTURES)
+  add_executable(test_ptcdecoderpool
+    "${SRC}/ptcdecoderpool.cpp"
+    "${CMAKE_SOURCE_DIR}/tools/revng-lift/BinaryFile.cpp"
+    "${CMAKE_SOURCE_DIR}/tools/revng-lift/PTCDecoderPool.cpp"
+    "${CMAKE_SOURCE_DIR}/tools/revng-lift/PTCDump.cpp"
+    "${CMAKE_SOURCE_DIR}/tools/revng-lift/PTCInterface.cpp")
+  target_include_directories(test_ptcdecoderpool
+    PRIVATE "${CMAKE_SOURCE_DIR}"
+            "${CMAKE_SOURCE_DIR}/tools/revng-lift"
+            "${Boost_INCLUDE_DIRS}")
+  target_compile_definitions(test_ptcdecoderpool
+    PRIVATE "BOOST_TEST_DYN_LINK=1")
+  target_link_libraries(test_ptcdecoderpool
+    dl
+    pthread
+    revngSupport
+    ${Boost_UNIT_TEST_FRAMEWORK_LIBRARY}
+    ${LLVM_LIBRARIES})
+
+  foreach(ARCH ${SUPPORTED_ARCHITECTURES})
+    add_test(NAME test_ptcdecoderpool-${ARCH}
+      COMMAND test_ptcdecoderpool -- "${LIBTINYCODE_${ARCH}}" "${INSTALL_DIR_${ARCH}}/bin/calc")
+  endforeach()
+endif()
@@ -0,0 +1,136 @@
+/// \file addressmap.cpp
+/// \brief Tests for AddressMap
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// Boost includes
+#define BOOST_TEST_MODULE AddressMap
+bool init_unit_test();
+#include <boost/test/unit_test.hpp>
+
+// Local libraries includes
+#include "revng/ADT/AddressMap.h"
+
+BOOST_TEST_DONT_PRINT_LOG_VALUE(std::vector<uint64_t>)
+
+static std::vector<uint64_t> keys(const AddressMap<int> &Map) {
+  std::vector<uint64_t> Result;
+  for (auto &P : Map)
+    Result.push_back(P.first);
+  return Result;
+}
+
+BOOST_AUTO_TEST_CASE(TestEmpty) {
+  AddressMap<int> Empty;
+  BOOST_TEST(Empty.empty());
+  BOOST_TEST(Empty.count(0x1000) == 0U);
+  BOOST_TEST((Empty.find(0x1000) == Empty.end()));
+  BOOST_TEST((Empty.begin() == Empty.end()));
+}
+
+BOOST_AUTO_TEST_CASE(TestInsert) {
+  AddressMap<int> Map;
+  BOOST_TEST(Map.insert({ 0x3000, 3 }).second);
+  BOOST_TEST(Map.insert({ 0x1000, 1 }).second);
+  Map[0x2000] = 2;
+
+  auto Result = Map.insert({ 0x1000, 10 });
+  BOOST_TEST(not Result.second);
+  BOOST_TEST(Result.first->second == 1);
+
+  BOOST_TEST(Map.size() == 3U);
+  BOOST_TEST(Map.at(0x2000) == 2);
+  BOOST_TEST(Map.find(0x3000)->second == 3);
+  BOOST_TEST(Map.count(0x4000) == 0U);
+
+  // Iterating follows the insertion order until the map is sorted
+  BOOST_TEST(not Map.isSorted());
+  std::vector<uint64_t> Expected = { 0x3000, 0x1000, 0x2000 };
+  BOOST_TEST(keys(Map) == Expected);
+
+  Map.sort();
+  BOOST_TEST(Map.isSorted());
+  Expected = { 0x1000, 0x2000, 0x3000 };
+  BOOST_TEST(keys(Map) == Expected);
+
+  // Lookups still work after sorting
+  BOOST_TEST(Map.at(0x1000) == 1);
+  BOOST_TEST(Map.at(0x3000) == 3);
+}
+
+BOOST_AUTO_TEST_CASE(TestErase) {
+  AddressMap<int> Map;
+  for (int I = 1; I <= 5; I++)
+    Map[I * 0x1000] = I;
+
+  BOOST_TEST(Map.erase(0x2000) == 1U);
+  BOOST_TEST(Map.erase(0x2000) == 0U);
+  BOOST_TEST(Map.erase(0x5000) == 1U);
+  BOOST_TEST(Map.count(0x2000) == 0U);
+  BOOST_TEST(Map.at(0x4000) == 4);
+
+  std::vector<uint64_t> Expected = { 0x1000, 0x3000, 0x4000 };
+  BOOST_TEST(keys(Map) == Expected);
+
+  Map[0x2000] = 20;
+  BOOST_TEST(Map.at(0x2000) == 20);
+  Expected = { 0x1000, 0x3000, 0x4000, 0x2000 };
+  BOOST_TEST(keys(Map) == Expected);
+
+  Map.sort();
+  Expected = { 0x1000, 0x2000, 0x3000, 0x4000 };
+  BOOST_TEST(keys(Map) == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(TestIterationDoesNotModify) {
+  AddressMap<int> Map;
+  Map[0x2000] = 2;
+  Map[0x1000] = 1;
+  Map[0x3000] = 3;
+  BOOST_TEST(Map.erase(0x1000) == 1U);
+
+  // Obtaining the end iterator first is fine, and the tombstone is skipped
+  auto End = Map.end();
+  auto Begin = Map.begin();
+  BOOST_TEST(std::distance(Begin, End) == 2);
+  BOOST_TEST(Begin->first == 0x2000U);
+  BOOST_TEST(std::next(Begin)->first == 0x3000U);
+
+  // Iterators still point to the same entries after looking entries up
+  auto It = Map.find(0x3000);
+  BOOST_TEST((It == std::next(Begin)));
+  BOOST_TEST(It->second == 3);
+}
+
+BOOST_AUTO_TEST_CASE(TestEraseKeepsOrder) {
+  AddressMap<int> Map;
+  for (int I = 1; I <= 5; I++)
+    Map[I * 0x1000] = I;
+
+  // Removing an entry doesn't shuffle the others
+  BOOST_TEST(Map.erase(0x1000) == 1U);
+  Map[0x6000] = 6;
+  std::vector<uint64_t> Expected = { 0x2000, 0x3000, 0x4000, 0x5000, 0x6000 };
+  BOOST_TEST(keys(Map) == Expected);
+
+  // Erase and insert again the same address until the tombstones are dropped
+  for (int I = 0; I < 32; I++) {
+    BOOST_TEST(Map.erase(0x6000) == 1U);
+    BOOST_TEST(Map.size() == 4U);
+    BOOST_TEST(Map.count(0x6000) == 0U);
+    Map[0x6000] = I;
+    BOOST_TEST(Map.at(0x6000) == I);
+  }
+
+  BOOST_TEST(Map.size() == 5U);
+  BOOST_TEST(keys(Map) == Expected);
+  BOOST_TEST(Map.at(0x2000) == 2);
+  BOOST_TEST(Map.at(0x6000) == 31);
+}
@@ -0,0 +1,67 @@
+/// \file intervalindex.cpp
+/// \brief Tests for IntervalIndex
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <cstdint>
+#include <vector>
+
+// Boost includes
+#define BOOST_TEST_MODULE IntervalIndex
+bool init_unit_test();
+#include <boost/test/unit_test.hpp>
+
+// Local libraries includes
+#include "revng/ADT/IntervalIndex.h"
+
+using Interval = IntervalIndex::Interval;
+
+BOOST_TEST_DONT_PRINT_LOG_VALUE(std::vector<Interval>)
+
+BOOST_AUTO_TEST_CASE(TestEmpty) {
+  IntervalIndex Empty;
+  BOOST_TEST(Empty.empty());
+  BOOST_TEST(not Empty.contains(0));
+  BOOST_TEST(Empty.find(0x1000) == IntervalIndex::NotFound);
+}
+
+BOOST_AUTO_TEST_CASE(TestDisjoint) {
+  IntervalIndex Index({ { 0x3000, 0x4000 }, { 0x1000, 0x2000 } });
+
+  BOOST_TEST(Index.size() == 2U);
+  BOOST_TEST(Index.lowest() == 0x1000U);
+  BOOST_TEST(Index.highest() == 0x4000U);
+
+  BOOST_TEST(Index.find(0x1000) == 1U);
+  BOOST_TEST(Index.find(0x1fff) == 1U);
+  BOOST_TEST(Index.find(0x3500) == 0U);
+  BOOST_TEST(Index.find(0x0fff) == IntervalIndex::NotFound);
+  BOOST_TEST(Index.find(0x2000) == IntervalIndex::NotFound);
+  BOOST_TEST(Index.find(0x4000) == IntervalIndex::NotFound);
+
+  BOOST_TEST(Index.contains(0x1000, 0x1fff));
+  BOOST_TEST(not Index.contains(0x1000, 0x2000));
+  BOOST_TEST(not Index.contains(0x1800, 0x3800));
+}
+
+BOOST_AUTO_TEST_CASE(TestOverlapping) {
+  IntervalIndex Index({ { 0x1000, 0x5000 }, { 0x2000, 0x3000 } });
+
+  BOOST_TEST(Index.find(0x2500) == 1U);
+  BOOST_TEST(Index.find(0x4000) == 0U);
+  BOOST_TEST(Index.contains(0x2500, 0x4500));
+  BOOST_TEST(not Index.contains(0x2500, 0x5000));
+}
+
+BOOST_AUTO_TEST_CASE(TestMerge) {
+  std::vector<Interval> Merged = IntervalIndex::merge({ { 0x3000, 0x4000 },
+                                                        { 0x1000, 0x2000 },
+                                                        { 0x2000, 0x2800 },
+                                                        { 0x3800, 0x3900 },
+                                                        { 0x5000, 0x5000 } });
+  std::vector<Interval> Expected = { { 0x1000, 0x2800 }, { 0x3000, 0x4000 } };
+  BOOST_TEST(Merged == Expected);
+}
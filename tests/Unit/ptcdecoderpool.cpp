@@ -0,0 +1,85 @@
+/// \file ptcdecoderpool.cpp
+/// \brief Tests for PTCDecoderPool
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+extern "C" {
+#include <dlfcn.h>
+}
+
+// Boost includes
+#define BOOST_TEST_MODULE PTCDecoderPool
+bool init_unit_test();
+#include <boost/test/unit_test.hpp>
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+
+// Local includes
+#include "BinaryFile.h"
+#include "PTCDecoderPool.h"
+#include "PTCDump.h"
+
+PTCInterface ptc = {};
+
+/// \brief Load the main PTC instance, used when no worker is available
+static void loadPTC(const std::string &LibraryPath, const BinaryFile &Binary) {
+  void *LibraryHandle = dlopen(LibraryPath.c_str(), RTLD_LAZY);
+  revng_check(LibraryHandle != nullptr);
+
+  auto PTCLoad = reinterpret_cast<ptc_load_ptr_t>(dlsym(LibraryHandle,
+                                                        "ptc_load"));
+  revng_check(PTCLoad != nullptr);
+  revng_check(PTCLoad(LibraryHandle, &ptc) == 0);
+
+  for (const SegmentInfo &Segment : Binary.segments()) {
+    if (Segment.IsExecutable) {
+      ptc.mmap(Segment.StartVirtualAddress,
+               static_cast<const void *>(Segment.Data.data()),
+               static_cast<size_t>(Segment.Data.size()));
+    }
+  }
+}
+
+static std::string dump(const PTCDecoderPool::DecodedBlock &Block) {
+  std::stringstream Result;
+  Result << Block.ConsumedSize << "\n";
+  dumpTranslation(Result, Block.Instructions.get());
+  return Result.str();
+}
+
+// Usage: test_ptcdecoderpool -- LIBTINYCODE BINARY
+BOOST_AUTO_TEST_CASE(TestWorkersMatchMainInstance) {
+  auto &Suite = boost::unit_test::framework::master_test_suite();
+  BOOST_REQUIRE(Suite.argc == 3);
+  std::string LibraryPath = Suite.argv[1];
+  BinaryFile Binary(Suite.argv[2], 0);
+  loadPTC(LibraryPath, Binary);
+  uint64_t EntryPoint = Binary.entryPoint();
+
+  // Without workers the main instance decodes on the calling thread
+  std::string Expected;
+  {
+    PTCDecoderPool Pool(LibraryPath, Binary, 0);
+    Expected = dump(Pool.decode(EntryPoint));
+  }
+
+  // Have the workers of two pools, each with its own copy of libtinycode,
+  // decode the same block at the same time
+  PTCDecoderPool First(LibraryPath, Binary, 1);
+  PTCDecoderPool Second(LibraryPath, Binary, 1);
+  First.prefetch({ EntryPoint });
+  Second.prefetch({ EntryPoint });
+  First.wait();
+  Second.wait();
+
+  BOOST_TEST(dump(First.decode(EntryPoint)) == Expected);
+  BOOST_TEST(dump(Second.decode(EntryPoint)) == Expected);
+}
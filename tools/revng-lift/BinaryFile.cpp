@@ -44,6 +44,7 @@ static Logger<> LabelsLog("labels");
 const unsigned char R_MIPS_IMPLICIT_RELATIVE = 255;
 
 BinaryFile::BinaryFile(std::string FilePath, uint64_t BaseAddress) :
+  FilePath(FilePath),
   BaseAddress(0) {
   auto BinaryOrErr = object::createBinary(FilePath);
   revng_assert(BinaryOrErr, "Couldn't open the input file");
@@ -298,9 +299,32 @@ BinaryFile::BinaryFile(std::string FilePath, uint64_t BaseAddress) :
     revng_assert("Unexpect address size");
   }
 
+  buildAddressSpaceIndexes();
+
   rebuildLabelsMap();
 }
 
+void BinaryFile::buildAddressSpaceIndexes() {
+  using Interval = IntervalIndex::Interval;
+
+  std::vector<Interval> SegmentRanges;
+  std::vector<Interval> CodeRanges;
+  std::vector<Interval> ExecutableSegmentRanges;
+  for (const SegmentInfo &Segment : Segments) {
+    SegmentRanges.emplace_back(Segment.StartVirtualAddress,
+                               Segment.EndVirtualAddress);
+    Segment.insertExecutableRanges(std::back_inserter(CodeRanges));
+    if (Segment.IsExecutable)
+      ExecutableSegmentRanges.emplace_back(Segment.StartVirtualAddress,
+                                           Segment.EndVirtualAddress);
+  }
+
+  SegmentsIndex = IntervalIndex(SegmentRanges);
+  ExecutableRanges = IntervalIndex(IntervalIndex::merge(CodeRanges));
+  auto MergedSegments = IntervalIndex::merge(ExecutableSegmentRanges);
+  ExecutableSegments = IntervalIndex(MergedSegments);
+}
+
 class FilePortion {
 private:
   bool HasAddress;
@@ -523,6 +547,7 @@ void BinaryFile::parseELF(object::ObjectFile *TheBinary, uint64_t BaseAddress) {
 
       auto ActualAddress = TheELF.base() + ProgramHeader.p_offset;
       Segment.Data = ArrayRef<uint8_t>(ActualAddress, ProgramHeader.p_filesz);
+      Segment.FileOffset = ProgramHeader.p_offset;
 
       // If it's an executable segment, and we've been asked so, register
       // which sections actually contain code
@@ -19,6 +19,7 @@
 #include "llvm/Object/ELFTypes.h"
 
 // Local libraries includes
+#include "revng/ADT/IntervalIndex.h"
 #include "revng/Support/revng.h"
 
 namespace llvm {
@@ -41,7 +42,9 @@ struct SegmentInfo {
   bool IsExecutable;
   bool IsReadable;
   std::vector<std::pair<uint64_t, uint64_t>> ExecutableSections;
-  llvm::ArrayRef<uint8_t> Data;
+  llvm::ArrayRef<uint8_t> Data; ///< \brief Content of the segment in the input
+                                ///  file, might be smaller than size()
+  uint64_t FileOffset; ///< \brief Offset of Data in the input file
 
   bool contains(uint64_t Address) const {
     return StartVirtualAddress <= Address && Address < EndVirtualAddress;
@@ -473,6 +476,7 @@ public:
   //
 
   const Architecture &architecture() const { return TheArchitecture; }
+  const std::string &path() const { return FilePath; }
   std::vector<SegmentInfo> &segments() { return Segments; }
   const std::vector<SegmentInfo> &segments() const { return Segments; }
   const LabelIntervalMap &labels() const { return LabelsMap; }
@@ -517,6 +521,17 @@ public:
 
   uint64_t relocate(uint64_t Address) const { return BaseAddress + Address; }
 
+  /// \brief Index of the ranges of addresses containing code
+  ///
+  /// These are the executable sections, if available and enabled, or the
+  /// executable segments.
+  const IntervalIndex &executableRanges() const { return ExecutableRanges; }
+
+  /// \brief Index of the executable segments, merged where contiguous
+  const IntervalIndex &executableSegments() const {
+    return ExecutableSegments;
+  }
+
 private:
   //
   // ELF-specific methods
@@ -590,23 +605,28 @@ private:
   void rebuildLabelsMap();
 
   SegmentInfo *findSegment(uint64_t Address) {
-    for (SegmentInfo &Segment : Segments)
-      if (Segment.contains(Address))
-        return &Segment;
-    return nullptr;
+    unsigned Index = SegmentsIndex.find(Address);
+    return Index == IntervalIndex::NotFound ? nullptr : &Segments[Index];
   }
 
   const SegmentInfo *findSegment(uint64_t Address) const {
-    for (const SegmentInfo &Segment : Segments)
-      if (Segment.contains(Address))
-        return &Segment;
-    return nullptr;
+    unsigned Index = SegmentsIndex.find(Address);
+    return Index == IntervalIndex::NotFound ? nullptr : &Segments[Index];
   }
 
 private:
+  /// \brief Build the indexes of the address space, once the segments are
+  ///        known
+  void buildAddressSpaceIndexes();
+
+private:
+  std::string FilePath;
   llvm::object::OwningBinary<llvm::object::Binary> BinaryHandle;
   Architecture TheArchitecture;
   std::vector<SegmentInfo> Segments;
+  IntervalIndex SegmentsIndex;
+  IntervalIndex ExecutableRanges;
+  IntervalIndex ExecutableSegments;
   std::vector<std::string> NeededLibraryNames;
   std::set<uint64_t> LandingPads; ///< the set of the landing pad addresses
                                   ///  collected from .eh_frame
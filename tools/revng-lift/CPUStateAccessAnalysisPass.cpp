@@ -7,27 +7,38 @@
 //
 
 // Standard includes
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <sstream>
 #include <stack>
 #include <string>
+#include <thread>
 #include <vector>
 
 // LLVM includes
+#include "llvm/ADT/APInt.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 // Local libraries includes
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/IRHelpers.h"
 
 // Local includes
 #include "CPUStateAccessAnalysisPass.h"
+#include "CSVAccessSummaries.h"
 #include "VariableManager.h"
 
 namespace llvm {
@@ -47,6 +58,20 @@ static auto CSVAccessLog = Logger<>("cpustate-access-analysis");
 /// \brief Logger for fixing the accesses to CPUState
 static auto FixAccessLog = Logger<>("cpustate-fix-access");
 
+static cl::opt<unsigned> CSVAccessThreads("csv-access-threads",
+                                          cl::desc("number of additional "
+                                                   "threads analyzing the "
+                                                   "accesses to the CPU "
+                                                   "state"),
+                                          cl::value_desc("threads"),
+                                          cl::cat(MainCategory),
+                                          cl::init(0));
+
+/// \brief Serializes the constant folding performed by the offset folders
+///
+/// Folding creates constants in the LLVMContext, which is not thread-safe.
+static std::mutex FoldMutex;
+
 static uint64_t NumUnknown = 0;
 static std::map<std::string, uint64_t> FunToNumUnknown;
 static std::map<std::string, std::set<std::string>> FunToUnknowns;
@@ -1093,18 +1118,14 @@ private:
                          const SmallVector<offset_iterator, 4> &OffsetsIt) {
     auto OpCode = I->getOpcode();
     revng_assert(OpCode == Instruction::Add or OpCode == Instruction::Sub);
-    SmallVector<Constant *, 4> Operands(NumSrcs, nullptr);
-    // Setup operands
-    for (WorkItem::size_type SI = 0; SI < NumSrcs; ++SI) {
-      const int64_t O = *OffsetsIt[SI];
-      Operands[SI] = ConstantInt::get(Int64Ty, APInt(64, O, true));
-    }
-    // Constant fold the operation with the selected operands
-    ArrayRef<Constant *> TmpOp(Operands);
-    Constant *Res = ConstantFoldInstOperands(I, TmpOp, DL);
-    ConstantInt *R = cast<ConstantInt>(Res);
-    const int64_t ResO = R->getSExtValue();
-    return CSVOffsets(ResultKind, ResO);
+    revng_assert(NumSrcs == 2);
+
+    // Fold the operation on 64-bit integers, as constant folding would, but
+    // without creating constants
+    APInt O0(64, *OffsetsIt[0], true);
+    APInt O1(64, *OffsetsIt[1], true);
+    APInt Res = OpCode == Instruction::Add ? O0 + O1 : O0 - O1;
+    return CSVOffsets(ResultKind, Res.getSExtValue());
   }
 };
 
@@ -1244,6 +1265,7 @@ private:
                          const SmallVector<offset_iterator, 4> &OffsetsIt) {
     const auto *GEP = cast<const GetElementPtrInst>(I);
     const auto PtrOpTy = GEP->getPointerOperand()->getType();
+    std::lock_guard<std::mutex> Lock(FoldMutex);
     SmallVector<Constant *, 4> Operands(NumSrcs, nullptr);
     // Setup operands
     int64_t PtrOp = *OffsetsIt[0];
@@ -1303,7 +1325,55 @@ private:
                  or OpCode == Instruction::LShr or OpCode == Instruction::Mul
                  or OpCode == Instruction::URem or OpCode == Instruction::SRem
                  or OpCode == Instruction::SDiv or OpCode == Instruction::UDiv);
+    revng_assert(NumSrcs == 2);
+
+    // Fold the operation on 64-bit integers without creating constants, unless
+    // its result is undefined
+    APInt O0(64, *OffsetsIt[0], true);
+    APInt O1(64, *OffsetsIt[1], true);
+    bool IsShift = OpCode == Instruction::Shl or OpCode == Instruction::AShr
+                   or OpCode == Instruction::LShr;
+    bool IsDivision = OpCode == Instruction::URem or OpCode == Instruction::SRem
+                      or OpCode == Instruction::SDiv
+                      or OpCode == Instruction::UDiv;
+    bool IsSigned = OpCode == Instruction::SRem or OpCode == Instruction::SDiv;
+    bool Overflows = IsSigned and O0.isMinSignedValue() and O1.isAllOnesValue();
+    bool IsUndefined = (IsShift and O1.uge(64))
+                       or (IsDivision and (O1 == 0 or Overflows));
+    if (not IsUndefined) {
+      APInt Res;
+      switch (OpCode) {
+      case Instruction::Shl:
+        Res = O0.shl(O1.getZExtValue());
+        break;
+      case Instruction::AShr:
+        Res = O0.ashr(O1.getZExtValue());
+        break;
+      case Instruction::LShr:
+        Res = O0.lshr(O1.getZExtValue());
+        break;
+      case Instruction::Mul:
+        Res = O0 * O1;
+        break;
+      case Instruction::URem:
+        Res = O0.urem(O1);
+        break;
+      case Instruction::SRem:
+        Res = O0.srem(O1);
+        break;
+      case Instruction::SDiv:
+        Res = O0.sdiv(O1);
+        break;
+      case Instruction::UDiv:
+        Res = O0.udiv(O1);
+        break;
+      default:
+        revng_abort();
+      }
+      return CSVOffsets(ResultKind, Res.getSExtValue());
+    }
 
+    std::lock_guard<std::mutex> Lock(FoldMutex);
     SmallVector<Constant *, 4> Operands(NumSrcs, nullptr);
     // Setup operands
     for (WorkItem::size_type SI = 0; SI < NumSrcs; ++SI) {
@@ -1380,7 +1450,7 @@ public:
     LoadOffsets(LoadOff),
     StoreOffsets(StoreOff),
     CallSiteLoadOffsets(CallSiteLoadOff),
-    CallSiteStoreOffsets(CallSiteLoadOff),
+    CallSiteStoreOffsets(CallSiteStoreOff),
     ValueCallSiteOffsets(),
     LoadCallSiteOffsets(),
     StoreCallSiteOffsets(),
@@ -1394,6 +1464,16 @@ public:
 public:
   bool run();
 
+  /// \brief Analyzes all the tainted accesses, without aggregating the results
+  ///
+  /// The results, for each access and for each call site in root, can be
+  /// obtained through getCallSiteOffsets.
+  void analyze();
+
+  const ValueCallSiteOffsetMap &getCallSiteOffsets(bool IsLoad) const {
+    return IsLoad ? LoadCallSiteOffsets : StoreCallSiteOffsets;
+  }
+
 private:
   void cleanup() {
     ValueCallSiteOffsets = {};
@@ -1414,6 +1494,13 @@ private:
   /// all the immediate sources are already resolved.
   void analyzeAccess(Instruction *I, bool IsLoad);
 
+  /// \brief Analyzes the accesses in groups, each one from scratch, on
+  ///        multiple threads
+  ///
+  /// The accesses are grouped by the function performing them, since those in
+  /// the same function share most of the values to explore.
+  void analyzeInParallel();
+
   /// \brief Explores the sources of `V` and pushes a `WorkItem` on `WorkList`
   ///        if something new is found
   /// \param V is the `Value` whose sources are analyzed
@@ -2025,6 +2112,73 @@ void CPUSAOA::analyzeAccess(Instruction *LoadOrStore, bool IsLoad) {
   }
 }
 
+/// \brief Gets the number of bytes accessed by \p I, a load, a store or a call
+///        to Intrinsic::memcpy
+static int64_t
+getAccessSize(Instruction *I, bool IsLoad, const DataLayout &DL) {
+  int64_t AccessSize;
+  if (callsBuiltinMemcpy(I)) {
+    auto Call = cast<CallInst>(I);
+    auto SizeParam = cast<ConstantInt>(Call->getArgOperand(2));
+    AccessSize = SizeParam->getSExtValue();
+  } else if (IsLoad) {
+    auto *Load = cast<LoadInst>(I);
+    auto *PtrTy = cast<PointerType>(Load->getPointerOperand()->getType());
+    Type *LoadedType = PtrTy->getElementType();
+    AccessSize = DL.getTypeAllocSize(LoadedType);
+  } else {
+    auto Store = cast<StoreInst>(I);
+    auto *PtrTy = cast<PointerType>(Store->getPointerOperand()->getType());
+    Type *StoredType = PtrTy->getElementType();
+    AccessSize = DL.getTypeAllocSize(StoredType);
+  }
+  revng_assert(AccessSize != 0);
+  return AccessSize;
+}
+
+/// \brief Computes the offsets of the CSVs that might be touched by an access
+///        of \p AccessSize bytes at the coarse offsets \p O
+///
+/// When we collapse on a call site, we lose the information on the specific
+/// instruction that caused a given offset to be computed, hence also losing the
+/// size of the access. For this reason here we have to take into account the
+/// size of the access.
+static CSVOffsets refineOffsets(const CSVOffsets &O,
+                                int64_t AccessSize,
+                                VariableManager *Variables,
+                                const DataLayout &DL) {
+  if (not O.hasOffsetSet())
+    return O;
+
+  revng_assert(O.size());
+  std::set<int64_t> FineGrainedOffsets;
+  // Now compute the fine-grained offsets
+  for (const int64_t Coarse : O) {
+    int64_t Refined = Coarse;
+    int64_t End = Coarse + AccessSize;
+    while (Refined < End) {
+      unsigned InternalOffset = 0;
+      GlobalVariable *AccessedVar;
+      std::tie(AccessedVar,
+               InternalOffset) = Variables->getByEnvOffset(Refined);
+      int64_t SizeAtOffset = 0;
+      if (AccessedVar != nullptr) {
+        Type *AccessedTy = AccessedVar->getType();
+        SizeAtOffset = DL.getTypeAllocSize(AccessedTy) - InternalOffset;
+        revng_assert(SizeAtOffset > 0);
+        FineGrainedOffsets.insert(Refined - InternalOffset);
+        CSVAccessLog << "Insert Refined: " << Refined << DoLog;
+      } else {
+        // Skip padding one byte at a time, without adding offsets
+        SizeAtOffset = 1;
+      }
+      revng_assert(SizeAtOffset != 0);
+      Refined += SizeAtOffset;
+    }
+  }
+  return CSVOffsets(O.getKind(), FineGrainedOffsets);
+}
+
 template<bool IsLoad>
 void CPUSAOA::computeAggregatedOffsets() {
   const InstrPtrSet &Tainted = IsLoad ? TaintedAccesses.TaintedLoads :
@@ -2034,11 +2188,11 @@ void CPUSAOA::computeAggregatedOffsets() {
   CallSiteOffsetMap &CallSiteOffsets = IsLoad ? CallSiteLoadOffsets :
                                                 CallSiteStoreOffsets;
   AccessOffsetMap &AccessOffsets = IsLoad ? LoadOffsets : StoreOffsets;
+  const DataLayout &DL = M.getDataLayout();
 
   for (std::pair<Value *const, CallSiteOffsetMap> &ACSO : AccessCSOffsets) {
 
     Value *I = ACSO.first;
-    auto DL = M.getDataLayout();
 
     bool isInstr = isa<Instruction>(I);
     bool isCorrectAccessType = IsLoad ? isa<LoadInst>(I) : isa<StoreInst>(I);
@@ -2047,23 +2201,7 @@ void CPUSAOA::computeAggregatedOffsets() {
     auto *Instr = dyn_cast<Instruction>(I);
     revng_assert(Tainted.count(Instr) != 0);
 
-    int64_t AccessSize;
-    if (isCallToBuiltinMemcpy) {
-      auto Call = cast<CallInst>(I);
-      auto SizeParam = cast<ConstantInt>(Call->getArgOperand(2));
-      AccessSize = SizeParam->getSExtValue();
-    } else if (IsLoad) {
-      auto *Load = cast<LoadInst>(Instr);
-      auto *PtrTy = cast<PointerType>(Load->getPointerOperand()->getType());
-      Type *LoadedType = PtrTy->getElementType();
-      AccessSize = DL.getTypeAllocSize(LoadedType);
-    } else {
-      auto Store = cast<StoreInst>(Instr);
-      auto *PtrTy = cast<PointerType>(Store->getPointerOperand()->getType());
-      Type *StoredType = PtrTy->getElementType();
-      AccessSize = DL.getTypeAllocSize(StoredType);
-    }
-    revng_assert(AccessSize != 0);
+    int64_t AccessSize = getAccessSize(Instr, IsLoad, DL);
 
     CallSiteOffsetMap &CallSiteMap = ACSO.second;
     for (std::pair<CallInst *const, CSVOffsets> &CSO : CallSiteMap) {
@@ -2084,63 +2222,98 @@ void CPUSAOA::computeAggregatedOffsets() {
 
       // Compute CallSiteOffsets, i.e. the set of offsets that might be accessed
       // from a given call in root.
-      // This is a little more tricky than computing AccessOffsets, since here,
-      // when we collapse on the call site, we lose the information on the
-      // specific instruction that caused a given offset to be computed, hence
-      // also losing the size of the access. For this reason here we have to
-      // take into account the sizes of all the accesses.
       {
-        OptCSVOffsets New;
-        if (not O.hasOffsetSet()) {
-          New = O;
-        } else {
-          revng_assert(O.size());
-          std::set<int64_t> FineGrainedOffsets;
-          // Now compute the fine-grained offsets
-          for (const int64_t Coarse : O) {
-            int64_t Refined = Coarse;
-            int64_t End = Coarse + AccessSize;
-            while (Refined < End) {
-              unsigned InternalOffset = 0;
-              GlobalVariable *AccessedVar;
-              std::tie(AccessedVar,
-                       InternalOffset) = Variables->getByEnvOffset(Refined);
-              int64_t SizeAtOffset = 0;
-              if (AccessedVar != nullptr) {
-                Type *AccessedTy = AccessedVar->getType();
-                SizeAtOffset = DL.getTypeAllocSize(AccessedTy) - InternalOffset;
-                revng_assert(SizeAtOffset > 0);
-                FineGrainedOffsets.insert(Refined - InternalOffset);
-                CSVAccessLog << "Value: " << I << DoLog;
-                CSVAccessLog << "Insert Refined: " << Refined << DoLog;
-              } else {
-                // Skip padding one byte at a time, without adding offsets
-                SizeAtOffset = 1;
-              }
-              revng_assert(SizeAtOffset != 0);
-              Refined += SizeAtOffset;
-            }
-          }
-          New = CSVOffsets(O.getKind(), FineGrainedOffsets);
-        }
+        CSVAccessLog << "Value: " << I << DoLog;
+        CSVOffsets New = refineOffsets(O, AccessSize, Variables, DL);
         // Finally insert them or combine them
         CallSiteOffsetMap::iterator CallOffsetIt;
         std::tie(CallOffsetIt,
-                 Inserted) = CallSiteOffsets.insert({ Call, New.getValue() });
+                 Inserted) = CallSiteOffsets.insert({ Call, New });
         if (not Inserted)
-          CallOffsetIt->second.combine(New.getValue());
+          CallOffsetIt->second.combine(New);
       }
     }
   }
 }
 
-bool CPUSAOA::run() {
+void CPUSAOA::analyzeInParallel() {
+  struct AccessGroup {
+    std::vector<Instruction *> Loads;
+    std::vector<Instruction *> Stores;
+  };
+
+  std::vector<AccessGroup> Groups;
+  std::map<const Function *, size_t> GroupIndex;
+  auto GroupOf = [&Groups, &GroupIndex](Instruction *I) -> AccessGroup & {
+    auto Result = GroupIndex.insert({ I->getFunction(), Groups.size() });
+    if (Result.second)
+      Groups.emplace_back();
+    return Groups[Result.first->second];
+  };
 
-  // Analyze load and store
   for (Instruction *I : TaintedAccesses.TaintedLoads)
-    analyzeAccess(I, true);
+    GroupOf(I).Loads.push_back(I);
   for (Instruction *I : TaintedAccesses.TaintedStores)
-    analyzeAccess(I, false);
+    GroupOf(I).Stores.push_back(I);
+
+  // Each group has its own analysis, so that the results do not depend on the
+  // number of threads. The accesses of distinct groups are disjoint, and so
+  // are the keys of their results.
+  using ValueCallSiteOffsetMaps = std::pair<ValueCallSiteOffsetMap,
+                                            ValueCallSiteOffsetMap>;
+  std::vector<ValueCallSiteOffsetMaps> Results(Groups.size());
+  std::atomic<size_t> NextGroup(0);
+  auto Work = [this, &Groups, &Results, &NextGroup]() {
+    for (size_t I = NextGroup++; I < Groups.size(); I = NextGroup++) {
+      CPUSAOA Group(M,
+                    CPUStatePtr,
+                    RootFunction,
+                    ReachableFunctions,
+                    TaintedAccesses,
+                    Variables,
+                    LoadOffsets,
+                    StoreOffsets,
+                    CallSiteLoadOffsets,
+                    CallSiteStoreOffsets);
+
+      for (Instruction *Load : Groups[I].Loads)
+        Group.analyzeAccess(Load, true);
+      for (Instruction *Store : Groups[I].Stores)
+        Group.analyzeAccess(Store, false);
+
+      Results[I] = { std::move(Group.LoadCallSiteOffsets),
+                     std::move(Group.StoreCallSiteOffsets) };
+    }
+  };
+
+  std::vector<std::thread> Workers;
+  for (unsigned I = 0; I < CSVAccessThreads; I++)
+    Workers.emplace_back(Work);
+  Work();
+
+  for (std::thread &Worker : Workers)
+    Worker.join();
+
+  for (ValueCallSiteOffsetMaps &Result : Results) {
+    LoadCallSiteOffsets.insert(std::make_move_iterator(Result.first.begin()),
+                               std::make_move_iterator(Result.first.end()));
+    StoreCallSiteOffsets.insert(std::make_move_iterator(Result.second.begin()),
+                                std::make_move_iterator(Result.second.end()));
+  }
+}
+
+void CPUSAOA::analyze() {
+
+  // Analyze load and store. Loggers are not thread-safe, so keep a single
+  // thread if the analysis has to be logged
+  if (CSVAccessThreads != 0 and not CSVAccessLog.isEnabled()) {
+    analyzeInParallel();
+  } else {
+    for (Instruction *I : TaintedAccesses.TaintedLoads)
+      analyzeAccess(I, true);
+    for (Instruction *I : TaintedAccesses.TaintedStores)
+      analyzeAccess(I, false);
+  }
 
   if (CSVAccessLog.isEnabled()) {
     TaintLog << "== ACCESS ANALYSIS RESULTS ==\n";
@@ -2181,6 +2354,10 @@ bool CPUSAOA::run() {
   // across different calls to analyzeAccess to optimize the runtime avoiding
   // multiple iterations on the same Values.
   ValueCallSiteOffsets = {};
+}
+
+bool CPUSAOA::run() {
+  analyze();
 
   // Aggregate the results:
   // - from LoadCallSiteOffsets to CallSiteLoadOffsets and LoadOffsets
@@ -2209,10 +2386,16 @@ private:
   AccessOffsetMap CSVLoadOffsetMap;
   AccessOffsetMap CSVStoreOffsetMap;
 
+  // Precomputed results on the helpers, might be nullptr
+  const CSVAccessSummaries *Summaries;
+
 public:
-  CPUStateAccessAnalysis(const Module &Mod, VariableManager *V) :
+  CPUStateAccessAnalysis(const Module &Mod,
+                         VariableManager *V,
+                         const CSVAccessSummaries *Summaries) :
     M(Mod),
     Variables(V),
+    Summaries(Summaries),
     EnvStructType(V->getCPUStateType()),
     DL(Mod.getDataLayout()),
     EnvStructSize(DL.getTypeAllocSize(EnvStructType)),
@@ -2226,6 +2409,16 @@ public:
   bool run();
 
 private:
+  /// \brief Uses the summaries to compute the offsets accessed by the tainted
+  ///        accesses in the helpers, removing them from \p ToAnalyze
+  ///
+  /// \return true if at least an access has been handled.
+  bool applySummaries(const Function *RootFunction,
+                      const ConstFunctionPtrSet &Reached,
+                      TaintResults &ToAnalyze,
+                      CallSiteOffsetMap &CallSiteLoad,
+                      CallSiteOffsetMap &CallSiteStore);
+
   template<bool IsLoad>
   std::tuple<Instruction *, Type *, Value *>
   setupOutEnvAccess(Instruction *AccessToFix);
@@ -2862,6 +3055,218 @@ void CPUStateAccessAnalysis::correctCPUStateAccesses() {
   }
 }
 
+/// \brief Checks that \p F is only used by direct calls satisfying \p Predicate
+///
+/// Returns false if \p F has other uses, since it might be called indirectly.
+static bool
+onlyDirectCalls(const Function *F,
+                function_ref<bool(const CallInst *)> Predicate) {
+  std::vector<const Value *> WorkList = { F };
+  while (not WorkList.empty()) {
+    const Value *Current = WorkList.back();
+    WorkList.pop_back();
+    for (const User *TheUser : Current->users()) {
+      if (const auto *Call = dyn_cast<CallInst>(TheUser)) {
+        if (getCallee(Call) != F or not Predicate(Call))
+          return false;
+      } else if (const auto *CExpr = dyn_cast<ConstantExpr>(TheUser)) {
+        if (not CExpr->isCast())
+          return false;
+        WorkList.push_back(CExpr);
+      } else {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template<typename K>
+static void
+insertOrCombine(std::map<K, CSVOffsets> &Map, K Key, const CSVOffsets &O) {
+  auto It = Map.find(Key);
+  if (It == Map.end())
+    Map.insert({ Key, O });
+  else
+    It->second.combine(O);
+}
+
+bool CPUStateAccessAnalysis::applySummaries(const Function *RootFunction,
+                                            const ConstFunctionPtrSet &Reached,
+                                            TaintResults &ToAnalyze,
+                                            CallSiteOffsetMap &CallSiteLoad,
+                                            CallSiteOffsetMap &CallSiteStore) {
+  using FunctionSummary = CSVAccessSummaries::FunctionSummary;
+  using HelperOffsets = CSVAccessSummaries::HelperOffsets;
+
+  // Collect the calls in root that are identical to those used to compute the
+  // summaries: `env` must be passed exactly where the summary of the helper
+  // expects it, and all the other arguments must be loads, since, as the
+  // values used for the summaries, they don't provide any offset.
+  std::map<StringRef, std::vector<CallInst *>> SummarizedCalls;
+  std::set<const CallInst *> IsSummarized;
+  for (User *EnvUser : CPUStatePtr->users()) {
+    auto *LoadEnv = dyn_cast<LoadInst>(EnvUser);
+    if (LoadEnv == nullptr or LoadEnv->getFunction() != RootFunction)
+      continue;
+
+    for (User *LoadUser : LoadEnv->users()) {
+      auto *Call = dyn_cast<CallInst>(LoadUser);
+      if (Call == nullptr or IsSummarized.count(Call) != 0)
+        continue;
+
+      const Function *Callee = getCallee(Call);
+      if (Callee == nullptr)
+        continue;
+
+      StringRef Name = Callee->getName();
+      const uint64_t *EnvArguments = Summaries->getEnvArguments(Name);
+      if (EnvArguments == nullptr or Call->getNumArgOperands() > 64)
+        continue;
+
+      bool Matches = true;
+      for (unsigned ArgNo = 0; ArgNo < Call->getNumArgOperands(); ArgNo++) {
+        auto *Load = dyn_cast<LoadInst>(Call->getArgOperand(ArgNo));
+        bool IsEnv = Load != nullptr
+                     and Load->getPointerOperand() == CPUStatePtr;
+        bool ExpectsEnv = (*EnvArguments >> ArgNo) & 1;
+        if (Load == nullptr or IsEnv != ExpectsEnv) {
+          Matches = false;
+          break;
+        }
+      }
+
+      if (Matches) {
+        SummarizedCalls[Name].push_back(Call);
+        IsSummarized.insert(Call);
+      }
+    }
+  }
+
+  // Start from all the reached functions that didn't change since the
+  // summaries have been computed
+  std::map<const Function *, const FunctionSummary *> Covered;
+  for (const Function *F : Reached) {
+    if (F == RootFunction or F->empty())
+      continue;
+
+    if (const FunctionSummary *Summary = Summaries->getFunction(*F))
+      Covered[F] = Summary;
+  }
+
+  // Find the summary of each tainted access in the candidate functions, and
+  // drop the functions with tainted accesses the summaries don't know about
+  using Access = std::pair<Instruction *, bool>;
+  std::map<const Function *, std::vector<Access>> Accesses;
+  for (Instruction *I : ToAnalyze.TaintedLoads)
+    if (Covered.count(I->getFunction()) != 0)
+      Accesses[I->getFunction()].push_back({ I, true });
+  for (Instruction *I : ToAnalyze.TaintedStores)
+    if (Covered.count(I->getFunction()) != 0)
+      Accesses[I->getFunction()].push_back({ I, false });
+
+  std::map<Access, const std::vector<HelperOffsets> *> AccessSummaries;
+  for (auto &P : Accesses) {
+    const Function *F = P.first;
+    const FunctionSummary *Summary = Covered.at(F);
+
+    std::map<const Instruction *, unsigned> Indexes;
+    for (const Access &A : P.second)
+      Indexes[A.first] = 0;
+    unsigned Index = 0;
+    for (const Instruction &I : instructions(F)) {
+      auto It = Indexes.find(&I);
+      if (It != Indexes.end())
+        It->second = Index;
+      Index++;
+    }
+
+    for (const Access &A : P.second) {
+      const auto &Map = A.second ? Summary->Loads : Summary->Stores;
+      auto It = Map.find(Indexes.at(A.first));
+      if (It == Map.end()) {
+        Covered.erase(F);
+        break;
+      }
+      AccessSummaries[A] = &It->second;
+    }
+  }
+
+  // A summary is valid only if the function is reached exclusively through
+  // summarized calls in root and functions whose summary is valid
+  auto IsCoveredCall = [&](const CallInst *Call) {
+    const Function *Caller = Call->getFunction();
+    if (Reached.count(Caller) == 0)
+      return true;
+    if (Caller == RootFunction)
+      return IsSummarized.count(Call) != 0;
+    return Covered.count(Caller) != 0;
+  };
+
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (auto It = Covered.begin(); It != Covered.end();) {
+      if (onlyDirectCalls(It->first, IsCoveredCall)) {
+        ++It;
+      } else {
+        It = Covered.erase(It);
+        Changed = true;
+      }
+    }
+  }
+
+  // Fill the results for the accesses in the covered functions, and remove
+  // them from the accesses that the CPUSAOA has to analyze
+  unsigned Applied = 0;
+  for (auto &P : AccessSummaries) {
+    Instruction *I = P.first.first;
+    bool IsLoad = P.first.second;
+    if (Covered.count(I->getFunction()) == 0)
+      continue;
+
+    AccessOffsetMap &AccessOffsets = IsLoad ? CSVLoadOffsetMap :
+                                              CSVStoreOffsetMap;
+    CallSiteOffsetMap &CallSiteOffsets = IsLoad ? CallSiteLoad : CallSiteStore;
+    int64_t AccessSize = getAccessSize(I, IsLoad, DL);
+
+    bool Found = false;
+    for (const HelperOffsets &Entry : *P.second) {
+      if (Entry.Helper.empty()) {
+        insertOrCombine(AccessOffsets, I, Entry.Offsets);
+        Found = true;
+        continue;
+      }
+
+      auto It = SummarizedCalls.find(Entry.Helper);
+      if (It == SummarizedCalls.end())
+        continue;
+
+      CSVOffsets Refined = refineOffsets(Entry.Offsets,
+                                         AccessSize,
+                                         Variables,
+                                         DL);
+      for (CallInst *Call : It->second) {
+        insertOrCombine(AccessOffsets, I, Entry.Offsets);
+        insertOrCombine(CallSiteOffsets, Call, Refined);
+        Found = true;
+      }
+    }
+
+    // Let the CPUSAOA handle accesses for which we found nothing
+    if (Found) {
+      InstrPtrSet &Tainted = IsLoad ? ToAnalyze.TaintedLoads :
+                                      ToAnalyze.TaintedStores;
+      Tainted.erase(I);
+      Applied++;
+    }
+  }
+
+  CSVAccessLog << "Accesses handled by the summaries: " << Applied << DoLog;
+
+  return Applied != 0;
+}
+
 bool CPUStateAccessAnalysis::run() {
 
   if (CPUStatePtr == nullptr)
@@ -2912,17 +3317,29 @@ bool CPUStateAccessAnalysis::run() {
 
   CallSiteOffsetMap CallSiteLoadOffset;
   CallSiteOffsetMap CallSiteStoreOffset;
+
+  // Use the precomputed results for the accesses in the helpers, if possible,
+  // and analyze only the remaining ones
+  auto ToAnalyze = TaintResults;
+  bool Summarized = false;
+  if (Summaries != nullptr)
+    Summarized = applySummaries(RootFunction,
+                                ReachedFunctions,
+                                ToAnalyze,
+                                CallSiteLoadOffset,
+                                CallSiteStoreOffset);
+
   auto AccessOffsetAnalysis = CPUSAOA(M,
                                       CPUStatePtr,
                                       RootFunction,
                                       ReachedFunctions,
-                                      TaintResults,
+                                      ToAnalyze,
                                       Variables,
                                       CSVLoadOffsetMap,
                                       CSVStoreOffsetMap,
                                       CallSiteLoadOffset,
                                       CallSiteStoreOffset);
-  bool Found = AccessOffsetAnalysis.run();
+  bool Found = AccessOffsetAnalysis.run() or Summarized;
   LLVMContext &Context = M.getContext();
   QuickMetadata QMD(Context);
   if (Found) {
@@ -2961,8 +3378,180 @@ bool CPUStateAccessAnalysis::run() {
   return Found;
 }
 
+void computeCSVAccessSummaries(const Module &HelpersModule,
+                               CSVAccessSummaries &Summaries) {
+  // Work on a copy, the synthetic root function must not end up in the helpers
+  std::unique_ptr<Module> M = CloneModule(HelpersModule);
+  LLVMContext &Context = M->getContext();
+  IntegerType *PointerIntTy = M->getDataLayout().getIntPtrType(Context);
+
+  // Elect the type of the CPU state as the VariableManager does: the structure
+  // most frequently pointed by the arguments of the helpers
+  using ElectionMap = std::map<StructType *, unsigned>;
+  using ElectionMapElement = std::pair<StructType *const, unsigned>;
+  ElectionMap EnvElection;
+  for (Function &F : *M) {
+    FunctionType *HelperType = F.getFunctionType();
+    if (not F.getName().startswith("helper_")
+        or HelperType->getNumParams() <= 1)
+      continue;
+
+    for (Type *Param : HelperType->params()) {
+      if (not Param->isPointerTy())
+        continue;
+      auto *EnvType = dyn_cast<StructType>(Param->getPointerElementType());
+      if (EnvType != nullptr and EnvType->getNumElements() > 1)
+        EnvElection[EnvType]++;
+    }
+  }
+
+  if (EnvElection.empty())
+    return;
+
+  auto Compare = [](ElectionMapElement &It1, ElectionMapElement &It2) {
+    return It1.second < It2.second;
+  };
+  auto Max = std::max_element(EnvElection.begin(), EnvElection.end(), Compare);
+  StructType *EnvType = Max->first;
+
+  // Create env as revng-lift does, i.e., an integer global variable
+  revng_assert(M->getGlobalVariable("env") == nullptr);
+  auto *Env = new GlobalVariable(*M,
+                                 PointerIntTy,
+                                 false,
+                                 GlobalValue::CommonLinkage,
+                                 ConstantInt::get(PointerIntTy, 0),
+                                 "env");
+
+  // Call each helper from a synthetic root function, in the same way
+  // InstructionTranslator::translateCall does. `env` is passed to the
+  // arguments pointing to the CPU state, all the other arguments are loaded
+  // from a global variable, so that the analysis can't know anything about
+  // them.
+  auto *RootType = FunctionType::get(Type::getVoidTy(Context), false);
+  auto *Root = Function::Create(RootType,
+                                GlobalValue::ExternalLinkage,
+                                "root",
+                                M.get());
+  revng_assert(Root->getName() == "root");
+  IRBuilder<> Builder(BasicBlock::Create(Context, "", Root));
+
+  std::map<Type *, GlobalVariable *> Unknowns;
+  std::map<const CallInst *, std::string> CallToHelper;
+  for (Function &F : *M) {
+    FunctionType *HelperType = F.getFunctionType();
+    if (F.empty() or F.isVarArg() or not F.getName().startswith("helper_")
+        or HelperType->getNumParams() > 64)
+      continue;
+
+    Type *ReturnType = HelperType->getReturnType();
+    if (ReturnType->isPointerTy())
+      ReturnType = PointerIntTy;
+    if (not ReturnType->isVoidTy() and not ReturnType->isIntegerTy())
+      continue;
+
+    uint64_t EnvArguments = 0;
+    std::vector<Type *> ArgumentTypes;
+    for (Type *Param : HelperType->params()) {
+      if (Param->isPointerTy()) {
+        if (Param->getPointerElementType() == EnvType)
+          EnvArguments |= uint64_t(1) << ArgumentTypes.size();
+        ArgumentTypes.push_back(PointerIntTy);
+      } else {
+        ArgumentTypes.push_back(Param);
+      }
+    }
+
+    auto IsInteger = [](Type *T) { return T->isIntegerTy(); };
+    auto Begin = ArgumentTypes.begin();
+    auto End = ArgumentTypes.end();
+    if (EnvArguments == 0 or not std::all_of(Begin, End, IsInteger))
+      continue;
+
+    std::vector<Value *> Arguments;
+    for (unsigned ArgNo = 0; ArgNo < ArgumentTypes.size(); ArgNo++) {
+      Type *ArgumentType = ArgumentTypes[ArgNo];
+      if ((EnvArguments >> ArgNo) & 1) {
+        Arguments.push_back(Builder.CreateLoad(Env));
+      } else {
+        GlobalVariable *&Unknown = Unknowns[ArgumentType];
+        if (Unknown == nullptr)
+          Unknown = new GlobalVariable(*M,
+                                       ArgumentType,
+                                       false,
+                                       GlobalValue::CommonLinkage,
+                                       Constant::getNullValue(ArgumentType),
+                                       "unknown");
+        Arguments.push_back(Builder.CreateLoad(Unknown));
+      }
+    }
+
+    auto *CalleeType = FunctionType::get(ReturnType, ArgumentTypes, false);
+    auto *Callee = ConstantExpr::getBitCast(&F, CalleeType->getPointerTo());
+    CallInst *Call = Builder.CreateCall(Callee, Arguments);
+    CallToHelper[Call] = F.getName();
+    Summaries.addHelper(F.getName(), EnvArguments);
+  }
+  Builder.CreateRetVoid();
+
+  // revng-lift runs SROA before the analysis
+  legacy::PassManager PM;
+  PM.add(createSROAPass());
+  PM.run(*M);
+
+  auto Reachable = computeDirectlyReachableFunctions(Root);
+  const auto Tainted = forwardTaintAnalysis(Env, Reachable);
+  AccessOffsetMap LoadOffsets;
+  AccessOffsetMap StoreOffsets;
+  CallSiteOffsetMap CallSiteLoadOffsets;
+  CallSiteOffsetMap CallSiteStoreOffsets;
+  CPUSAOA Analysis(*M,
+                   Env,
+                   Root,
+                   Reachable,
+                   Tainted,
+                   nullptr,
+                   LoadOffsets,
+                   StoreOffsets,
+                   CallSiteLoadOffsets,
+                   CallSiteStoreOffsets);
+  Analysis.analyze();
+
+  // Record the fingerprint of the functions and the results of each of their
+  // accesses, identified by its position in the function
+  std::map<const Instruction *, unsigned> Indexes;
+  for (const Function *F : Reachable) {
+    if (F == Root or F->empty())
+      continue;
+
+    Summaries.addFunction(F->getName(), CSVAccessSummaries::fingerprint(*F));
+    unsigned Index = 0;
+    for (const Instruction &I : instructions(F))
+      Indexes[&I] = Index++;
+  }
+
+  for (bool IsLoad : { true, false }) {
+    for (auto &P : Analysis.getCallSiteOffsets(IsLoad)) {
+      auto *I = cast<Instruction>(P.first);
+      const Function *F = I->getFunction();
+      if (F == Root)
+        continue;
+
+      for (auto &CSO : P.second) {
+        std::string Helper;
+        if (CSO.first != nullptr)
+          Helper = CallToHelper.at(CSO.first);
+        Summaries.addAccess(F->getName(),
+                            IsLoad,
+                            Indexes.at(I),
+                            { Helper, CSO.second });
+      }
+    }
+  }
+}
+
 bool CPUStateAccessAnalysisPass::runOnModule(Module &Mod) {
-  CPUStateAccessAnalysis CSVAccessAnalysis(Mod, Variables);
+  CPUStateAccessAnalysis CSVAccessAnalysis(Mod, Variables, Summaries);
   return CSVAccessAnalysis.run();
 }
 
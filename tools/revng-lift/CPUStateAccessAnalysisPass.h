@@ -23,6 +23,7 @@ class Instruction;
 
 template<bool StaticallyEnabled>
 class Logger;
+class CSVAccessSummaries;
 class VariableManager;
 
 /// \brief Different types of accesses to the CPU State Variables (CSVs), with a
@@ -219,16 +220,23 @@ class CPUStateAccessAnalysisPass : public llvm::ModulePass {
 
 private:
   VariableManager *Variables;
+  const CSVAccessSummaries *Summaries;
 
 public:
   static char ID;
 
 public:
-  CPUStateAccessAnalysisPass() : llvm::ModulePass(ID), Variables(nullptr){};
+  CPUStateAccessAnalysisPass() :
+    llvm::ModulePass(ID),
+    Variables(nullptr),
+    Summaries(nullptr){};
 
-  CPUStateAccessAnalysisPass(VariableManager *VM) :
+  /// \param Summaries precomputed results on the helpers, if available.
+  CPUStateAccessAnalysisPass(VariableManager *VM,
+                             const CSVAccessSummaries *Summaries = nullptr) :
     llvm::ModulePass(ID),
-    Variables(VM){};
+    Variables(VM),
+    Summaries(Summaries){};
 
 public:
   bool runOnModule(llvm::Module &TheModule) override;
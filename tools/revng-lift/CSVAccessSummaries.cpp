@@ -0,0 +1,246 @@
+/// \file csvaccesssummaries.cpp
+/// \brief This file implements the serialization of the precomputed results of
+///        the CPUStateAccessAnalysisPass on the QEMU helpers.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+// LLVM includes
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+
+// Local includes
+#include "CSVAccessSummaries.h"
+
+using namespace llvm;
+
+// The serialized summaries are a line-oriented text file. A `helper` line
+// records the name of a helper and the bitmask of the arguments through which
+// it receives `env`. A `function` line records the name of a function and its
+// fingerprint, and is followed by a `load` or `store` line for each of the
+// offsets accessed by its instructions: the index of the instruction, the name
+// of the helper (or `-`), the kind of the offsets and the offsets themselves.
+
+namespace {
+
+/// \brief FNV-1a hash of the structure of a function
+///
+/// Values are identified by their position (arguments, basic blocks and
+/// instructions) or by their content (constants and global names), so the
+/// result doesn't depend on the addresses of the objects.
+class FunctionHasher {
+public:
+  uint64_t hash(const Function &F) {
+    uint64_t Index = 0;
+    for (const Argument &A : F.args())
+      Indices[&A] = Index++;
+    for (const BasicBlock &BB : F)
+      Indices[&BB] = Index++;
+    for (const Instruction &I : instructions(F))
+      Indices[&I] = Index++;
+
+    mix(F.arg_size());
+    for (const Argument &A : F.args())
+      mix(A.getType());
+
+    for (const BasicBlock &BB : F) {
+      mix(BB.size());
+      for (const Instruction &I : BB) {
+        mix(I.getOpcode());
+        mix(I.getType());
+        if (auto *Compare = dyn_cast<CmpInst>(&I))
+          mix(Compare->getPredicate());
+        mix(I.getNumOperands());
+        for (const Value *Operand : I.operands())
+          mix(Operand);
+      }
+    }
+
+    return Result;
+  }
+
+private:
+  void mix(uint64_t Value) {
+    Result ^= Value;
+    Result *= 0x100000001b3;
+  }
+
+  void mix(StringRef String) {
+    mix(String.size());
+    for (char C : String)
+      mix(static_cast<unsigned char>(C));
+  }
+
+  void mix(const APInt &Value) {
+    mix(Value.getBitWidth());
+    for (unsigned I = 0; I < Value.getNumWords(); I++)
+      mix(Value.getRawData()[I]);
+  }
+
+  void mix(Type *T) {
+    auto It = TypeNames.find(T);
+    if (It == TypeNames.end()) {
+      std::string Name;
+      raw_string_ostream Stream(Name);
+      T->print(Stream);
+      It = TypeNames.insert({ T, Stream.str() }).first;
+    }
+    mix(It->second);
+  }
+
+  void mix(const Value *V) {
+    mix(V->getValueID());
+    mix(V->getType());
+
+    auto It = Indices.find(V);
+    if (It != Indices.end()) {
+      mix(It->second);
+    } else if (auto *Global = dyn_cast<GlobalValue>(V)) {
+      mix(Global->getName());
+    } else if (auto *Integer = dyn_cast<ConstantInt>(V)) {
+      mix(Integer->getValue());
+    } else if (auto *Float = dyn_cast<ConstantFP>(V)) {
+      mix(Float->getValueAPF().bitcastToAPInt());
+    } else if (auto *Data = dyn_cast<ConstantDataSequential>(V)) {
+      mix(Data->getRawDataValues());
+    } else if (auto *Expression = dyn_cast<ConstantExpr>(V)) {
+      mix(Expression->getOpcode());
+      if (Expression->isCompare())
+        mix(Expression->getPredicate());
+      for (const Value *Operand : Expression->operands())
+        mix(Operand);
+    } else if (auto *C = dyn_cast<Constant>(V)) {
+      // Aggregates, null values, undef and so on
+      for (const Value *Operand : C->operands())
+        mix(Operand);
+    }
+  }
+
+private:
+  uint64_t Result = 0xcbf29ce484222325;
+  std::map<const Value *, uint64_t> Indices;
+  std::map<Type *, std::string> TypeNames;
+};
+
+} // namespace
+
+uint64_t CSVAccessSummaries::fingerprint(const Function &F) {
+  return FunctionHasher().hash(F);
+}
+
+void CSVAccessSummaries::addAccess(StringRef Function,
+                                   bool IsLoad,
+                                   unsigned Index,
+                                   HelperOffsets Access) {
+  auto It = Functions.find(Function);
+  revng_assert(It != Functions.end());
+  AccessMap &Accesses = IsLoad ? It->second.Loads : It->second.Stores;
+  Accesses[Index].push_back(std::move(Access));
+}
+
+const CSVAccessSummaries::FunctionSummary *
+CSVAccessSummaries::getFunction(const Function &F) const {
+  auto It = Functions.find(F.getName());
+  if (It == Functions.end() or It->second.Fingerprint != fingerprint(F))
+    return nullptr;
+
+  return &It->second;
+}
+
+static void serializeAccesses(std::ostream &Output,
+                              const char *Type,
+                              const CSVAccessSummaries::AccessMap &Accesses) {
+  for (auto &P : Accesses) {
+    for (const CSVAccessSummaries::HelperOffsets &Access : P.second) {
+      std::string Helper = Access.Helper.empty() ? "-" : Access.Helper;
+      Output << Type << " " << P.first << " " << Helper << " "
+             << static_cast<int>(Access.Offsets.getKind());
+      for (int64_t Offset : Access.Offsets)
+        Output << " " << Offset;
+      Output << "\n";
+    }
+  }
+}
+
+void CSVAccessSummaries::serialize(std::ostream &Output) const {
+  for (auto &P : Helpers)
+    Output << "helper " << P.getKey().str() << " " << P.getValue() << "\n";
+
+  for (auto &P : Functions) {
+    const FunctionSummary &Summary = P.getValue();
+    Output << "function " << P.getKey().str() << " " << Summary.Fingerprint
+           << "\n";
+    serializeAccesses(Output, "load", Summary.Loads);
+    serializeAccesses(Output, "store", Summary.Stores);
+  }
+}
+
+bool CSVAccessSummaries::load(std::istream &Input) {
+  Helpers.clear();
+  Functions.clear();
+
+  FunctionSummary *Current = nullptr;
+  std::string Line;
+  while (std::getline(Input, Line)) {
+    std::stringstream Stream(Line);
+    std::string Type;
+    std::string Name;
+    if (not(Stream >> Type))
+      continue;
+
+    if (Type == "helper") {
+      uint64_t EnvArguments;
+      if (not(Stream >> Name >> EnvArguments))
+        return false;
+      Helpers[Name] = EnvArguments;
+    } else if (Type == "function") {
+      uint64_t Fingerprint;
+      if (not(Stream >> Name >> Fingerprint))
+        return false;
+      Current = &Functions[Name];
+      Current->Fingerprint = Fingerprint;
+    } else if (Type == "load" or Type == "store") {
+      unsigned Index;
+      int Kind;
+      if (Current == nullptr or not(Stream >> Index >> Name >> Kind))
+        return false;
+      if (Kind < CSVOffsets::Unknown or Kind > CSVOffsets::OutAndUnknownInPtr)
+        return false;
+
+      std::set<int64_t> Offsets;
+      int64_t Offset;
+      while (Stream >> Offset)
+        Offsets.insert(Offset);
+
+      if (Name == "-")
+        Name.clear();
+      AccessMap &Accesses = Type == "load" ? Current->Loads : Current->Stores;
+      auto OffsetsKind = static_cast<CSVOffsets::Kind>(Kind);
+      Accesses[Index].push_back({ Name, CSVOffsets(OffsetsKind, Offsets) });
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::string getCSVAccessSummariesPath(StringRef HelpersPath) {
+  if (not HelpersPath.endswith(".bc"))
+    return "";
+
+  return (HelpersPath.drop_back(3) + ".csvaccess").str();
+}
@@ -0,0 +1,113 @@
+#ifndef CSVACCESSSUMMARIES_H
+#define CSVACCESSSUMMARIES_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+// Local includes
+#include "CPUStateAccessAnalysisPass.h"
+
+namespace llvm {
+class Function;
+class Module;
+} // namespace llvm
+
+/// \brief Precomputed results of the CPUStateAccessAnalysisPass on the QEMU
+///        helpers
+///
+/// The offsets of the CPU state accessed by a helper only depend on the
+/// arguments it receives from the root function. If `env` is the only argument
+/// that can contribute to the address of an access, the results of the
+/// analysis are the same for all the binaries, and can therefore be computed
+/// once and for all by `revng-prepare-helpers`.
+///
+/// For each function, the summary records the coarse offsets accessed by each
+/// of its loads and stores, identified by their position in the function,
+/// distinguishing among the helpers through which the access is reached. An
+/// empty helper name denotes offsets that do not depend on the call site.
+class CSVAccessSummaries {
+public:
+  struct HelperOffsets {
+    std::string Helper;
+    CSVOffsets Offsets;
+  };
+
+  using AccessMap = std::map<unsigned, std::vector<HelperOffsets>>;
+
+  struct FunctionSummary {
+    uint64_t Fingerprint;
+    AccessMap Loads;
+    AccessMap Stores;
+  };
+
+public:
+  /// \brief Compute a fingerprint of the body of \p F, used to detect
+  ///        functions that changed since the summaries have been computed
+  static uint64_t fingerprint(const llvm::Function &F);
+
+  /// \brief Record that the root function passes `env` to \p Helper in the
+  ///        arguments whose bit is set in \p EnvArguments
+  void addHelper(llvm::StringRef Helper, uint64_t EnvArguments) {
+    Helpers[Helper] = EnvArguments;
+  }
+
+  void addFunction(llvm::StringRef Name, uint64_t Fingerprint) {
+    Functions[Name].Fingerprint = Fingerprint;
+  }
+
+  void addAccess(llvm::StringRef Function,
+                 bool IsLoad,
+                 unsigned Index,
+                 HelperOffsets Access);
+
+  /// \brief Get the arguments of \p Helper that the summaries assume to be
+  ///        `env`, or nullptr if \p Helper has no summary
+  const uint64_t *getEnvArguments(llvm::StringRef Helper) const {
+    auto It = Helpers.find(Helper);
+    return It == Helpers.end() ? nullptr : &It->second;
+  }
+
+  /// \brief Get the summary of \p F, or nullptr if it's not available or if
+  ///        \p F changed since it has been computed
+  const FunctionSummary *getFunction(const llvm::Function &F) const;
+
+  bool empty() const { return Functions.empty(); }
+
+  void serialize(std::ostream &Output) const;
+
+  /// \brief Load the content of summaries produced by serialize
+  ///
+  /// \return true in case of success.
+  bool load(std::istream &Input);
+
+private:
+  llvm::StringMap<uint64_t> Helpers;
+  llvm::StringMap<FunctionSummary> Functions;
+};
+
+/// \brief Get the path of the summaries produced by `revng-prepare-helpers`
+///        along with the prepared helpers module at \p HelpersPath
+///
+/// \return an empty string if \p HelpersPath is not a prepared module.
+std::string getCSVAccessSummariesPath(llvm::StringRef HelpersPath);
+
+/// \brief Run the CPUStateAccessAnalysisPass on all the helpers of
+///        \p HelpersModule, calling each of them from a synthetic root
+///        function, and record the results in \p Summaries
+void computeCSVAccessSummaries(const llvm::Module &HelpersModule,
+                               CSVAccessSummaries &Summaries);
+
+#endif // CSVACCESSSUMMARIES_H
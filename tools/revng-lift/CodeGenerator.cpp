@@ -23,7 +23,8 @@
 #include <boost/type_traits/is_same.hpp>
 
 // LLVM includes
-#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/CFG.h"
@@ -36,8 +37,10 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_os_ostream.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
@@ -47,13 +50,17 @@
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/DebugHelper.h"
+#include "revng/Support/PTCTable.h"
+#include "revng/Support/PhaseReport.h"
 #include "revng/Support/revng.h"
 
 // Local includes
 #include "CodeGenerator.h"
 #include "ExternalJumpsHandler.h"
+#include "HelpersModule.h"
 #include "InstructionTranslator.h"
 #include "JumpTargetManager.h"
+#include "PTCDecoderPool.h"
 #include "PTCInterface.h"
 #include "VariableManager.h"
 
@@ -139,11 +146,123 @@ static cl::opt<string> DebugPath("debug-path",
                                  cl::value_desc("path"),
                                  cl::cat(MainCategory));
 
+namespace OutputFormat {
+
+/// \brief Format of the serialized module
+enum Values {
+  /// Textual LLVM IR
+  Text,
+  /// LLVM bitcode
+  Bitcode
+};
+
+} // namespace OutputFormat
+
+namespace OF = OutputFormat;
+auto Formats = cl::values(clEnumValN(OF::Text, "ll", "textual LLVM IR"),
+                          clEnumValN(OF::Bitcode, "bc", "LLVM bitcode"));
+static cl::opt<OF::Values> ModuleFormat("output-format",
+                                        cl::desc("format of the output module"),
+                                        Formats,
+                                        cl::cat(MainCategory),
+                                        cl::init(OF::Text));
+
+/// \brief Return the path where the debug source has to be written
+///
+/// In bitcode mode the output can't be the debug source of itself, therefore,
+/// if debug information referring to the LLVM IR is requested, the textual IR
+/// is written next to it.
+static std::string getDebugPath(const std::string &Output) {
+  if (DebugPath.empty() and ModuleFormat == OF::Bitcode
+      and DebugInfo == DIT::LLVMIR)
+    return Output + ".ll";
+
+  return DebugPath;
+}
+
+static cl::opt<unsigned> DecoderThreads("decoder-threads",
+                                        cl::desc("number of threads decoding "
+                                                 "jump targets ahead of the "
+                                                 "IR emission"),
+                                        cl::value_desc("threads"),
+                                        cl::cat(MainCategory),
+                                        cl::init(0));
+
+static cl::opt<bool> UsePTCTable("ptc-table",
+                                 cl::desc("store the PTC instructions in "
+                                          "OUTPUT.ptc-table instead of in the "
+                                          "metadata of each instruction"),
+                                 cl::cat(MainCategory),
+                                 cl::init(false));
+
+static cl::opt<bool> ExternalSegments("external-segments",
+                                      cl::desc("do not embed the content of "
+                                               "the segments in the module, "
+                                               "emit OUTPUT.segments.s "
+                                               "referencing the input file "
+                                               "instead"),
+                                      cl::cat(MainCategory),
+                                      cl::init(false));
+
 static Logger<> PTCLog("ptc");
 
-template<typename T, typename... Args>
-inline std::array<T, sizeof...(Args)> make_array(Args &&... args) {
-  return { { std::forward<Args>(args)... } };
+/// \brief Record in \p Table the translation of the original instruction at
+///        \p PC, i.e., the PTC instructions from its `debug_insn_start`, at
+///        index \p Start, up to \p Next, the following one, if any
+///
+/// \return the ID of the translation in \p Table.
+static unsigned recordTranslation(PTCTable &Table,
+                                  uint64_t PC,
+                                  PTCInstructionList *Instructions,
+                                  unsigned Start,
+                                  PTCInstruction *Next) {
+  unsigned End = Instructions->instruction_count;
+  if (Next != nullptr)
+    End = Next - Instructions->instructions;
+
+  std::vector<std::string> Texts;
+  for (unsigned I = Start; I < End; I++) {
+    std::stringstream Stream;
+    dumpInstruction(Stream, Instructions, I);
+    Texts.push_back(Stream.str() + "\n");
+  }
+
+  return Table.add(PC, Texts);
+}
+
+/// \brief Write \p Text as a string literal for the GNU assembler
+static void writeAsmString(std::ostream &Output, StringRef Text) {
+  Output << '"';
+  for (char C : Text) {
+    if (C == '"' or C == '\\')
+      Output << '\\';
+    Output << C;
+  }
+  Output << '"';
+}
+
+/// \brief Emit the definition of the variable of \p Segment taking its content
+///        directly from the input file at \p InputPath
+static void writeExternalSegment(std::ostream &Output,
+                                 const SegmentInfo &Segment,
+                                 StringRef InputPath,
+                                 const std::string &Name) {
+  Output << ".section ." << Name << ",\"a"
+         << (Segment.IsWriteable ? "w" : "") << "\",%progbits\n";
+  Output << ".globl " << Name << "\n";
+  Output << ".type " << Name << ",%object\n";
+  Output << ".size " << Name << "," << std::dec << Segment.size() << "\n";
+  Output << Name << ":\n";
+
+  if (Segment.Data.size() != 0) {
+    Output << ".incbin ";
+    writeAsmString(Output, InputPath);
+    Output << "," << Segment.FileOffset << "," << Segment.Data.size() << "\n";
+  }
+
+  // Append the NULL bytes past the end of the data in the file
+  if (Segment.size() > Segment.Data.size())
+    Output << ".zero " << Segment.size() - Segment.Data.size() << "\n";
 }
 
 // Outline the destructor for the sake of privacy in the header
@@ -167,28 +286,42 @@ CodeGenerator::CodeGenerator(BinaryFile &Binary,
                              llvm::LLVMContext &TheContext,
                              std::string Output,
                              std::string Helpers,
-                             std::string EarlyLinked) :
+                             std::string EarlyLinked,
+                             std::string LibTinycode) :
   TargetArchitecture(Target),
   Context(TheContext),
   TheModule((new Module("top", Context))),
   OutputPath(Output),
-  Debug(new DebugHelper(Output, TheModule.get(), DebugInfo, DebugPath)),
+  LibTinycodePath(LibTinycode),
+  Debug(new DebugHelper(Output,
+                        TheModule.get(),
+                        DebugInfo,
+                        getDebugPath(Output))),
   Binary(Binary) {
   OriginalInstrMDKind = Context.getMDKindID("oi");
   PTCInstrMDKind = Context.getMDKindID("pi");
 
-  HelpersModule = parseIR(Helpers, Context);
-  for (auto &F : HelpersModule->functions()) {
-    // Remove 'optnone' Function attribute from QEMU helpers.
-    // QEMU helpers are compiled with -O0 in libtinycode because the LLVM IR
-    // generated in this way it much more readable, but we need to optimize
-    // them when we link them with the decompiled code.
-    // In particular we desperately need SROA to get rid of allocas, to
-    // enable the CPUStateAccessAnalysisPass.
-    // If we don't remove this attribute future optimizations are blocked.
-    F.removeFnAttr(Attribute::OptimizeNone);
-    F.setDSOLocal(false);
+  if (UsePTCTable) {
+    PTCInstructions.reset(new PTCTable);
+    Debug->setPTCTable(PTCInstructions.get());
   }
+
+  auto HelpersLoading = Phases->scope("helpers-loading");
+  HelpersModule = loadHelpersModule(Helpers, Context);
+
+  // Use the results of the CPUStateAccessAnalysisPass on the helpers
+  // precomputed by revng-prepare-helpers, if available
+  std::string SummariesPath = getCSVAccessSummariesPath(Helpers);
+  if (SummariesPath.size() != 0) {
+    std::ifstream SummariesInput(SummariesPath);
+    if (SummariesInput) {
+      HelpersSummaries.reset(new CSVAccessSummaries);
+      if (not HelpersSummaries->load(SummariesInput))
+        HelpersSummaries.reset();
+    }
+  }
+  HelpersLoading.end();
+
   EarlyLinkedModule = parseIR(EarlyLinked, Context);
 
   if (CoveragePath.size() == 0)
@@ -230,6 +363,19 @@ CodeGenerator::CodeGenerator(BinaryFile &Binary,
   createConstGlobal("e_phnum", Binary.programHeadersCount());
   createConstGlobal("phdr_address", Binary.programHeadersAddress());
 
+  // In external segments mode, the content of the segments is provided at link
+  // time, directly from the input file. Otherwise, make sure no stale file
+  // from a previous run is around.
+  std::string SegmentsPath = OutputPath + ".segments.s";
+  std::ofstream SegmentsStream;
+  SmallString<128> InputPath(Binary.path());
+  if (ExternalSegments) {
+    SegmentsStream.open(SegmentsPath);
+    sys::fs::make_absolute(InputPath);
+  } else {
+    sys::fs::remove(SegmentsPath);
+  }
+
   for (SegmentInfo &Segment : Binary.segments()) {
     // If it's executable register it as a valid code area
     if (Segment.IsExecutable) {
@@ -246,7 +392,10 @@ CodeGenerator::CodeGenerator(BinaryFile &Binary,
     auto *DataType = ArrayType::get(Uint8Ty, Segment.size());
 
     Constant *TheData = nullptr;
-    if (Segment.size() == Segment.Data.size()) {
+    if (ExternalSegments) {
+      // Just declare the variable, its definition references the input file
+      writeExternalSegment(SegmentsStream, Segment, InputPath, Name);
+    } else if (Segment.size() == Segment.Data.size()) {
       // Create the array directly from the mmap'd ELF
       TheData = ConstantDataArray::get(Context, Segment.Data);
     } else {
@@ -305,139 +454,6 @@ std::string SegmentInfo::generateName() {
   return NameStream.str();
 }
 
-static BasicBlock *replaceFunction(Function *ToReplace) {
-  ToReplace->setLinkage(GlobalValue::InternalLinkage);
-  ToReplace->dropAllReferences();
-
-  return BasicBlock::Create(ToReplace->getParent()->getContext(),
-                            "",
-                            ToReplace);
-}
-
-static void replaceFunctionWithRet(Function *ToReplace, uint64_t Result) {
-  if (ToReplace == nullptr)
-    return;
-
-  BasicBlock *Body = replaceFunction(ToReplace);
-  Value *ResultValue;
-
-  if (ToReplace->getReturnType()->isVoidTy()) {
-    revng_assert(Result == 0);
-    ResultValue = nullptr;
-  } else if (ToReplace->getReturnType()->isIntegerTy()) {
-    auto *ReturnType = cast<IntegerType>(ToReplace->getReturnType());
-    ResultValue = ConstantInt::get(ReturnType, Result, false);
-  } else {
-    revng_unreachable("No-op functions can only return void or an integer "
-                      "type");
-  }
-
-  ReturnInst::Create(ToReplace->getParent()->getContext(), ResultValue, Body);
-}
-
-class CpuLoopFunctionPass : public llvm::ModulePass {
-public:
-  static char ID;
-
-  CpuLoopFunctionPass() : llvm::ModulePass(ID) {}
-
-  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
-
-  bool runOnModule(llvm::Module &M) override;
-};
-
-char CpuLoopFunctionPass::ID = 0;
-
-using RegisterCLF = RegisterPass<CpuLoopFunctionPass>;
-static RegisterCLF Y("cpu-loop", "cpu_loop FunctionPass", false, false);
-
-void CpuLoopFunctionPass::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
-  AU.addRequired<LoopInfoWrapperPass>();
-}
-
-template<class Range, class UnaryPredicate>
-auto find_unique(Range &&TheRange, UnaryPredicate Predicate)
-  -> decltype(*TheRange.begin()) {
-
-  const auto Begin = TheRange.begin();
-  const auto End = TheRange.end();
-
-  auto It = std::find_if(Begin, End, Predicate);
-  auto Result = It;
-  revng_assert(Result != End);
-  revng_assert(std::find_if(++It, End, Predicate) == End);
-
-  return *Result;
-}
-
-template<class Range>
-auto find_unique(Range &&TheRange) -> decltype(*TheRange.begin()) {
-
-  const auto Begin = TheRange.begin();
-  const auto End = TheRange.end();
-
-  auto Result = Begin;
-  revng_assert(Begin != End && ++Result == End);
-
-  return *Begin;
-}
-
-bool CpuLoopFunctionPass::runOnModule(Module &M) {
-  Function &F = *M.getFunction("cpu_loop");
-
-  // cpu_loop must return void
-  revng_assert(F.getReturnType()->isVoidTy());
-
-  Module *TheModule = F.getParent();
-
-  // Part 1: remove the backedge of the main infinite loop
-  const LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
-  const Loop *OutermostLoop = find_unique(LI);
-
-  BasicBlock *Header = OutermostLoop->getHeader();
-
-  // Check that the header has only one predecessor inside the loop
-  auto IsInLoop = [&OutermostLoop](BasicBlock *Predecessor) {
-    return OutermostLoop->contains(Predecessor);
-  };
-  BasicBlock *Footer = find_unique(predecessors(Header), IsInLoop);
-
-  // Assert on the type of the last instruction (branch or brcond)
-  revng_assert(Footer->end() != Footer->begin());
-  Instruction *LastInstruction = &*--Footer->end();
-  revng_assert(isa<BranchInst>(LastInstruction));
-
-  // Remove the last instruction and replace it with a ret
-  LastInstruction->eraseFromParent();
-  ReturnInst::Create(F.getParent()->getContext(), Footer);
-
-  // Part 2: replace the call to cpu_*_exec with exception_index
-  auto IsCpuExec = [](Function &TheFunction) {
-    StringRef Name = TheFunction.getName();
-    return Name.startswith("cpu_") && Name.endswith("_exec");
-  };
-  Function &CpuExec = find_unique(F.getParent()->functions(), IsCpuExec);
-
-  User *CallUser = find_unique(CpuExec.users(), [&F](User *TheUser) {
-    auto *TheInstruction = dyn_cast<Instruction>(TheUser);
-
-    if (TheInstruction == nullptr)
-      return false;
-
-    return TheInstruction->getParent()->getParent() == &F;
-  });
-
-  auto *Call = cast<CallInst>(CallUser);
-  revng_assert(Call->getCalledFunction() == &CpuExec);
-  Value *ExceptionIndex = TheModule->getOrInsertGlobal("exception_index",
-                                                       CpuExec.getReturnType());
-  Value *LoadExceptionIndex = new LoadInst(ExceptionIndex, "", Call);
-  Call->replaceAllUsesWith(LoadExceptionIndex);
-  Call->eraseFromParent();
-
-  return true;
-}
-
 class CpuLoopExitPass : public llvm::ModulePass {
 public:
   static char ID;
@@ -764,6 +780,10 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
 
   std::tie(VirtualAddress, Entry) = JumpTargets.peek();
 
+  // Decoding can proceed in parallel, while the emission of the IR is driven,
+  // in order, by the JumpTargetManager
+  PTCDecoderPool Decoder(LibTinycodePath, Binary, DecoderThreads);
+
   std::vector<BasicBlock *> Blocks;
 
   InstructionTranslator Translator(Builder,
@@ -773,6 +793,8 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
                                    Binary.architecture(),
                                    TargetArchitecture);
 
+  // Note: the translation phase includes all the harvesting phases
+  auto Translation = Phases->scope("translation", TheModule.get());
   while (Entry != nullptr) {
     Builder.SetInsertPoint(Entry);
 
@@ -780,12 +802,14 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
     Translator.reset();
 
     // TODO: rename this type
-    PTCInstructionListPtr InstructionList(new PTCInstructionList);
-    size_t ConsumedSize = 0;
+    PTCDecoderPool::DecodedBlock Decoded = Decoder.decode(VirtualAddress);
+    PTCInstructionListPtr InstructionList = std::move(Decoded.Instructions);
+    size_t ConsumedSize = Decoded.ConsumedSize;
 
-    ConsumedSize = ptc.translate(VirtualAddress, InstructionList.get());
-    SmallSet<unsigned, 1> ToIgnore;
-    ToIgnore = Translator.preprocess(InstructionList.get());
+    // Let the decoders work on what's coming next while we emit this block
+    Decoder.prefetch(JumpTargets.upcoming(Decoder.capacity()));
+
+    Translator.preprocess(InstructionList.get());
 
     if (PTCLog.isEnabled()) {
       std::stringstream Stream;
@@ -795,6 +819,8 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
 
     Variables.newFunction(Delimiter, InstructionList.get());
     unsigned j = 0;
+    unsigned InstructionStart = 0;
+    unsigned Translation = 0;
     MDNode *MDOriginalInstr = nullptr;
     bool StopTranslation = false;
     uint64_t PC = VirtualAddress;
@@ -807,15 +833,7 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
 
     // Handle the first PTC_INSTRUCTION_op_debug_insn_start
     {
-      PTCInstruction *NextInstruction = nullptr;
-      for (unsigned k = 1; k < InstructionCount; k++) {
-        PTCInstruction *I = &InstructionList->instructions[k];
-        if (I->opc == PTC_INSTRUCTION_op_debug_insn_start
-            && ToIgnore.count(k) == 0) {
-          NextInstruction = I;
-          break;
-        }
-      }
+      PTCInstruction *NextInstruction = Translator.nextInstructionStart(j);
       PTCInstruction *Instruction = &InstructionList->instructions[j];
       std::tie(Result,
                MDOriginalInstr,
@@ -825,12 +843,18 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
                                                    EndPC,
                                                    true,
                                                    false);
+      if (PTCInstructions)
+        Translation = recordTranslation(*PTCInstructions,
+                                        PC,
+                                        InstructionList.get(),
+                                        j,
+                                        NextInstruction);
       j++;
     }
 
     // TODO: shall we move this whole loop in InstructionTranslator?
     for (; j < InstructionCount && !StopTranslation; j++) {
-      if (ToIgnore.count(j) != 0)
+      if (Translator.isIgnored(j))
         continue;
 
       PTCInstruction Instruction = InstructionList->instructions[j];
@@ -845,15 +869,7 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
         break;
       case PTC_INSTRUCTION_op_debug_insn_start: {
         // Find next instruction, if there is one
-        PTCInstruction *NextInstruction = nullptr;
-        for (unsigned k = j + 1; k < InstructionCount; k++) {
-          PTCInstruction *I = &InstructionList->instructions[k];
-          if (I->opc == PTC_INSTRUCTION_op_debug_insn_start
-              && ToIgnore.count(k) == 0) {
-            NextInstruction = I;
-            break;
-          }
-        }
+        PTCInstruction *NextInstruction = Translator.nextInstructionStart(j);
 
         std::tie(Result,
                  MDOriginalInstr,
@@ -864,7 +880,15 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
                                                      false,
                                                      ForceNewBlock);
 
+        InstructionStart = j;
         ForceNewBlock = false;
+
+        if (PTCInstructions)
+          Translation = recordTranslation(*PTCInstructions,
+                                          PC,
+                                          InstructionList.get(),
+                                          j,
+                                          NextInstruction);
       } break;
       case PTC_INSTRUCTION_op_call: {
         Result = Translator.translateCall(&Instruction);
@@ -904,19 +928,37 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
 
       // Create a new metadata referencing the PTC instruction we have just
       // translated
-      std::stringstream PTCStringStream;
-      dumpInstruction(PTCStringStream, InstructionList.get(), j);
-      std::string PTCString = PTCStringStream.str() + "\n";
-      MDString *MDPTCString = MDString::get(Context, PTCString);
-      MDNode *MDPTCInstr = MDNode::getDistinct(Context, MDPTCString);
+      MDNode *MDPTCInstr = nullptr;
+      MDNode *MDInstr = MDOriginalInstr;
+      if (PTCInstructions) {
+        // Refer to the string in the table through the index of the PTC
+        // instruction within the original instruction and the ID of the
+        // translation of the latter. Such a node is shared by all the
+        // instructions with the same index and translation ID. The original
+        // instruction can be recovered from the preceding newpc.
+        unsigned Index = j - InstructionStart;
+        auto *MDIndex = ConstantAsMetadata::get(Builder.getInt32(Index));
+        ConstantInt *TranslationID = Builder.getInt32(Translation);
+        auto *MDTranslation = ConstantAsMetadata::get(TranslationID);
+        MDPTCInstr = MDNode::get(Context, { MDIndex, MDTranslation });
+        MDInstr = nullptr;
+      } else {
+        std::stringstream PTCStringStream;
+        dumpInstruction(PTCStringStream, InstructionList.get(), j);
+        std::string PTCString = PTCStringStream.str() + "\n";
+        MDString *MDPTCString = MDString::get(Context, PTCString);
+        MDPTCInstr = MDNode::getDistinct(Context, MDPTCString);
+      }
 
-      // Set metadata for all the new instructions
+      // Set metadata for all the new instructions and have them cleaned up at
+      // the next harvest
       for (BasicBlock *Block : Blocks) {
         BasicBlock::iterator I = Block->end();
         while (I != Block->begin() && !(--I)->hasMetadata()) {
-          I->setMetadata(OriginalInstrMDKind, MDOriginalInstr);
+          I->setMetadata(OriginalInstrMDKind, MDInstr);
           I->setMetadata(PTCInstrMDKind, MDPTCInstr);
         }
+        JumpTargets.markDirty(Block);
       }
 
     } // End loop over instructions
@@ -937,49 +979,13 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
     // Obtain a new program counter to translate
     std::tie(VirtualAddress, Entry) = JumpTargets.peek();
   } // End translations loop
+  Translation.end();
 
   importHelperFunctionDeclaration("cpu_loop");
 
-  legacy::PassManager CpuLoopPM;
-  CpuLoopPM.add(new LoopInfoWrapperPass());
-  CpuLoopPM.add(new CpuLoopFunctionPass());
-  CpuLoopPM.run(*HelpersModule);
-
   // CpuLoopFunctionPass expects a variable name exception_index to exist
   Variables.getByEnvOffset(ptc.exception_index, "exception_index");
 
-  // Handle some specific QEMU functions as no-ops or abort
-  auto NoOpFunctionNames = make_array<const char *>("cpu_dump_state",
-                                                    "cpu_exit",
-                                                    "end_exclusive"
-                                                    "fprintf",
-                                                    "mmap_lock",
-                                                    "mmap_unlock",
-                                                    "pthread_cond_broadcast",
-                                                    "pthread_mutex_unlock",
-                                                    "pthread_mutex_lock",
-                                                    "pthread_cond_wait",
-                                                    "pthread_cond_signal",
-                                                    "process_pending_signals",
-                                                    "qemu_log_mask",
-                                                    "qemu_thread_atexit_init",
-                                                    "start_exclusive");
-  auto AbortFunctionNames = make_array<const char *>("cpu_restore_state",
-                                                     "cpu_mips_exec",
-                                                     "gdb_handlesig",
-                                                     "queue_signal",
-                                                     // syscall.c
-                                                     "do_ioctl_dm",
-                                                     "print_syscall",
-                                                     "print_syscall_ret",
-                                                     // ARM cpu_loop
-                                                     "cpu_abort",
-                                                     "do_arm_semihosting",
-                                                     "EmulateAll");
-
-  // do_arm_semihosting: we don't care about semihosting
-  // EmulateAll: requires access to the opcode
-
   // Import the function to initialize the CPUState, if present.
   // This is important on x86 architecture.
   if (HelpersModule->getFunction("initialize_env") != nullptr)
@@ -993,23 +999,6 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
                      ConstantInt::get(Type::getInt32Ty(Context), 0),
                      StringRef("do_strace"));
 
-  for (auto Name : NoOpFunctionNames)
-    replaceFunctionWithRet(HelpersModule->getFunction(Name), 0);
-
-  for (auto Name : AbortFunctionNames) {
-    Function *TheFunction = HelpersModule->getFunction(Name);
-    if (TheFunction != nullptr) {
-      revng_assert(HelpersModule->getFunction("abort") != nullptr);
-      BasicBlock *NewBody = replaceFunction(TheFunction);
-      CallInst::Create(HelpersModule->getFunction("abort"), {}, NewBody);
-      new UnreachableInst(Context, NewBody);
-    }
-  }
-
-  replaceFunctionWithRet(HelpersModule->getFunction("page_check_range"), 1);
-  replaceFunctionWithRet(HelpersModule->getFunction("page_get_flags"),
-                         0xffffffff);
-
   // HACK: the LLVM linker does not import non-static functions anymore if
   //       LinkOnlyNeeded is specified. We don't want this so mark all the
   //       non-static symbols not directly imported as static.
@@ -1036,6 +1025,7 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
   }
 
   if (not NoLink) {
+    auto Linking = Phases->scope("linking", TheModule.get());
     Linker TheLinker(*TheModule);
     bool Result = TheLinker.linkInModule(std::move(HelpersModule),
                                          Linker::LinkOnlyNeeded);
@@ -1060,12 +1050,20 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
 
   Variables.setDataLayout(&TheModule->getDataLayout());
 
-  legacy::PassManager PM;
-  PM.add(createSROAPass());
-  PM.add(new CpuLoopExitPass(&Variables));
-  PM.add(Variables.createCPUStateAccessAnalysisPass());
-  PM.add(createDeadCodeEliminationPass());
-  PM.run(*TheModule);
+  // Run each pass in its own PassManager, so that it can be measured as a
+  // separate phase
+  auto RunPhase = [this](StringRef Name, Pass *ThePass) {
+    auto Phase = Phases->scope(Name, TheModule.get());
+    legacy::PassManager PM;
+    PM.add(ThePass);
+    PM.run(*TheModule);
+  };
+
+  RunPhase("sroa", createSROAPass());
+  RunPhase("cpu-loop-exit", new CpuLoopExitPass(&Variables));
+  RunPhase("cpu-state-access-analysis",
+           Variables.createCPUStateAccessAnalysisPass(HelpersSummaries.get()));
+  RunPhase("dead-code-elimination", createDeadCodeEliminationPass());
 
   JumpTargets.finalizeJumpTargets();
 
@@ -1076,6 +1074,7 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
   // Link early-linked.c
   // TODO: moving this too earlier seems to break things
   {
+    auto Linking = Phases->scope("linking", TheModule.get());
     Linker TheLinker(*TheModule);
     bool Result = TheLinker.linkInModule(std::move(EarlyLinkedModule),
                                          Linker::None);
@@ -1091,10 +1090,28 @@ void CodeGenerator::translate(uint64_t VirtualAddress) {
 
   Variables.finalize();
 
-  Debug->generateDebugInfo();
+  {
+    auto DebugInfo = Phases->scope("debug-info", TheModule.get());
+    Debug->generateDebugInfo();
+  }
 }
 
 void CodeGenerator::serialize() {
+  if (PTCInstructions) {
+    std::ofstream TableOutput(OutputPath + ".ptc-table");
+    PTCInstructions->serialize(TableOutput);
+  }
+
+  if (ModuleFormat == OF::Bitcode) {
+    // Stream the bitcode straight to the output file, the debug source, if
+    // any, has already been produced by generateDebugInfo
+    std::error_code EC;
+    raw_fd_ostream Output(OutputPath, EC, sys::fs::F_None);
+    revng_check(not EC, "Couldn't open the output file");
+    WriteBitcodeToFile(*TheModule, Output);
+    return;
+  }
+
   // Ask the debug handler if it already has a good copy of the IR, if not dump
   // it
   if (!Debug->copySource()) {
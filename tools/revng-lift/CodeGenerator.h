@@ -18,6 +18,7 @@
 
 // Local includes
 #include "BinaryFile.h"
+#include "CSVAccessSummaries.h"
 
 // Forward declarations
 namespace llvm {
@@ -37,6 +38,7 @@ class ObjectFile;
 }; // namespace llvm
 
 class DebugHelper;
+class PTCTable;
 
 /// Translator from binary code to LLVM IR.
 class CodeGenerator {
@@ -49,12 +51,15 @@ public:
   /// \param Target target architecture.
   /// \param Output path where the generate LLVM IR must be saved.
   /// \param Helpers path of the LLVM IR file containing the QEMU helpers.
+  /// \param LibTinycode path of libtinycode, loaded again by each decoding
+  ///        thread.
   CodeGenerator(BinaryFile &Binary,
                 Architecture &Target,
                 llvm::LLVMContext &TheContext,
                 std::string Output,
                 std::string Helpers,
-                std::string EarlyLinked);
+                std::string EarlyLinked,
+                std::string LibTinycode);
 
   ~CodeGenerator();
 
@@ -93,9 +98,12 @@ private:
   llvm::LLVMContext &Context;
   std::unique_ptr<llvm::Module> TheModule;
   std::unique_ptr<llvm::Module> HelpersModule;
+  std::unique_ptr<CSVAccessSummaries> HelpersSummaries;
   std::unique_ptr<llvm::Module> EarlyLinkedModule;
   std::string OutputPath;
+  std::string LibTinycodePath;
   std::unique_ptr<DebugHelper> Debug;
+  std::unique_ptr<PTCTable> PTCInstructions;
   BinaryFile &Binary;
 
   unsigned OriginalInstrMDKind;
@@ -0,0 +1,174 @@
+#ifndef EXPLORATIONWORKLIST_H
+#define EXPLORATIONWORKLIST_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <cstdint>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/DenseMap.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+#include "revng/Support/revng.h"
+
+namespace llvm {
+class BasicBlock;
+}
+
+namespace ExplorationOrder {
+
+/// \brief Order in which the jump targets are explored
+enum Values {
+  /// The most recently registered jump target first
+  LIFO,
+  /// The jump target with the lowest address first
+  Address,
+  /// The callees and the function symbols first, then in LIFO order
+  Reason
+};
+
+inline const char *getName(Values V) {
+  switch (V) {
+  case LIFO:
+    return "LIFO";
+  case Address:
+    return "Address";
+  case Reason:
+    return "Reason";
+  }
+
+  revng_abort();
+}
+
+} // namespace ExplorationOrder
+
+/// \brief Set of the jump targets still to explore
+///
+/// Each jump target can be looked up and removed by address in constant time,
+/// while the next one to explore is chosen according to an ExplorationOrder in
+/// logarithmic time.
+class ExplorationWorklist {
+public:
+  using BlockWithAddress = std::pair<uint64_t, llvm::BasicBlock *>;
+
+private:
+  /// The lowest key is explored first
+  using Key = std::tuple<unsigned, uint64_t, uint64_t>;
+
+  struct Entry {
+    llvm::BasicBlock *BB;
+    Key Position;
+  };
+
+public:
+  explicit ExplorationWorklist(ExplorationOrder::Values Order) :
+    Order(Order),
+    Sequence(0) {}
+
+  bool empty() const { return Queue.empty(); }
+  size_t size() const { return Queue.size(); }
+
+  /// \brief Schedule \p PC, associated to \p BB, for exploration
+  ///
+  /// \param Reasons the JTReason bitmask of the jump target.
+  void push(uint64_t PC, llvm::BasicBlock *BB, uint32_t Reasons) {
+    Key Position = computeKey(PC, Reasons, Sequence++);
+    bool Inserted = Entries.insert({ PC, { BB, Position } }).second;
+    revng_assert(Inserted);
+    Queue.insert(Position);
+  }
+
+  /// \brief Notify that the reasons of \p PC changed, if it's scheduled
+  void updateReasons(uint64_t PC, uint32_t Reasons) {
+    if (Order != ExplorationOrder::Reason)
+      return;
+
+    auto It = Entries.find(PC);
+    if (It == Entries.end())
+      return;
+
+    Key &Position = It->second.Position;
+    Key NewPosition = computeKey(PC, Reasons, sequence(Position));
+    if (NewPosition != Position) {
+      Queue.erase(Position);
+      Queue.insert(NewPosition);
+      Position = NewPosition;
+    }
+  }
+
+  /// \brief Get the block associated to \p PC, or nullptr if \p PC is not
+  ///        scheduled
+  llvm::BasicBlock *find(uint64_t PC) const {
+    auto It = Entries.find(PC);
+    return It == Entries.end() ? nullptr : It->second.BB;
+  }
+
+  void erase(uint64_t PC) {
+    auto It = Entries.find(PC);
+    revng_assert(It != Entries.end());
+    Queue.erase(It->second.Position);
+    Entries.erase(It);
+  }
+
+  /// \brief Remove and return the next jump target to explore
+  BlockWithAddress pop() {
+    revng_assert(not empty());
+    uint64_t PC = std::get<2>(*Queue.begin());
+    llvm::BasicBlock *BB = find(PC);
+    erase(PC);
+    return BlockWithAddress(PC, BB);
+  }
+
+  /// \brief Return up to \p Count PCs that pop will return next, in order
+  std::vector<uint64_t> upcoming(unsigned Count) const {
+    std::vector<uint64_t> Result;
+    auto It = Queue.begin();
+    for (; It != Queue.end() && Result.size() < Count; It++)
+      Result.push_back(std::get<2>(*It));
+    return Result;
+  }
+
+private:
+  Key computeKey(uint64_t PC, uint32_t Reasons, uint64_t Number) const {
+    // Invert the sequence number, so that the most recent comes first
+    uint64_t Recency = ~Number;
+
+    switch (Order) {
+    case ExplorationOrder::LIFO:
+      return Key(0, Recency, PC);
+
+    case ExplorationOrder::Address:
+      return Key(0, PC, PC);
+
+    case ExplorationOrder::Reason: {
+      auto Preferred = static_cast<uint32_t>(JTReason::Callee)
+                       | static_cast<uint32_t>(JTReason::FunctionSymbol);
+      unsigned Rank = (Reasons & Preferred) != 0 ? 0 : 1;
+      return Key(Rank, Recency, PC);
+    }
+    }
+
+    revng_abort();
+  }
+
+  uint64_t sequence(const Key &Position) const {
+    revng_assert(Order != ExplorationOrder::Address);
+    return ~std::get<1>(Position);
+  }
+
+private:
+  ExplorationOrder::Values Order;
+  uint64_t Sequence;
+  llvm::DenseMap<uint64_t, Entry> Entries;
+  std::set<Key> Queue;
+};
+
+#endif // EXPLORATIONWORKLIST_H
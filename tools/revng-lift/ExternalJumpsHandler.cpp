@@ -183,11 +183,12 @@ llvm::BasicBlock *ExternalJumpsHandler::createSetjmp(BasicBlock *FirstReturn,
 void ExternalJumpsHandler::buildExecutableSegmentsList() {
   SmallVector<Constant *, 10> ExecutableSegments;
   auto Int = [this](uint64_t V) { return ConstantInt::get(RegisterType, V); };
-  for (auto &Segment : TheBinary.segments()) {
-    if (Segment.IsExecutable) {
-      ExecutableSegments.push_back(Int(Segment.StartVirtualAddress));
-      ExecutableSegments.push_back(Int(Segment.EndVirtualAddress));
-    }
+
+  // The segments are sorted and disjoint, so support.c can look them up with
+  // a binary search
+  for (auto &Range : TheBinary.executableSegments().intervals()) {
+    ExecutableSegments.push_back(Int(Range.first));
+    ExecutableSegments.push_back(Int(Range.second));
   }
 
   auto *SegmentsType = ArrayType::get(RegisterType, ExecutableSegments.size());
@@ -91,7 +91,8 @@ private:
   ///
   /// * an unamed array of uint64_t large as twice the number of executable
   ///   segments, where the even entries contain the start address of a segment
-  ///   and odd ones the end address.
+  ///   and odd ones the end address. The segments are sorted by address and
+  ///   contiguous ones are merged.
   /// * "segment_boundaries": a `uint64_t *` targeting the previous array.
   /// * "segments_count": an uint64_t containing the number of executable
   ///   segments.
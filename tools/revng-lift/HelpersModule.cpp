@@ -0,0 +1,271 @@
+/// \file helpersmodule.cpp
+/// \brief This file handles the preparation of the QEMU helpers module.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <algorithm>
+#include <array>
+
+// LLVM includes
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+#include "revng/Support/Debug.h"
+
+// Local includes
+#include "HelpersModule.h"
+
+using namespace llvm;
+
+/// Name of the named metadata marking a helpers module as already prepared
+static const char *PreparedMDName = "revng.prepared-helpers";
+
+template<typename T, typename... Args>
+inline std::array<T, sizeof...(Args)> make_array(Args &&... args) {
+  return { { std::forward<Args>(args)... } };
+}
+
+static BasicBlock *replaceFunction(Function *ToReplace) {
+  ToReplace->setLinkage(GlobalValue::InternalLinkage);
+  ToReplace->dropAllReferences();
+
+  return BasicBlock::Create(ToReplace->getParent()->getContext(),
+                            "",
+                            ToReplace);
+}
+
+static void replaceFunctionWithRet(Function *ToReplace, uint64_t Result) {
+  if (ToReplace == nullptr)
+    return;
+
+  BasicBlock *Body = replaceFunction(ToReplace);
+  Value *ResultValue;
+
+  if (ToReplace->getReturnType()->isVoidTy()) {
+    revng_assert(Result == 0);
+    ResultValue = nullptr;
+  } else if (ToReplace->getReturnType()->isIntegerTy()) {
+    auto *ReturnType = cast<IntegerType>(ToReplace->getReturnType());
+    ResultValue = ConstantInt::get(ReturnType, Result, false);
+  } else {
+    revng_unreachable("No-op functions can only return void or an integer "
+                      "type");
+  }
+
+  ReturnInst::Create(ToReplace->getParent()->getContext(), ResultValue, Body);
+}
+
+class CpuLoopFunctionPass : public llvm::ModulePass {
+public:
+  static char ID;
+
+  CpuLoopFunctionPass() : llvm::ModulePass(ID) {}
+
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+
+  bool runOnModule(llvm::Module &M) override;
+};
+
+char CpuLoopFunctionPass::ID = 0;
+
+using RegisterCLF = RegisterPass<CpuLoopFunctionPass>;
+static RegisterCLF Y("cpu-loop", "cpu_loop FunctionPass", false, false);
+
+void CpuLoopFunctionPass::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
+  AU.addRequired<LoopInfoWrapperPass>();
+}
+
+template<class Range, class UnaryPredicate>
+auto find_unique(Range &&TheRange, UnaryPredicate Predicate)
+  -> decltype(*TheRange.begin()) {
+
+  const auto Begin = TheRange.begin();
+  const auto End = TheRange.end();
+
+  auto It = std::find_if(Begin, End, Predicate);
+  auto Result = It;
+  revng_assert(Result != End);
+  revng_assert(std::find_if(++It, End, Predicate) == End);
+
+  return *Result;
+}
+
+template<class Range>
+auto find_unique(Range &&TheRange) -> decltype(*TheRange.begin()) {
+
+  const auto Begin = TheRange.begin();
+  const auto End = TheRange.end();
+
+  auto Result = Begin;
+  revng_assert(Begin != End && ++Result == End);
+
+  return *Begin;
+}
+
+bool CpuLoopFunctionPass::runOnModule(Module &M) {
+  Function &F = *M.getFunction("cpu_loop");
+
+  // cpu_loop must return void
+  revng_assert(F.getReturnType()->isVoidTy());
+
+  Module *TheModule = F.getParent();
+
+  // Part 1: remove the backedge of the main infinite loop
+  const LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+  const Loop *OutermostLoop = find_unique(LI);
+
+  BasicBlock *Header = OutermostLoop->getHeader();
+
+  // Check that the header has only one predecessor inside the loop
+  auto IsInLoop = [&OutermostLoop](BasicBlock *Predecessor) {
+    return OutermostLoop->contains(Predecessor);
+  };
+  BasicBlock *Footer = find_unique(predecessors(Header), IsInLoop);
+
+  // Assert on the type of the last instruction (branch or brcond)
+  revng_assert(Footer->end() != Footer->begin());
+  Instruction *LastInstruction = &*--Footer->end();
+  revng_assert(isa<BranchInst>(LastInstruction));
+
+  // Remove the last instruction and replace it with a ret
+  LastInstruction->eraseFromParent();
+  ReturnInst::Create(F.getParent()->getContext(), Footer);
+
+  // Part 2: replace the call to cpu_*_exec with exception_index
+  auto IsCpuExec = [](Function &TheFunction) {
+    StringRef Name = TheFunction.getName();
+    return Name.startswith("cpu_") && Name.endswith("_exec");
+  };
+  Function &CpuExec = find_unique(F.getParent()->functions(), IsCpuExec);
+
+  User *CallUser = find_unique(CpuExec.users(), [&F](User *TheUser) {
+    auto *TheInstruction = dyn_cast<Instruction>(TheUser);
+
+    if (TheInstruction == nullptr)
+      return false;
+
+    return TheInstruction->getParent()->getParent() == &F;
+  });
+
+  auto *Call = cast<CallInst>(CallUser);
+  revng_assert(Call->getCalledFunction() == &CpuExec);
+  Value *ExceptionIndex = TheModule->getOrInsertGlobal("exception_index",
+                                                       CpuExec.getReturnType());
+  Value *LoadExceptionIndex = new LoadInst(ExceptionIndex, "", Call);
+  Call->replaceAllUsesWith(LoadExceptionIndex);
+  Call->eraseFromParent();
+
+  return true;
+}
+
+void prepareHelpersModule(Module &HelpersModule) {
+  for (auto &F : HelpersModule.functions()) {
+    // Remove 'optnone' Function attribute from QEMU helpers.
+    // QEMU helpers are compiled with -O0 in libtinycode because the LLVM IR
+    // generated in this way it much more readable, but we need to optimize
+    // them when we link them with the decompiled code.
+    // In particular we desperately need SROA to get rid of allocas, to
+    // enable the CPUStateAccessAnalysisPass.
+    // If we don't remove this attribute future optimizations are blocked.
+    F.removeFnAttr(Attribute::OptimizeNone);
+    F.setDSOLocal(false);
+  }
+
+  legacy::PassManager CpuLoopPM;
+  CpuLoopPM.add(new LoopInfoWrapperPass());
+  CpuLoopPM.add(new CpuLoopFunctionPass());
+  CpuLoopPM.run(HelpersModule);
+
+  // Handle some specific QEMU functions as no-ops or abort
+  auto NoOpFunctionNames = make_array<const char *>("cpu_dump_state",
+                                                    "cpu_exit",
+                                                    "end_exclusive"
+                                                    "fprintf",
+                                                    "mmap_lock",
+                                                    "mmap_unlock",
+                                                    "pthread_cond_broadcast",
+                                                    "pthread_mutex_unlock",
+                                                    "pthread_mutex_lock",
+                                                    "pthread_cond_wait",
+                                                    "pthread_cond_signal",
+                                                    "process_pending_signals",
+                                                    "qemu_log_mask",
+                                                    "qemu_thread_atexit_init",
+                                                    "start_exclusive");
+  auto AbortFunctionNames = make_array<const char *>("cpu_restore_state",
+                                                     "cpu_mips_exec",
+                                                     "gdb_handlesig",
+                                                     "queue_signal",
+                                                     // syscall.c
+                                                     "do_ioctl_dm",
+                                                     "print_syscall",
+                                                     "print_syscall_ret",
+                                                     // ARM cpu_loop
+                                                     "cpu_abort",
+                                                     "do_arm_semihosting",
+                                                     "EmulateAll");
+
+  // do_arm_semihosting: we don't care about semihosting
+  // EmulateAll: requires access to the opcode
+
+  for (auto Name : NoOpFunctionNames)
+    replaceFunctionWithRet(HelpersModule.getFunction(Name), 0);
+
+  for (auto Name : AbortFunctionNames) {
+    Function *TheFunction = HelpersModule.getFunction(Name);
+    if (TheFunction != nullptr) {
+      revng_assert(HelpersModule.getFunction("abort") != nullptr);
+      BasicBlock *NewBody = replaceFunction(TheFunction);
+      CallInst::Create(HelpersModule.getFunction("abort"), {}, NewBody);
+      new UnreachableInst(HelpersModule.getContext(), NewBody);
+    }
+  }
+
+  replaceFunctionWithRet(HelpersModule.getFunction("page_check_range"), 1);
+  replaceFunctionWithRet(HelpersModule.getFunction("page_get_flags"),
+                         0xffffffff);
+
+  HelpersModule.getOrInsertNamedMetadata(PreparedMDName);
+}
+
+std::unique_ptr<Module> loadHelpersModule(StringRef Path,
+                                          LLVMContext &Context) {
+  // Bitcode files are loaded lazily, textual ones are parsed entirely
+  SMDiagnostic Errors;
+  std::unique_ptr<Module> Result = getLazyIRFileModule(Path, Errors, Context);
+
+  if (Result.get() == nullptr) {
+    Errors.print("revng", dbgs());
+    revng_abort();
+  }
+
+  NamedMDNode *Prepared = Result->getNamedMetadata(PreparedMDName);
+  if (Prepared == nullptr) {
+    // Preparing the module requires all the function bodies
+    if (Error Err = Result->materializeAll()) {
+      logAllUnhandledErrors(std::move(Err), errs(), "revng: ");
+      revng_abort();
+    }
+
+    prepareHelpersModule(*Result);
+    Prepared = Result->getNamedMetadata(PreparedMDName);
+  }
+
+  // We don't want the marker to end up in the translated code
+  Prepared->eraseFromParent();
+
+  return Result;
+}
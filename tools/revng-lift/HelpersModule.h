@@ -0,0 +1,37 @@
+#ifndef HELPERSMODULE_H
+#define HELPERSMODULE_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <memory>
+
+// LLVM includes
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+class LLVMContext;
+class Module;
+} // namespace llvm
+
+/// \brief Prepare the module of the QEMU helpers to be linked with the
+///        translated code
+///
+/// Removes `optnone` from the helpers, patches `cpu_loop` so that it returns
+/// after handling a single exception and replaces the QEMU functions we don't
+/// need with no-ops or aborts. None of this depends on the input binary,
+/// therefore it can be performed ahead of time, see `revng-prepare-helpers`.
+void prepareHelpersModule(llvm::Module &HelpersModule);
+
+/// \brief Load the module of the QEMU helpers at \p Path, preparing it if
+///        necessary
+///
+/// If \p Path is a bitcode file produced by `revng-prepare-helpers`, the
+/// bodies of the functions are materialized lazily, i.e., only those of the
+/// helpers actually linked in the translated code are loaded.
+std::unique_ptr<llvm::Module> loadHelpersModule(llvm::StringRef Path,
+                                                llvm::LLVMContext &Context);
+
+#endif // HELPERSMODULE_H
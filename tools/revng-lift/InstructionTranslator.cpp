@@ -142,7 +142,7 @@ public:
 
   std::string helperName() const {
     revng_assert(IsCall);
-    PTCHelperDef *Helper = ptc_find_helper(&ptc, ConstArguments[0]);
+    PTCHelperDef *Helper = findHelper(ConstArguments[0]);
     revng_assert(Helper != nullptr && Helper->name != nullptr);
     return std::string(Helper->name);
   }
@@ -475,7 +475,8 @@ IT::InstructionTranslator(IRBuilder<> &Builder,
   TheFunction(Builder.GetInsertBlock()->getParent()),
   SourceArchitecture(SourceArchitecture),
   TargetArchitecture(TargetArchitecture),
-  NewPCMarker(nullptr) {
+  NewPCMarker(nullptr),
+  Instructions(nullptr) {
 
   auto &Context = TheModule.getContext();
   using FT = FunctionType;
@@ -524,10 +525,14 @@ void IT::finalizeNewPCMarkers(std::string &CoveragePath) {
   Output << std::dec;
 }
 
-SmallSet<unsigned, 1> IT::preprocess(PTCInstructionList *InstructionList) {
-  SmallSet<unsigned, 1> Result;
+void IT::preprocess(PTCInstructionList *InstructionList) {
+  Instructions = InstructionList;
+  unsigned Count = InstructionList->instruction_count;
 
-  for (unsigned I = 0; I < InstructionList->instruction_count; I++) {
+  // A write to btarget signals a delay slot, all the following
+  // PTC_INSTRUCTION_op_debug_insn_start have to be ignored
+  unsigned IgnoreFrom = Count;
+  for (unsigned I = 0; I < Count; I++) {
     PTCInstruction &Instruction = InstructionList->instructions[I];
     switch (Instruction.opc) {
     case PTC_INSTRUCTION_op_movi_i32:
@@ -549,16 +554,36 @@ SmallSet<unsigned, 1> IT::preprocess(PTCInstructionList *InstructionList) {
     if (0 != strcmp("btarget", Temporary->name))
       continue;
 
-    for (unsigned J = I + 1; J < InstructionList->instruction_count; J++) {
-      unsigned Opcode = InstructionList->instructions[J].opc;
-      if (Opcode == PTC_INSTRUCTION_op_debug_insn_start)
-        Result.insert(J);
-    }
-
+    IgnoreFrom = I + 1;
     break;
   }
 
-  return Result;
+  // Compute the next PTC_INSTRUCTION_op_debug_insn_start for each instruction
+  // in a single backward pass
+  InstructionStarts.resize(Count + 1);
+  InstructionStarts[Count] = Count;
+  for (unsigned I = Count; I > 0; I--) {
+    unsigned Index = I - 1;
+    unsigned Opcode = InstructionList->instructions[Index].opc;
+    if (Opcode == PTC_INSTRUCTION_op_debug_insn_start && Index < IgnoreFrom)
+      InstructionStarts[Index] = Index;
+    else
+      InstructionStarts[Index] = InstructionStarts[Index + 1];
+  }
+}
+
+bool IT::isIgnored(unsigned Index) const {
+  unsigned Opcode = Instructions->instructions[Index].opc;
+  return Opcode == PTC_INSTRUCTION_op_debug_insn_start
+         && InstructionStarts[Index] != Index;
+}
+
+PTCInstruction *IT::nextInstructionStart(unsigned Index) const {
+  unsigned Next = InstructionStarts[Index + 1];
+  if (Next == Instructions->instruction_count)
+    return nullptr;
+
+  return &Instructions->instructions[Next];
 }
 
 std::tuple<IT::TranslationResult, MDNode *, uint64_t, uint64_t>
@@ -11,7 +11,6 @@
 #include <vector>
 
 // LLVM includes
-#include "llvm/ADT/SmallSet.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/ErrorOr.h"
@@ -119,10 +118,23 @@ public:
 
   /// \brief Preprocess the translated instructions
   ///
-  /// Check if the translated code contains a delay slot and return a blacklist
-  /// of the PTC_INSTRUCTION_op_debug_insn_start instructions that have to be
-  /// ignored to merge the delay slot into the branch instruction.
-  llvm::SmallSet<unsigned, 1> preprocess(PTCInstructionList *Instructions);
+  /// Check if the translated code contains a delay slot, in which case the
+  /// PTC_INSTRUCTION_op_debug_insn_start instructions following it have to be
+  /// ignored to merge the delay slot into the branch instruction. Then, for
+  /// each instruction, record the position of the next
+  /// PTC_INSTRUCTION_op_debug_insn_start to consider.
+  ///
+  /// The results can be queried through isIgnored and nextInstructionStart,
+  /// until the next call.
+  void preprocess(PTCInstructionList *Instructions);
+
+  /// \brief Check if the instruction at \p Index is a
+  ///        PTC_INSTRUCTION_op_debug_insn_start to ignore
+  bool isIgnored(unsigned Index) const;
+
+  /// \brief Get the first PTC_INSTRUCTION_op_debug_insn_start not to be
+  ///        ignored after the instruction at \p Index, if any
+  PTCInstruction *nextInstructionStart(unsigned Index) const;
 
 private:
   llvm::ErrorOr<std::vector<llvm::Value *>>
@@ -146,6 +158,14 @@ private:
   llvm::Function *NewPCMarker;
 
   uint64_t LastPC;
+
+  PTCInstructionList *Instructions;
+
+  /// For each instruction of Instructions, the index of the first
+  /// PTC_INSTRUCTION_op_debug_insn_start not to be ignored starting from it.
+  /// The last element is the instruction count and stands for "none". It's
+  /// kept across translations to avoid reallocating it each time.
+  std::vector<unsigned> InstructionStarts;
 };
 
 #endif // INSTRUCTIONTRANSLATOR_H
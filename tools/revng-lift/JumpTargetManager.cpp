@@ -9,25 +9,33 @@
 
 // Standard includes
 #include "revng/Support/Assert.h"
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <queue>
 #include <sstream>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 // Boost includes
 #include <boost/icl/interval_set.hpp>
 #include <boost/icl/right_open_interval.hpp>
 #include <boost/type_traits/is_same.hpp>
 
 // LLVM includes
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
@@ -38,10 +46,12 @@
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/IRHelpers.h"
+#include "revng/Support/PhaseReport.h"
 #include "revng/Support/revng.h"
 
 // Local includes
 #include "JumpTargetManager.h"
+#include "RegionCleanup.h"
 #include "SET.h"
 #include "SimplifyComparisonsPass.h"
 #include "SubGraph.h"
@@ -58,6 +68,104 @@ cl::alias A1("O",
              cl::aliasopt(NoOSRA),
              cl::cat(MainCategory));
 
+namespace EO = ExplorationOrder;
+auto Orders = cl::values(clEnumValN(EO::LIFO,
+                                    "lifo",
+                                    "most recently found jump target first"),
+                         clEnumValN(EO::Address,
+                                    "address",
+                                    "lowest address first, for locality"),
+                         clEnumValN(EO::Reason,
+                                    "reason",
+                                    "callees and function symbols first"));
+cl::opt<EO::Values> Exploration("exploration-order",
+                                cl::desc("order in which the jump targets are "
+                                         "explored"),
+                                Orders,
+                                cl::cat(MainCategory),
+                                cl::init(EO::LIFO));
+
+cl::opt<bool> RegionHarvestCleanup("region-harvest-cleanup",
+                                   cl::desc("at each harvest, clean up only "
+                                            "the code changed since the "
+                                            "previous one, instead of the "
+                                            "whole root function"),
+                                   cl::cat(MainCategory));
+
+cl::opt<bool> ReuseSplits("reuse-splits",
+                          cl::desc("reuse the translation of the code "
+                                   "following a jump target found in the "
+                                   "middle of a basic block, instead of "
+                                   "translating it again"),
+                          cl::cat(MainCategory));
+
+cl::opt<bool> IncrementalOSRAOpt("incremental-osra",
+                                 cl::desc("preserve the results of OSRA "
+                                          "across harvests, analyzing again "
+                                          "only the code that changed"),
+                                 cl::cat(MainCategory));
+
+cl::opt<bool> MemoizeSET("memoize-set",
+                         cl::desc("don't explore again in SET the loads and "
+                                  "stores whose code didn't change since the "
+                                  "previous harvest"),
+                         cl::cat(MainCategory));
+
+cl::opt<unsigned> OSRAMaxIterations("osra-max-iterations",
+                                    cl::desc("maximum number of SET + OSRA "
+                                             "iterations, 0 for no limit"),
+                                    cl::cat(MainCategory),
+                                    cl::init(0));
+
+cl::opt<unsigned> OSRATimeBudget("osra-time-budget",
+                                 cl::desc("maximum number of seconds to spend "
+                                          "in SET + OSRA, 0 for no limit"),
+                                 cl::cat(MainCategory),
+                                 cl::init(0));
+
+cl::opt<unsigned> OSRAMemoryBudget("osra-memory-budget",
+                                   cl::desc("peak RSS, in MiB, beyond which "
+                                            "SET + OSRA is no longer run, 0 "
+                                            "for no limit"),
+                                   cl::cat(MainCategory),
+                                   cl::init(0));
+
+namespace BudgetFallback {
+
+enum Values {
+  /// Keep harvesting with SET only
+  SETOnly,
+  /// Stop harvesting, keep the jump targets found so far
+  Stop
+};
+
+inline const char *getName(Values V) {
+  switch (V) {
+  case SETOnly:
+    return "SETOnly";
+  case Stop:
+    return "Stop";
+  }
+
+  revng_abort();
+}
+
+} // namespace BudgetFallback
+
+namespace BF = BudgetFallback;
+auto Fallbacks = cl::values(clEnumValN(BF::SETOnly,
+                                       "set-only",
+                                       "keep harvesting with SET only"),
+                            clEnumValN(BF::Stop,
+                                       "stop",
+                                       "stop harvesting"));
+cl::opt<BF::Values> OSRABudgetFallback("osra-budget-fallback",
+                                       cl::desc("what to do when the SET + "
+                                                "OSRA budget is exceeded"),
+                                       Fallbacks,
+                                       cl::cat(MainCategory),
+                                       cl::init(BF::SETOnly));
+
 RegisterPass<TranslateDirectBranchesPass> X("translate-db",
                                             "Translate Direct Branches"
                                             " Pass",
@@ -172,7 +280,9 @@ bool TranslateDirectBranchesPass::pinJTs(Function &F) {
     // Notify new branches only if the amount of possible targets actually
     // increased
     if (Destinations.size() > OldTargetsCount)
-      JTM->newBranch();
+      JTM->newBranch(BB);
+    else
+      JTM->invalidate(BB);
   }
 
   return true;
@@ -223,12 +333,13 @@ bool TranslateDirectBranchesPass::pinConstantStore(Function &F) {
             if (TargetBlock != nullptr) {
               // A target was found, jump there
               BranchInst::Create(TargetBlock, Call);
-              JTM->newBranch();
+              JTM->newBranch(Call->getParent());
             } else {
               // We're jumping to an invalid location, abort everything
               // TODO: emit a warning
               CallInst::Create(F.getParent()->getFunction("abort"), {}, Call);
               new UnreachableInst(Context, Call);
+              JTM->invalidate(Call->getParent());
             }
             Call->eraseFromParent();
           }
@@ -290,7 +401,7 @@ bool TranslateDirectBranchesPass::forceFallthroughAfterHelper(CallInst *Call) {
   }
 
   exitTBCleanup(Call);
-  JTM->newBranch();
+  JTM->newBranch(Call->getParent());
 
   IRBuilder<> Builder(Call->getParent());
   Call->setArgOperand(0, Builder.getInt32(1));
@@ -382,8 +493,7 @@ ConstantInt *JumpTargetManager::readConstantInt(Constant *ConstantAddress,
   }
 
   uint64_t Address = getZExtValue(ConstantAddress, DL);
-  UnusedCodePointers.erase(Address);
-  registerReadRange(Address, Size);
+  registerRead(Address, Size);
 
   auto Result = Binary.readRawValue(Address, Size, E);
 
@@ -408,6 +518,7 @@ JumpTargetManager::JumpTargetManager(Function *TheFunction,
   TheFunction(TheFunction),
   OriginalInstructionAddresses(),
   JumpTargets(),
+  Unexplored(Exploration),
   PCReg(PCReg),
   ExitTB(nullptr),
   Dispatcher(nullptr),
@@ -421,9 +532,6 @@ JumpTargetManager::JumpTargetManager(Function *TheFunction,
   ExitTB = cast<Function>(TheModule.getOrInsertFunction("exitTB", ExitTBTy));
   createDispatcher(TheFunction, PCReg);
 
-  for (auto &Segment : Binary.segments())
-    Segment.insertExecutableRanges(std::back_inserter(ExecutableRanges));
-
   // Configure GlobalValueNumbering
   StringMap<cl::Option *> &Options(cl::getRegisteredOptions());
   getOption<bool>(Options, "enable-load-pre")->setInitialValue(false);
@@ -531,14 +639,11 @@ void JumpTargetManager::harvestGlobalData() {
     registerJT(CodePointer, JTReason::GlobalData);
 
   for (auto &Segment : Binary.segments()) {
-    const Constant *Initializer = Segment.Variable->getInitializer();
-    if (isa<ConstantAggregateZero>(Initializer))
-      continue;
-
-    auto *Data = cast<ConstantDataArray>(Initializer);
+    // Scan the content of the segment in the input file, the variable might
+    // not have an initializer and the rest of the segment is zero anyway
     uint64_t StartVirtualAddress = Segment.StartVirtualAddress;
-    const unsigned char *DataStart = Data->getRawDataValues().bytes_begin();
-    const unsigned char *DataEnd = Data->getRawDataValues().bytes_end();
+    const unsigned char *DataStart = Segment.Data.begin();
+    const unsigned char *DataEnd = Segment.Data.end();
 
     using endianness = support::endianness;
     if (Binary.architecture().pointerSize() == 64) {
@@ -567,18 +672,220 @@ void JumpTargetManager::harvestGlobalData() {
                                                  << Unexplored.size());
 }
 
+namespace {
+
+/// \brief Cheap filter for the values that might be code pointers
+///
+/// A value is a candidate if it's aligned and falls in [Low, Low + Width), the
+/// smallest interval containing all the executable ranges. Candidates still
+/// have to be checked against the actual executable ranges.
+template<typename value_type, unsigned endian>
+class CodePointerFilter {
+private:
+  static constexpr auto Endianness = static_cast<support::endianness>(endian);
+
+public:
+  /// \brief Number of consecutive offsets tested by a single call to filter
+  static const unsigned BlockSize = 16;
+
+public:
+  CodePointerFilter(uint64_t Low, uint64_t Width, uint64_t AlignmentMask) :
+    Low(Low),
+    Width(Width),
+    AlignmentMask(AlignmentMask) {
+
+#ifdef __SSE2__
+    // The SSE2 implementation compares 32-bit lanes: for 64-bit values, the
+    // [Low, Low + Width) interval must not cross a 4 GiB boundary, so that the
+    // upper half of a candidate is the same as the upper half of Low
+    uint64_t Last = Low + Width - 1;
+    if (Width == 0 or Width > UINT32_MAX or AlignmentMask > UINT32_MAX)
+      UseSSE2 = false;
+    else if (sizeof(value_type) == 4)
+      UseSSE2 = Last <= UINT32_MAX;
+    else
+      UseSSE2 = (Low >> 32) == (Last >> 32);
+
+    // Unsigned V - Low < Width is computed as a signed comparison, flipping
+    // the sign bit of both sides
+    LowVector = _mm_set1_epi32(static_cast<int32_t>(Low));
+    WidthVector = _mm_set1_epi32(static_cast<int32_t>(Width ^ 0x80000000));
+    HighVector = _mm_set1_epi32(static_cast<int32_t>(Low >> 32));
+    MaskVector = _mm_set1_epi32(static_cast<int32_t>(AlignmentMask));
+#endif
+  }
+
+  value_type read(const unsigned char *Data) const {
+    return support::endian::read<value_type, Endianness, 1>(Data);
+  }
+
+  bool check(uint64_t Value) const {
+    return Value - Low < Width and (Value & AlignmentMask) == 0;
+  }
+
+  /// \brief Return a bitmask with bit I set if the value at \p Data + I is a
+  ///        candidate, for I in [0, \p Count)
+  ///
+  /// Reads up to \p Count + sizeof(value_type) - 1 bytes from \p Data.
+  uint16_t filter(const unsigned char *Data, unsigned Count) const {
+    revng_assert(Count <= BlockSize);
+
+#ifdef __SSE2__
+    if (UseSSE2 and Count == BlockSize)
+      return filterSSE2(Data);
+#endif
+
+    uint16_t Result = 0;
+    for (unsigned I = 0; I < Count; I++)
+      if (check(read(Data + I)))
+        Result |= 1 << I;
+    return Result;
+  }
+
+private:
+#ifdef __SSE2__
+  /// \brief Load the 32-bit values at \p Data, \p Data + 4, \p Data + 8 and
+  ///        \p Data + 12 in native byte order
+  static __m128i load32(const unsigned char *Data) {
+    __m128i Result = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Data));
+
+    if (Endianness == support::endianness::big) {
+      // Swap the 16-bit words of each lane, then the bytes of each word
+      Result = _mm_shufflelo_epi16(Result, _MM_SHUFFLE(2, 3, 0, 1));
+      Result = _mm_shufflehi_epi16(Result, _MM_SHUFFLE(2, 3, 0, 1));
+      Result = _mm_or_si128(_mm_slli_epi16(Result, 8),
+                            _mm_srli_epi16(Result, 8));
+    }
+
+    return Result;
+  }
+
+  /// \brief Set each lane of the result if the corresponding lane of \p V, or
+  ///        the lower half of the value, for 64-bit values, is a candidate
+  __m128i check32(__m128i V) const {
+    const __m128i Sign = _mm_set1_epi32(INT32_MIN);
+    __m128i Offset = _mm_xor_si128(_mm_sub_epi32(V, LowVector), Sign);
+    __m128i InRange = _mm_cmplt_epi32(Offset, WidthVector);
+    __m128i Masked = _mm_and_si128(V, MaskVector);
+    __m128i Aligned = _mm_cmpeq_epi32(Masked, _mm_setzero_si128());
+    return _mm_and_si128(InRange, Aligned);
+  }
+
+  /// \brief SSE2 implementation of filter for a whole block
+  ///
+  /// A load of four 32-bit lanes at \p Data + K covers the offsets K, K + 4,
+  /// K + 8 and K + 12, therefore four loads cover the whole block. The lanes
+  /// of the four results are then transposed so that they are in offset
+  /// order, and narrowed to a single byte each to extract the bitmask.
+  uint16_t filterSSE2(const unsigned char *Data) const {
+    __m128i Matches[4];
+    for (unsigned K = 0; K < 4; K++) {
+      if (sizeof(value_type) == 4) {
+        Matches[K] = check32(load32(Data + K));
+      } else {
+        // A 64-bit value is made of two 32-bit values, one of which must pass
+        // check32 and the other one must match the upper half of Low
+        const bool IsLittleEndian = Endianness
+                                    == support::endianness::little;
+        const unsigned char *LowerHalf = Data + K + (IsLittleEndian ? 0 : 4);
+        const unsigned char *UpperHalf = Data + K + (IsLittleEndian ? 4 : 0);
+        __m128i UpperMatches = _mm_cmpeq_epi32(load32(UpperHalf), HighVector);
+        Matches[K] = _mm_and_si128(check32(load32(LowerHalf)), UpperMatches);
+      }
+    }
+
+    // Matches[K] lane J refers to offset 4 * J + K, transpose them so that
+    // Offsets[J] lane K does
+    __m128i Low01 = _mm_unpacklo_epi32(Matches[0], Matches[1]);
+    __m128i Low23 = _mm_unpacklo_epi32(Matches[2], Matches[3]);
+    __m128i High01 = _mm_unpackhi_epi32(Matches[0], Matches[1]);
+    __m128i High23 = _mm_unpackhi_epi32(Matches[2], Matches[3]);
+    __m128i Offsets0 = _mm_unpacklo_epi64(Low01, Low23);
+    __m128i Offsets1 = _mm_unpackhi_epi64(Low01, Low23);
+    __m128i Offsets2 = _mm_unpacklo_epi64(High01, High23);
+    __m128i Offsets3 = _mm_unpackhi_epi64(High01, High23);
+
+    // Lanes are either all zeros or all ones, the signed saturation preserves
+    // them
+    __m128i Words01 = _mm_packs_epi32(Offsets0, Offsets1);
+    __m128i Words23 = _mm_packs_epi32(Offsets2, Offsets3);
+    __m128i Bytes = _mm_packs_epi16(Words01, Words23);
+    return static_cast<uint16_t>(_mm_movemask_epi8(Bytes));
+  }
+#endif
+
+private:
+  const uint64_t Low;
+  const uint64_t Width;
+  const uint64_t AlignmentMask;
+
+#ifdef __SSE2__
+  bool UseSSE2;
+  __m128i LowVector;
+  __m128i WidthVector;
+  __m128i HighVector;
+  __m128i MaskVector;
+#endif
+};
+
+} // namespace
+
 template<typename value_type, unsigned endian>
 void JumpTargetManager::findCodePointers(uint64_t StartVirtualAddress,
                                          const unsigned char *Start,
                                          const unsigned char *End) {
-  using support::endianness;
-  using support::endian::read;
-  for (auto Pos = Start; Pos < End - sizeof(value_type); Pos++) {
-    uint64_t Value = read<value_type, static_cast<endianness>(endian), 1>(Pos);
-    BasicBlock *Result = registerJT(Value, JTReason::GlobalData);
-
-    if (Result != nullptr)
-      UnusedCodePointers.insert(StartVirtualAddress + (Pos - Start));
+  using Filter = CodePointerFilter<value_type, endian>;
+
+  const IntervalIndex &ExecutableRanges = Binary.executableRanges();
+  if (ExecutableRanges.empty() or End < Start + sizeof(value_type))
+    return;
+
+  // Values outside the smallest interval containing all the executable ranges
+  // can be discarded without looking at the ranges
+  const uint64_t Low = ExecutableRanges.lowest();
+  const uint64_t Width = ExecutableRanges.highest() - Low;
+
+  const uint64_t Alignment = Binary.architecture().instructionAlignment();
+  revng_assert(isPowerOf2_64(Alignment));
+  Filter CandidateFilter(Low, Width, Alignment - 1);
+
+  // Number of offsets at which a whole value can be read
+  const uint64_t Count = (End - Start) - sizeof(value_type) + 1;
+
+  // Consider the offsets in blocks, computing a bitmask of the candidates of
+  // each block, then check only the candidates precisely against the ranges
+  std::vector<std::pair<uint64_t, uint64_t>> CodePointers;
+  for (uint64_t BlockStart = 0; BlockStart < Count;
+       BlockStart += Filter::BlockSize) {
+    const unsigned char *BlockData = Start + BlockStart;
+    uint64_t BlockCount = std::min<uint64_t>(Count - BlockStart,
+                                             Filter::BlockSize);
+
+    unsigned Candidates = CandidateFilter.filter(BlockData, BlockCount);
+    while (Candidates != 0) {
+      unsigned I = countTrailingZeros(Candidates);
+      Candidates &= Candidates - 1;
+
+      uint64_t Value = CandidateFilter.read(BlockData + I);
+      if (isExecutableAddress(Value))
+        CodePointers.emplace_back(Value, StartVirtualAddress + BlockStart + I);
+    }
+  }
+
+  registerCodePointers(CodePointers);
+}
+
+void JumpTargetManager::registerCodePointers(
+  const std::vector<std::pair<uint64_t, uint64_t>> &CodePointers) {
+  // Register each jump target once, even if it's referenced multiple times,
+  // in the order in which they have been found
+  DenseSet<uint64_t> Registered;
+  for (const std::pair<uint64_t, uint64_t> &P : CodePointers) {
+    UnusedCodePointers.insert(P.second);
+    if (Registered.insert(P.first).second) {
+      BasicBlock *Result = registerJT(P.first, JTReason::GlobalData);
+      revng_assert(Result != nullptr);
+    }
   }
 }
 
@@ -599,25 +906,18 @@ BasicBlock *JumpTargetManager::newPC(uint64_t PC, bool &ShouldContinue) {
   auto JTIt = JumpTargets.find(PC);
   if (JTIt != JumpTargets.end()) {
     // If it was planned to explore it in the future, just to do it now
-    for (auto UnexploredIt = Unexplored.begin();
-         UnexploredIt != Unexplored.end();
-         UnexploredIt++) {
-
-      if (UnexploredIt->first == PC) {
-        BasicBlock *Result = UnexploredIt->second;
-
-        // Check if we already have a translation for that
-        ShouldContinue = Result->empty();
-        if (ShouldContinue) {
-          // We don't, OK let's explore it next
-          Unexplored.erase(UnexploredIt);
-        } else {
-          // We do, it will be purged at the next `peek`
-          revng_assert(ToPurge.count(Result) != 0);
-        }
-
-        return Result;
+    if (BasicBlock *Result = Unexplored.find(PC)) {
+      // Check if we already have a translation for that
+      ShouldContinue = Result->empty();
+      if (ShouldContinue) {
+        // We don't, OK let's explore it next
+        Unexplored.erase(PC);
+      } else {
+        // We do, it will be purged at the next `peek`
+        revng_assert(ToPurge.count(Result) != 0);
       }
+
+      return Result;
     }
 
     // It wasn't planned to visit it, so we've already been there, just jump
@@ -1032,20 +1332,35 @@ void JumpTargetManager::translateIndirectJumps() {
 }
 
 JumpTargetManager::BlockWithAddress JumpTargetManager::peek() {
-  harvest();
+  bool Reused = false;
+  do {
+    harvest();
+
+    // Purge all the partial translations we know might be wrong, unless they
+    // can be used as they are
+    Reused = false;
+    for (BasicBlock *BB : ToPurge) {
+      if (ReuseSplits and isSelfContained(BB)) {
+        // The newpc call is now the first instruction of a jump target
+        uint64_t PC = getPCFromNewPCCall(&*BB->begin());
+        OriginalInstructionAddresses.erase(PC);
+        Unexplored.erase(PC);
+        Reused = true;
+        revng_log(RegisterJTLog,
+                  "Reusing the translation of bb." << nameForAddress(PC));
+      } else {
+        purgeTranslation(BB);
+      }
+    }
+    ToPurge.clear();
 
-  // Purge all the partial translations we know might be wrong
-  for (BasicBlock *BB : ToPurge)
-    purgeTranslation(BB);
-  ToPurge.clear();
+    // If nothing is left to explore, harvest again
+  } while (Reused and Unexplored.empty());
 
   if (Unexplored.empty())
     return NoMoreTargets;
-  else {
-    BlockWithAddress Result = Unexplored.back();
-    Unexplored.pop_back();
-    return Result;
-  }
+  else
+    return Unexplored.pop();
 }
 
 void JumpTargetManager::unvisit(BasicBlock *BB) {
@@ -1078,7 +1393,8 @@ BasicBlock *JumpTargetManager::getBlockAt(uint64_t PC) {
   return TargetIt->second.head();
 }
 
-void JumpTargetManager::purgeTranslation(BasicBlock *Start) {
+std::set<BasicBlock *>
+JumpTargetManager::collectTranslation(BasicBlock *Start) {
   OnceQueue<BasicBlock *> Queue;
   Queue.insert(Start);
 
@@ -1093,8 +1409,14 @@ void JumpTargetManager::purgeTranslation(BasicBlock *Start) {
     }
   }
 
+  return Queue.visited();
+}
+
+void JumpTargetManager::purgeTranslation(BasicBlock *Start) {
   // Erase all the visited basic blocks
-  std::set<BasicBlock *> Visited = Queue.visited();
+  std::set<BasicBlock *> Visited = collectTranslation(Start);
+  for (BasicBlock *BB : Visited)
+    invalidate(BB);
 
   // Build a subgraph, so that we can visit it in post order, and purge the
   // content of each basic block
@@ -1114,6 +1436,7 @@ void JumpTargetManager::purgeTranslation(BasicBlock *Start) {
     while (pred_begin(BB) != pred_end(BB)) {
       BasicBlock *Predecessor = *pred_begin(BB);
       revng_assert(pred_empty(Predecessor));
+      invalidate(Predecessor);
       Predecessor->eraseFromParent();
     }
 
@@ -1122,12 +1445,91 @@ void JumpTargetManager::purgeTranslation(BasicBlock *Start) {
   }
 }
 
+bool JumpTargetManager::isSelfContained(BasicBlock *Start) {
+  // We need a newpc call to start from
+  if (Start->empty() or getPCFromNewPCCall(&*Start->begin()) == 0)
+    return false;
+
+  std::set<BasicBlock *> Translation = collectTranslation(Start);
+  BasicBlock *Entry = &TheFunction->getEntryBlock();
+
+  for (BasicBlock *BB : Translation) {
+    // The control flow must not enter the translation bypassing Start
+    if (BB != Start)
+      for (BasicBlock *Predecessor : predecessors(BB))
+        if (Translation.count(Predecessor) == 0)
+          return false;
+
+    // The translation must not use values computed before Start (e.g., due to
+    // the cleanup performed at each harvest), since Start is about to be
+    // reached from the dispatcher too. The entry block dominates everything.
+    for (Instruction &I : *BB) {
+      for (Value *Operand : I.operands()) {
+        auto *Definition = dyn_cast<Instruction>(Operand);
+        if (Definition != nullptr and Definition->getParent() != Entry
+            and Translation.count(Definition->getParent()) == 0)
+          return false;
+      }
+    }
+  }
+
+  return true;
+}
+
 // TODO: register Reason
 BasicBlock *
 JumpTargetManager::registerJT(uint64_t PC, JTReason::Values Reason) {
   if (!isExecutableAddress(PC) || !isInstructionAligned(PC))
     return nullptr;
 
+  SmallVector<std::pair<uint64_t, BasicBlock *>, 1> NewCases;
+  BasicBlock *Result = registerValidJT(PC, Reason, NewCases);
+  addDispatcherCases(NewCases);
+  return Result;
+}
+
+void JumpTargetManager::registerJTRange(uint64_t Base,
+                                        uint64_t Stride,
+                                        uint64_t Count,
+                                        JTReason::Values Reason) {
+  if (not isPCRange(Base, Stride, Count)) {
+    for (uint64_t I = 0; I < Count; I++)
+      registerJT(Base + I * Stride, Reason);
+    return;
+  }
+
+  revng_log(RegisterJTLog,
+            "Registering " << Count << " jump targets from bb."
+                           << nameForAddress(Base) << " with stride "
+                           << Stride);
+
+  // Create all the basic blocks first, then add their cases in a single pass
+  SmallVector<std::pair<uint64_t, BasicBlock *>, 16> NewCases;
+  NewCases.reserve(Count);
+  JumpTargets.reserve(JumpTargets.size() + Count);
+  for (uint64_t I = 0; I < Count; I++)
+    registerValidJT(Base + I * Stride, Reason, NewCases);
+
+  addDispatcherCases(NewCases);
+}
+
+void JumpTargetManager::addDispatcherCases(CaseList NewCases) {
+  if (NewCases.empty())
+    return;
+
+  auto *PCRegType = PCReg->getType();
+  auto *SwitchType = cast<IntegerType>(PCRegType->getPointerElementType());
+  for (const std::pair<uint64_t, BasicBlock *> &Case : NewCases) {
+    DispatcherCases[Case.second] = DispatcherSwitch->getNumCases();
+    DispatcherSwitch->addCase(ConstantInt::get(SwitchType, Case.first),
+                              Case.second);
+  }
+}
+
+BasicBlock *
+JumpTargetManager::registerValidJT(uint64_t PC,
+                                   JTReason::Values Reason,
+                                   CaseVector &NewCases) {
   revng_log(RegisterJTLog,
             "Registering bb." << nameForAddress(PC) << " for "
                               << JTReason::getName(Reason));
@@ -1138,6 +1540,7 @@ JumpTargetManager::registerJT(uint64_t PC, JTReason::Values Reason) {
     // Case 1: there's already a BasicBlock for that address, return it
     BasicBlock *BB = TargetIt->second.head();
     TargetIt->second.setReason(Reason);
+    Unexplored.updateReasons(PC, TargetIt->second.getReasons());
     unvisit(BB);
     return BB;
   }
@@ -1156,12 +1559,13 @@ JumpTargetManager::registerJT(uint64_t PC, JTReason::Values Reason) {
     } else {
       revng_assert(I != nullptr && I->getIterator() != ContainingBlock->end());
       NewBlock = ContainingBlock->splitBasicBlock(I);
+      invalidate(ContainingBlock);
+      invalidate(NewBlock);
     }
 
     // Register the basic block and all of its descendants to be purged so that
-    // we can retranslate this PC
-    // TODO: this might create a problem if QEMU generates control flow that
-    //       crosses an instruction boundary
+    // we can retranslate this PC, unless at the next peek the translation turns
+    // out to be reusable
     ToPurge.insert(NewBlock);
 
     unvisit(NewBlock);
@@ -1171,16 +1575,14 @@ JumpTargetManager::registerJT(uint64_t PC, JTReason::Values Reason) {
     NewBlock = BasicBlock::Create(Context, "", TheFunction);
   }
 
-  Unexplored.push_back(BlockWithAddress(PC, NewBlock));
+  Unexplored.push(PC, NewBlock, static_cast<uint32_t>(Reason));
 
   std::stringstream Name;
   Name << "bb." << nameForAddress(PC);
   NewBlock->setName(Name.str());
 
-  // Create a case for the address associated to the new block
-  auto *PCRegType = PCReg->getType();
-  auto *SwitchType = cast<IntegerType>(PCRegType->getPointerElementType());
-  DispatcherSwitch->addCase(ConstantInt::get(SwitchType, PC), NewBlock);
+  // The new block will need a case in the dispatcher
+  NewCases.push_back({ PC, NewBlock });
 
   // Associate the PC with the chosen basic block
   JumpTargets[PC] = JumpTarget(NewBlock, Reason);
@@ -1271,6 +1673,9 @@ void JumpTargetManager::setCFGForm(CFGForm::Values NewForm) {
   CFGForm::Values OldForm = CurrentCFGForm;
   CurrentCFGForm = NewForm;
 
+  invalidate(AnyPC);
+  invalidate(UnexpectedPC);
+
   switch (NewForm) {
   case CFGForm::SemanticPreservingCFG:
     purge(AnyPC);
@@ -1323,11 +1728,17 @@ void JumpTargetManager::setCFGForm(CFGForm::Values NewForm) {
         Value *Op = Call->getArgOperand(OperandIndex);
         BasicBlock *NewSuccessor = cast<BlockAddress>(Op)->getBasicBlock();
         Terminator->setSuccessor(0, NewSuccessor);
+        ChangedBlocks.emplace_back(Terminator->getParent());
       }
     }
   }
 
-  rebuildDispatcher();
+  // In SemanticPreservingCFG the dispatcher jumps to all the jump targets,
+  // otherwise only to those who have no other predecessor. Only update the
+  // cases that change.
+  attachJumpTargets();
+  if (NewForm != CFGForm::SemanticPreservingCFG)
+    detachJumpTargets();
 
   if (Verify.isEnabled()) {
     Unreachable = computeUnreachable();
@@ -1355,56 +1766,127 @@ void JumpTargetManager::setCFGForm(CFGForm::Values NewForm) {
   }
 }
 
-void JumpTargetManager::rebuildDispatcher() {
-  // Remove all cases
+void JumpTargetManager::attachJumpTargets() {
+  for (std::pair<unsigned, BasicBlock *> &Case : Detached)
+    (DispatcherSwitch->case_begin() + Case.first)->setSuccessor(Case.second);
+  Detached.clear();
+}
+
+void JumpTargetManager::detachJumpTargets() {
+  revng_assert(Detached.empty());
+
+  // Consider the cases that had other predecessors at the last detach, the new
+  // cases and the successors of the blocks changed since then: the jump
+  // targets of the other cases cannot have gained a predecessor
+  std::vector<unsigned> Candidates;
+  Candidates.swap(WithPredecessors);
+
   unsigned NumCases = DispatcherSwitch->getNumCases();
-  while (NumCases-- > 0)
-    DispatcherSwitch->removeCase(DispatcherSwitch->case_begin());
-
-  auto *PCRegType = PCReg->getType()->getPointerElementType();
-  auto *SwitchType = cast<IntegerType>(PCRegType);
-
-  // Add all the jump targets if we're using the SemanticPreservingCFG, or
-  // only those with no predecessors otherwise
-  for (auto &P : JumpTargets) {
-    uint64_t PC = P.first;
-    BasicBlock *BB = P.second.head();
-    if (CurrentCFGForm == CFGForm::SemanticPreservingCFG
-        || !hasPredecessors(BB))
-      DispatcherSwitch->addCase(ConstantInt::get(SwitchType, PC), BB);
+  for (unsigned I = CheckedCases; I < NumCases; I++)
+    Candidates.push_back(I);
+  CheckedCases = NumCases;
+
+  for (WeakVH &Handle : ChangedBlocks) {
+    auto *BB = cast_or_null<BasicBlock>(static_cast<Value *>(Handle));
+    if (BB == nullptr or BB->getTerminator() == nullptr)
+      continue;
+
+    for (BasicBlock *Successor : successors(BB)) {
+      auto It = DispatcherCases.find(Successor);
+      if (It != DispatcherCases.end())
+        Candidates.push_back(It->second);
+    }
+  }
+  ChangedBlocks.clear();
+
+  std::sort(Candidates.begin(), Candidates.end());
+  auto LastCandidate = std::unique(Candidates.begin(), Candidates.end());
+  Candidates.erase(LastCandidate, Candidates.end());
+
+  // Redirect the cases of the jump targets with other predecessors to the
+  // default destination, which is equivalent to removing them, but preserves
+  // the position of all the cases
+  BasicBlock *Default = DispatcherSwitch->getDefaultDest();
+  for (unsigned Index : Candidates) {
+    auto It = DispatcherSwitch->case_begin() + Index;
+    BasicBlock *BB = It->getCaseSuccessor();
+    if (hasPredecessors(BB)) {
+      WithPredecessors.push_back(Index);
+      Detached.emplace_back(Index, BB);
+      It->setSuccessor(Default);
+    }
   }
 
   //
   // Make sure every generated basic block is reachable
   //
-  if (CurrentCFGForm != CFGForm::SemanticPreservingCFG) {
-    // Compute the set of reachable jump targets
-    OnceQueue<BasicBlock *> WorkList;
-    for (BasicBlock *BB : DispatcherSwitch->successors())
-      WorkList.insert(BB);
-
-    while (not WorkList.empty()) {
-      BasicBlock *BB = WorkList.pop();
-      for (BasicBlock *Successor : make_range(succ_begin(BB), succ_end(BB)))
-        WorkList.insert(Successor);
-    }
 
-    std::set<BasicBlock *> Reachable = WorkList.visited();
+  // A block is reachable if it's a successor of the dispatcher or if one of
+  // its predecessors is reachable. Look for such a predecessor going
+  // backward, and remember the result for all the blocks for which it's
+  // known, so that each block is visited a limited number of times.
+  DenseMap<BasicBlock *, bool> Reachable;
+  auto IsReachable = [this, &Reachable](BasicBlock *Start) {
+    // Map each visited block to the successor from which we reached it
+    DenseMap<BasicBlock *, BasicBlock *> Next;
+    Next[Start] = nullptr;
+    std::vector<BasicBlock *> WorkList{ Start };
+    BasicBlock *Found = nullptr;
+
+    while (not WorkList.empty() and Found == nullptr) {
+      BasicBlock *BB = WorkList.back();
+      WorkList.pop_back();
+
+      auto KnownIt = Reachable.find(BB);
+      if (KnownIt != Reachable.end()) {
+        if (KnownIt->second)
+          Found = BB;
+        continue;
+      }
 
-    // Identify all the unreachable jump targets
-    for (auto &P : JumpTargets) {
-      uint64_t PC = P.first;
-      const JumpTarget &JT = P.second;
-      BasicBlock *BB = JT.head();
+      for (BasicBlock *Predecessor : predecessors(BB)) {
+        if (Predecessor == Dispatcher) {
+          Found = BB;
+          break;
+        }
 
-      // Add to the switch all the unreachable jump targets whose reason is not
-      // just direct jump
-      if (Reachable.count(BB) == 0
-          and not JT.isOnlyReason(JTReason::DirectJump)) {
-        DispatcherSwitch->addCase(ConstantInt::get(SwitchType, PC), BB);
+        if (Next.insert({ Predecessor, BB }).second)
+          WorkList.push_back(Predecessor);
       }
     }
+
+    if (Found != nullptr) {
+      // All the blocks on the path from Found to Start are reachable
+      for (BasicBlock *BB = Found; BB != nullptr; BB = Next[BB])
+        Reachable[BB] = true;
+      return true;
+    }
+
+    // None of the visited blocks can be reached
+    for (std::pair<BasicBlock *, BasicBlock *> &P : Next)
+      Reachable.insert({ P.first, false });
+    return false;
+  };
+
+  // Identify the unreachable jump targets among the detached ones
+  std::vector<bool> Unreachable;
+  Unreachable.reserve(Detached.size());
+  for (std::pair<unsigned, BasicBlock *> &Case : Detached)
+    Unreachable.push_back(not IsReachable(Case.second));
+
+  // Restore the cases of all the unreachable jump targets whose reason is not
+  // just direct jump
+  unsigned Kept = 0;
+  for (unsigned I = 0; I < Detached.size(); I++) {
+    auto It = DispatcherSwitch->case_begin() + Detached[I].first;
+    BasicBlock *BB = Detached[I].second;
+    const JumpTarget &JT = JumpTargets.at(It->getCaseValue()->getZExtValue());
+    if (Unreachable[I] and not JT.isOnlyReason(JTReason::DirectJump))
+      It->setSuccessor(BB);
+    else
+      Detached[Kept++] = Detached[I];
   }
+  Detached.resize(Kept);
 }
 
 bool JumpTargetManager::hasPredecessors(BasicBlock *BB) const {
@@ -1414,6 +1896,54 @@ bool JumpTargetManager::hasPredecessors(BasicBlock *BB) const {
   return false;
 }
 
+void JumpTargetManager::cleanup() {
+  if (not RegionHarvestCleanup) {
+    // TODO: root is not sharded during the lifting, these passes process the
+    //       whole program at each harvest
+    legacy::FunctionPassManager OptimizingPM(&TheModule);
+    OptimizingPM.add(createSROAPass());
+    OptimizingPM.add(createConstantPropagationPass());
+    OptimizingPM.add(createEarlyCSEPass());
+    OptimizingPM.run(*TheFunction);
+    OSRAResults.reset();
+    SETResults.reset();
+  } else {
+    // Consider the dirty blocks still alive along with their neighbors, so
+    // that values can be forwarded across the new edges
+    std::vector<BasicBlock *> Region;
+    SmallPtrSet<BasicBlock *, 32> InRegion;
+    auto Add = [&Region, &InRegion](BasicBlock *BB) {
+      if (InRegion.insert(BB).second)
+        Region.push_back(BB);
+    };
+
+    for (WeakVH &Handle : DirtyBlocks) {
+      auto *BB = cast_or_null<BasicBlock>(static_cast<Value *>(Handle));
+      if (BB == nullptr)
+        continue;
+
+      Add(BB);
+      for (BasicBlock *Predecessor : predecessors(BB))
+        Add(Predecessor);
+      for (BasicBlock *Successor : successors(BB))
+        Add(Successor);
+    }
+
+    revng_log(JTCountLog,
+              "Cleaning up " << Region.size() << " out of "
+                             << TheFunction->size() << " basic blocks");
+
+    SmallVector<BasicBlock *, 16> Affected;
+    cleanupRegion(Region, Affected);
+    for (BasicBlock *BB : Region)
+      invalidate(BB);
+    for (BasicBlock *BB : Affected)
+      invalidate(BB);
+  }
+
+  DirtyBlocks.clear();
+}
+
 // Harvesting proceeds trying to avoid to run expensive analyses if not strictly
 // necessary, OSRA in particular. To do this we keep in mind two aspects: do we
 // have new basic blocks to visit? If so, we avoid any further anyalysis and
@@ -1424,12 +1954,14 @@ bool JumpTargetManager::hasPredecessors(BasicBlock *BB) const {
 void JumpTargetManager::harvest() {
 
   if (empty()) {
-    for (uint64_t PC : SimpleLiterals)
+    std::sort(SimpleLiterals.begin(), SimpleLiterals.end());
+    auto Last = std::unique(SimpleLiterals.begin(), SimpleLiterals.end());
+    for (uint64_t PC : make_range(SimpleLiterals.begin(), Last))
       registerJT(PC, JTReason::SimpleLiteral);
     SimpleLiterals.clear();
   }
 
-  if (empty()) {
+  if (empty() and not HarvestStopped) {
     // Purge all the generated basic blocks without predecessors
     std::vector<BasicBlock *> ToDelete;
     for (BasicBlock &BB : *TheFunction) {
@@ -1439,8 +1971,10 @@ void JumpTargetManager::harvest() {
         ToDelete.push_back(&BB);
       }
     }
-    for (BasicBlock *BB : ToDelete)
+    for (BasicBlock *BB : ToDelete) {
+      invalidate(BB);
       BB->eraseFromParent();
+    }
 
     // TODO: move me to a commit function
     // Update the third argument of newpc calls (isJT, i.e., is this instruction
@@ -1466,15 +2000,16 @@ void JumpTargetManager::harvest() {
 
     revng_log(JTCountLog, "Harvesting: SROA, ConstProp, EarlyCSE and SET");
 
-    legacy::FunctionPassManager OptimizingPM(&TheModule);
-    OptimizingPM.add(createSROAPass());
-    OptimizingPM.add(createConstantPropagationPass());
-    OptimizingPM.add(createEarlyCSEPass());
-    OptimizingPM.run(*TheFunction);
+    {
+      auto Phase = Phases->scope("harvest-optimization", &TheModule);
+      cleanup();
 
-    legacy::PassManager PreliminaryBranchesPM;
-    PreliminaryBranchesPM.add(new TranslateDirectBranchesPass(this));
-    PreliminaryBranchesPM.run(TheModule);
+      legacy::PassManager PreliminaryBranchesPM;
+      PreliminaryBranchesPM.add(new TranslateDirectBranchesPass(this));
+      PreliminaryBranchesPM.run(TheModule);
+    }
+
+    auto SETPhase = Phases->scope("harvest-set", &TheModule);
 
     // TODO: eventually, `setCFGForm` should be replaced by using a CustomCFG
     // To improve the quality of our analysis, keep in the CFG only the edges we
@@ -1489,13 +2024,14 @@ void JumpTargetManager::harvest() {
 
     // Restore the CFG
     setCFGForm(CFGForm::SemanticPreservingCFG);
+    SETPhase.end();
 
     revng_log(JTCountLog,
               std::dec << Unexplored.size() << " new jump targets and "
                        << NewBranches << " new branches were found");
   }
 
-  if (not NoOSRA && empty()) {
+  if (not NoOSRA && empty() && hasOSRABudget()) {
     if (Verify.isEnabled())
       revng_assert(not verifyModule(TheModule, &dbgs()));
 
@@ -1508,38 +2044,54 @@ void JumpTargetManager::harvest() {
                   << (NewBranches > 0 ? "SROA, ConstProp, EarlyCSE, " : "")
                   << "SET + OSRA");
 
+      OSRAIterationStart = ResourceUsage::now().WallTime;
+      InOSRAIteration = true;
+
       // TODO: decide what to do with Visited
       Visited.clear();
       if (NewBranches > 0) {
-        legacy::FunctionPassManager OptimizingPM(&TheModule);
-        OptimizingPM.add(createSROAPass());
-        OptimizingPM.add(createConstantPropagationPass());
-        OptimizingPM.add(createEarlyCSEPass());
-        OptimizingPM.run(*TheFunction);
+        auto Phase = Phases->scope("harvest-optimization", &TheModule);
+        cleanup();
       }
 
-      legacy::PassManager FunctionCallPM;
-      FunctionCallPM.add(new FunctionCallIdentification());
-      FunctionCallPM.run(TheModule);
+      {
+        auto Phase = Phases->scope("harvest-function-call-identification",
+                                   &TheModule);
+        legacy::PassManager FunctionCallPM;
+        FunctionCallPM.add(new FunctionCallIdentification());
+        FunctionCallPM.run(TheModule);
+      }
 
       createJTReasonMD();
 
+      auto OSRAPhase = Phases->scope("harvest-set-osra", &TheModule);
       setCFGForm(CFGForm::RecoveredOnlyCFG);
 
       NewBranches = 0;
       legacy::PassManager AnalysisPM;
-      AnalysisPM.add(new SETPass(this, true, &Visited));
+      IncrementalOSRA *Incremental = nullptr;
+      if (IncrementalOSRAOpt)
+        Incremental = &OSRAResults;
+      auto HasBudget = [this]() { return pollOSRABudget(); };
+      AnalysisPM.add(new OSRAPass(Incremental, HasBudget));
+      SETCache *Cache = MemoizeSET ? &SETResults : nullptr;
+      AnalysisPM.add(new SETPass(this, true, &Visited, Cache));
       AnalysisPM.add(new TranslateDirectBranchesPass(this));
       AnalysisPM.run(TheModule);
 
       // Restore the CFG
       setCFGForm(CFGForm::SemanticPreservingCFG);
+      OSRAPhase.end();
 
       revng_log(JTCountLog,
                 std::dec << Unexplored.size() << " new jump targets and "
                          << NewBranches << " new branches were found");
 
-    } while (empty() && NewBranches > 0);
+      OSRAIterations++;
+      OSRATime += ResourceUsage::now().WallTime - OSRAIterationStart;
+      InOSRAIteration = false;
+
+    } while (empty() && NewBranches > 0 && hasOSRABudget());
   }
 
   if (empty()) {
@@ -1550,3 +2102,68 @@ void JumpTargetManager::harvest() {
 using BlockWithAddress = JumpTargetManager::BlockWithAddress;
 using JTM = JumpTargetManager;
 const BlockWithAddress JTM::NoMoreTargets = BlockWithAddress(0, nullptr);
+
+void JumpTargetManager::invalidate(BasicBlock *BB) {
+  if (ChangedBlocks.empty() or ChangedBlocks.back() != BB)
+    ChangedBlocks.emplace_back(BB);
+  if (IncrementalOSRAOpt)
+    OSRAResults.invalidate(BB);
+  if (MemoizeSET)
+    SETResults.invalidate(BB);
+}
+
+bool JumpTargetManager::hasOSRABudget() {
+  if (OSRABudgetExceeded)
+    return false;
+
+  // Consider the time spent in the current iteration too, if any
+  auto Time = [this]() {
+    if (not InOSRAIteration)
+      return OSRATime;
+    return OSRATime + ResourceUsage::now().WallTime - OSRAIterationStart;
+  };
+
+  const char *Exceeded = nullptr;
+  if (OSRAMaxIterations != 0 and OSRAIterations >= OSRAMaxIterations)
+    Exceeded = "Iterations";
+  else if (OSRATimeBudget != 0 and Time() >= OSRATimeBudget)
+    Exceeded = "Time";
+  else if (OSRAMemoryBudget != 0
+           and ResourceUsage::now().PeakRSS >= OSRAMemoryBudget * 1024ULL)
+    Exceeded = "Memory";
+
+  if (Exceeded == nullptr)
+    return true;
+
+  OSRABudgetExceeded = true;
+  HarvestStopped = OSRABudgetFallback == BudgetFallback::Stop;
+
+  const char *Fallback = BudgetFallback::getName(OSRABudgetFallback);
+  revng_log(JTCountLog,
+            "SET + OSRA budget exceeded (" << Exceeded << ") after "
+                                           << std::dec << OSRAIterations
+                                           << " iterations, fallback: "
+                                           << Fallback);
+
+  // Report it in the output
+  QuickMetadata QMD(Context);
+  const char *MDName = "revng.harvest.budget";
+  NamedMDNode *BudgetMD = TheModule.getOrInsertNamedMetadata(MDName);
+  BudgetMD->addOperand(QMD.tuple({ QMD.get(Exceeded),
+                                   QMD.get(Fallback),
+                                   QMD.get(OSRAIterations) }));
+
+  return false;
+}
+
+bool JumpTargetManager::pollOSRABudget() {
+  if (OSRABudgetExceeded)
+    return false;
+
+  // Measuring the resource usage has a cost, do it only once in a while
+  const unsigned PollInterval = 1024;
+  if (++OSRABudgetPolls % PollInterval != 0)
+    return true;
+
+  return hasOSRABudget();
+}
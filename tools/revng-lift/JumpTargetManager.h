@@ -6,6 +6,7 @@
 //
 
 // Standard includes
+#include <algorithm>
 #include <cstdint>
 #include <map>
 #include <set>
@@ -17,16 +18,23 @@
 #include <boost/type_traits/is_same.hpp>
 
 // LLVM includes
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/ValueHandle.h"
 
 // Local libraries includes
+#include "revng/ADT/AddressMap.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/revng.h"
 
 // Local includes
 #include "BinaryFile.h"
+#include "ExplorationWorklist.h"
 #include "NoReturnAnalysis.h"
+#include "OSRA.h"
+#include "SET.h"
 
 // Forward declarations
 namespace llvm {
@@ -204,8 +212,6 @@ public:
   };
 
 public:
-  using RangesVector = std::vector<std::pair<uint64_t, uint64_t>>;
-
   /// \param TheFunction the translated function.
   /// \param PCReg the global variable representing the program counter.
   /// \param Binary reference to the information about a given binary, such as
@@ -266,14 +272,16 @@ public:
   /// \brief Return true if no unexplored jump targets are available
   bool empty() { return Unexplored.empty(); }
 
+  /// \brief Return up to \p Count PCs that peek will likely return next, in
+  ///        order
+  std::vector<uint64_t> upcoming(unsigned Count) const {
+    return Unexplored.upcoming(Count);
+  }
+
   /// \brief Return true if the whole [\p Start,\p End) range is in an
   ///        executable segment
   bool isExecutableRange(uint64_t Start, uint64_t End) const {
-    for (std::pair<uint64_t, uint64_t> Range : ExecutableRanges)
-      if (Range.first <= Start && Start < Range.second && Range.first <= End
-          && End < Range.second)
-        return true;
-    return false;
+    return Binary.executableRanges().contains(Start, End);
   }
 
   /// \brief Return true if the given PC respects the input architecture's
@@ -288,6 +296,21 @@ public:
     return isExecutableAddress(PC) && isInstructionAligned(PC);
   }
 
+  /// \brief Return true if the \p Count addresses starting from \p Base,
+  ///        \p Stride bytes apart, are all valid PCs
+  bool isPCRange(uint64_t Base, uint64_t Stride, uint64_t Count) const {
+    if (Count == 0)
+      return true;
+
+    // Check the last address doesn't overflow
+    if (Stride != 0 and Count - 1 > (UINT64_MAX - Base) / Stride)
+      return false;
+
+    uint64_t Last = Base + Stride * (Count - 1);
+    return isInstructionAligned(Base) and isInstructionAligned(Stride)
+           and isExecutableRange(Base, Last);
+  }
+
   /// \brief Return true if the given PC is a jump target
   bool isJumpTarget(uint64_t PC) const { return JumpTargets.count(PC); }
 
@@ -305,10 +328,7 @@ public:
 
   /// \brief Return true if \p PC is in an executable segment
   bool isExecutableAddress(uint64_t PC) const {
-    for (std::pair<uint64_t, uint64_t> Range : ExecutableRanges)
-      if (Range.first <= PC && PC < Range.second)
-        return true;
-    return false;
+    return Binary.executableRanges().contains(PC);
   }
 
   /// \brief Get the basic block associated to the original address \p PC
@@ -331,13 +351,30 @@ public:
   ///         valid or another error occurred.
   llvm::BasicBlock *registerJT(uint64_t PC, JTReason::Values Reason);
 
+  /// \brief Register as jump targets the \p Count addresses starting from
+  ///        \p Base, \p Stride bytes apart
+  ///
+  /// The range is validated as a whole, instead of checking each address, and
+  /// the dispatcher cases of the new jump targets are added in a single pass
+  /// once all of them have been created, in ascending address order. If the
+  /// range is not entirely made of valid PCs, each address is handled as by
+  /// registerJT.
+  void registerJTRange(uint64_t Base,
+                       uint64_t Stride,
+                       uint64_t Count,
+                       JTReason::Values Reason);
+
   bool hasJT(uint64_t PC) { return JumpTargets.count(PC) != 0; }
 
-  std::map<uint64_t, JumpTarget>::const_iterator begin() const {
+  /// \brief Iterate over the jump targets in ascending address order
+  ///
+  /// \note The jump targets are sorted by finalizeJumpTargets.
+  AddressMap<JumpTarget>::const_iterator begin() const {
+    revng_assert(JumpTargets.isSorted());
     return JumpTargets.begin();
   }
 
-  std::map<uint64_t, JumpTarget>::const_iterator end() const {
+  AddressMap<JumpTarget>::const_iterator end() const {
     return JumpTargets.end();
   }
 
@@ -412,6 +449,15 @@ public:
                   unsigned Size,
                   BinaryFile::Endianess E = BinaryFile::OriginalEndianess);
 
+  /// \brief Record that \p Size bytes at \p Address are read as data
+  ///
+  /// This is what readConstantInt does besides the actual read, for clients
+  /// reading the binary directly.
+  void registerRead(uint64_t Address, unsigned Size) {
+    UnusedCodePointers.erase(Address);
+    registerReadRange(Address, Size);
+  }
+
   /// \brief Reads a pointer-sized value from a segment
   /// \see readConstantInt
   llvm::Constant *
@@ -420,7 +466,25 @@ public:
                       BinaryFile::Endianess E = BinaryFile::OriginalEndianess);
 
   /// \brief Increment the counter of emitted branches since the last reset
-  void newBranch() { NewBranches++; }
+  ///
+  /// \param BB the basic block whose terminator has been changed.
+  void newBranch(llvm::BasicBlock *BB) {
+    NewBranches++;
+    markDirty(BB);
+  }
+
+  /// \brief Record that \p BB has been created or changed since the last
+  ///        cleanup performed by harvest
+  void markDirty(llvm::BasicBlock *BB) {
+    if (DirtyBlocks.empty() or DirtyBlocks.back() != BB)
+      DirtyBlocks.emplace_back(BB);
+    invalidate(BB);
+  }
+
+  /// \brief Record that the instructions of \p BB changed, or that \p BB is
+  ///        about to be erased, for the analyses preserving their results
+  ///        across harvests
+  void invalidate(llvm::BasicBlock *BB);
 
   /// \brief Finalizes information about the jump targets
   ///
@@ -434,8 +498,14 @@ public:
   void finalizeJumpTargets() {
     translateIndirectJumps();
 
+    // Register them in ascending order, as they have been found
+    std::vector<uint64_t> Unused(UnusedCodePointers.begin(),
+                                 UnusedCodePointers.end());
+    std::sort(Unused.begin(), Unused.end());
+    freeContainer(UnusedCodePointers);
+
     unsigned ReadSize = Binary.architecture().pointerSize() / 8;
-    for (uint64_t MemoryAddress : UnusedCodePointers) {
+    for (uint64_t MemoryAddress : Unused) {
       // Read using the original endianess, we want the correct address
       uint64_t PC = *Binary.readRawValue(MemoryAddress, ReadSize);
 
@@ -444,8 +514,8 @@ public:
       revng_assert(!BB->empty());
     }
 
-    // We no longer need this information
-    freeContainer(UnusedCodePointers);
+    // No new jump targets from now on, sort them for begin() and end()
+    JumpTargets.sort();
   }
 
   void createJTReasonMD() {
@@ -465,7 +535,8 @@ public:
       }
     }
 
-    // Tag each jump target with its reasons
+    // Tag each jump target with its reasons, both by name and as a bitmask
+    QuickMetadata QMD(Context);
     for (auto &P : JumpTargets) {
       JumpTarget &JT = P.second;
       TerminatorInst *T = JT.head()->getTerminator();
@@ -476,6 +547,7 @@ public:
         Reasons.push_back(MDString::get(Context, ReasonName));
 
       T->setMetadata("revng.jt.reasons", MDTuple::get(Context, Reasons));
+      T->setMetadata("revng.jt.reasons.mask", QMD.tuple(JT.getReasons()));
     }
   }
 
@@ -524,15 +596,38 @@ public:
   /// Simple literals are registered as possible jump targets before attempting
   /// more expensive techniques such as SET.
   void registerSimpleLiteral(uint64_t Address) {
-    SimpleLiterals.insert(Address);
+    SimpleLiterals.push_back(Address);
   }
 
 private:
   std::set<llvm::BasicBlock *> computeUnreachable();
 
+  using CaseVector = llvm::SmallVectorImpl<std::pair<uint64_t,
+                                                     llvm::BasicBlock *>>;
+  using CaseList = llvm::ArrayRef<std::pair<uint64_t, llvm::BasicBlock *>>;
+
+  /// \brief registerJT for a \p PC known to be valid
+  ///
+  /// The dispatcher case for a newly created basic block is not added, but
+  /// appended to \p NewCases.
+  llvm::BasicBlock *registerValidJT(uint64_t PC,
+                                    JTReason::Values Reason,
+                                    CaseVector &NewCases);
+
+  /// \brief Add to the dispatcher a case for each (PC, basic block) pair in
+  ///        \p NewCases, in order
+  void addDispatcherCases(CaseList NewCases);
+
   /// \brief Translate the non-constant jumps into jumps to the dispatcher
   void translateIndirectJumps();
 
+  /// \brief Register the code pointers found by findCodePointers
+  ///
+  /// \param CodePointers pairs of valid PCs and the addresses where they have
+  ///        been found, sorted by the latter.
+  void registerCodePointers(
+    const std::vector<std::pair<uint64_t, uint64_t>> &CodePointers);
+
   /// \brief Helper function to check if an instruction is a call to `newpc`
   ///
   /// \return 0 if \p I is not a call to `newpc`, otherwise the PC address of
@@ -559,17 +654,38 @@ private:
     I->eraseFromParent();
   }
 
+  /// \brief Collect \p Start and all the descendants, stopping when a JT is
+  ///        met
+  std::set<llvm::BasicBlock *> collectTranslation(llvm::BasicBlock *Start);
+
   /// \brief Drop \p Start and all the descendants, stopping when a JT is met
   void purgeTranslation(llvm::BasicBlock *Start);
 
+  /// \brief Check if the translation starting at \p Start can become a jump
+  ///        target as is, without being purged and translated again
+  ///
+  /// \note Only the CFG and the SSA values are checked: the state libtinycode
+  ///       carries across the instructions of a translation block, e.g., the
+  ///       lazily computed flags on x86 or the IT block state on ARM, is not
+  ///       visible here. This is why reusing split translations is opt-in.
+  bool isSelfContained(llvm::BasicBlock *Start);
+
   /// \brief Check if \p BB has at least a predecessor, excluding the dispatcher
   bool hasPredecessors(llvm::BasicBlock *BB) const;
 
-  /// \brief Rebuild the dispatcher switch
+  /// \brief Restore in the dispatcher switch all the detached jump targets
+  void attachJumpTargets();
+
+  /// \brief Detach from the dispatcher switch the jump targets that have other
+  ///        predecessors
   ///
-  /// Depending on the CFG form we're currently adopting the dispatcher might go
-  /// to all the jump targets or only to those who have no other predecessor.
-  void rebuildDispatcher();
+  /// A case is detached by redirecting it to the default destination, so that
+  /// attachJumpTargets can restore it in place. Only the cases whose jump
+  /// target might have other predecessors are considered: those that had some
+  /// at the previous call, the ones added since then and the successors of the
+  /// blocks changed since then. The jump targets which would become
+  /// unreachable are kept, unless their only reason is a direct jump.
+  void detachJumpTargets();
 
   // TODO: instead of a gigantic switch case we could map the original memory
   //       area and write the address of the translated basic block at the jump
@@ -577,6 +693,10 @@ private:
   void
   createDispatcher(llvm::Function *OutputFunction, llvm::Value *SwitchOnPtr);
 
+  /// \brief Register as jump targets all the pointer-sized values in
+  ///        [\p Start, \p End) that are valid PCs
+  ///
+  /// \param StartVirtualAddress the address at which \p Start is loaded.
   template<typename value_type, unsigned endian>
   void findCodePointers(uint64_t StartVirtualAddress,
                         const unsigned char *Start,
@@ -584,11 +704,34 @@ private:
 
   void harvest();
 
+  /// \brief Check if the budget allows another SET + OSRA iteration
+  ///
+  /// The first time the budget turns out to be exceeded, this is recorded in
+  /// the `revng.harvest.budget` named metadata and the fallback is applied.
+  bool hasOSRABudget();
+
+public:
+  /// \brief Check, within a SET + OSRA iteration, if the budget still allows
+  ///        it to go on
+  ///
+  /// This is meant to be called at each step of the analyses: the budget is
+  /// actually checked only once every many calls. As hasOSRABudget, it records
+  /// and applies the fallback as soon as the budget is exceeded.
+  bool pollOSRABudget();
+
+  /// \brief The harvest has been stopped, no more jump targets are looked for
+  bool harvestStopped() const { return HarvestStopped; }
+
+private:
+  /// \brief Run SROA, constant propagation and EarlyCSE, or a lightweight
+  ///        version of them limited to the blocks changed since the last call
+  void cleanup();
+
   void handleSumJump(llvm::Instruction *SumJump);
 
 private:
-  using BlockMap = std::map<uint64_t, JumpTarget>;
-  using InstructionMap = std::map<uint64_t, llvm::Instruction *>;
+  using BlockMap = AddressMap<JumpTarget>;
+  using InstructionMap = AddressMap<llvm::Instruction *>;
 
   llvm::Module &TheModule;
   llvm::LLVMContext &Context;
@@ -599,28 +742,59 @@ private:
   /// Holds the association between a PC and a BasicBlock.
   BlockMap JumpTargets;
   /// Queue of program counters we still have to translate.
-  std::vector<BlockWithAddress> Unexplored;
+  ExplorationWorklist Unexplored;
   llvm::Value *PCReg;
   llvm::Function *ExitTB;
-  RangesVector ExecutableRanges;
   llvm::BasicBlock *Dispatcher;
   llvm::SwitchInst *DispatcherSwitch;
   llvm::BasicBlock *DispatcherFail;
   llvm::BasicBlock *AnyPC;
   llvm::BasicBlock *UnexpectedPC;
+  /// Cases of the dispatcher switch redirected to its default destination
+  /// outside SemanticPreservingCFG: the index of the case and its jump target
+  std::vector<std::pair<unsigned, llvm::BasicBlock *>> Detached;
+  /// Index of the case of each jump target in the dispatcher switch
+  llvm::DenseMap<llvm::BasicBlock *, unsigned> DispatcherCases;
+  /// Cases whose jump target had other predecessors at the last detach
+  std::vector<unsigned> WithPredecessors;
+  /// Number of cases of the dispatcher switch at the last detach
+  unsigned CheckedCases = 0;
+  /// Blocks whose successors might have changed since the last detach,
+  /// possibly repeated or deleted
+  std::vector<llvm::WeakVH> ChangedBlocks;
   std::set<llvm::BasicBlock *> Visited;
+  /// Blocks to clean up at the next harvest, possibly repeated or deleted
+  std::vector<llvm::WeakVH> DirtyBlocks;
 
   const BinaryFile &Binary;
 
   unsigned NewBranches = 0;
 
-  std::set<uint64_t> UnusedCodePointers;
+  /// Number of SET + OSRA iterations run so far
+  unsigned OSRAIterations = 0;
+  /// Wall time spent in the SET + OSRA iterations so far, in seconds
+  double OSRATime = 0.0;
+  /// Whether a SET + OSRA iteration is running, and since when
+  bool InOSRAIteration = false;
+  double OSRAIterationStart = 0.0;
+  /// Number of calls to pollOSRABudget
+  unsigned OSRABudgetPolls = 0;
+  bool OSRABudgetExceeded = false;
+  /// The OSRA budget has been exceeded and no more harvesting has to be done
+  bool HarvestStopped = false;
+  /// Results of OSRA preserved across harvests
+  IncrementalOSRA OSRAResults;
+  /// Results of SET preserved across harvests
+  SETCache SETResults;
+
+  llvm::DenseSet<uint64_t> UnusedCodePointers;
   interval_set ReadIntervalSet;
   NoReturnAnalysis NoReturn;
 
   CFGForm::Values CurrentCFGForm;
-  std::set<llvm::BasicBlock *> ToPurge;
-  std::set<uint64_t> SimpleLiterals;
+  llvm::SetVector<llvm::BasicBlock *> ToPurge;
+  /// Possibly repeated, sorted and deduplicated at the harvest
+  std::vector<uint64_t> SimpleLiterals;
 };
 
 template<>
@@ -20,6 +20,7 @@
 extern "C" {
 #include <dlfcn.h>
 #include <libgen.h>
+#include <sys/stat.h>
 #include <unistd.h>
 }
 
@@ -32,6 +33,7 @@ extern "C" {
 // Local libraries includes
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/PhaseReport.h"
 #include "revng/Support/Statistics.h"
 #include "revng/Support/revng.h"
 
@@ -73,6 +75,15 @@ opt<unsigned long long> BaseAddress("base",
 alias A2("B", DESCRIPTION, aliasopt(BaseAddress), cat(MainCategory));
 #undef DESCRIPTION
 
+#define DESCRIPTION                                                    \
+  desc("path where a JSON report of the time and memory used by each " \
+       "phase should be written")
+opt<string> PhaseReportPath("phase-report",
+                            DESCRIPTION,
+                            value_desc("path"),
+                            cat(MainCategory));
+#undef DESCRIPTION
+
 opt<string> InputPath(Positional, Required, desc("<input path>"));
 opt<string> OutputPath(Positional, Required, desc("<output path>"));
 
@@ -114,8 +125,17 @@ static void findFiles(const char *Architecture) {
 
   bool LibtinycodeFound = false;
   bool EarlyLinkedFound = false;
+  std::string PreparedHelpersPath;
   for (auto &Path : SearchPaths) {
 
+    // Prefer the helpers prepared by revng-prepare-helpers, if any
+    if (PreparedHelpersPath.empty()) {
+      std::stringstream HelpersPath;
+      HelpersPath << Path << "/libtinycode-helpers-" << Architecture << ".bc";
+      if (access(HelpersPath.str().c_str(), F_OK) != -1)
+        PreparedHelpersPath = HelpersPath.str();
+    }
+
     if (not LibtinycodeFound) {
       std::stringstream LibraryPath;
       LibraryPath << Path << "/libtinycode-" << Architecture << ".so";
@@ -141,6 +161,16 @@ static void findFiles(const char *Architecture) {
 
   revng_assert(LibtinycodeFound, "Couldn't find libtinycode and the helpers");
   revng_assert(EarlyLinkedFound, "Couldn't find early-linked.ll");
+
+  // Ignore the prepared helpers if they're older than the ones of libtinycode
+  if (not PreparedHelpersPath.empty()) {
+    struct stat Prepared;
+    struct stat Original;
+    if (stat(PreparedHelpersPath.c_str(), &Prepared) == 0
+        and stat(LibHelpersPath.c_str(), &Original) == 0
+        and Prepared.st_mtime >= Original.st_mtime)
+      LibHelpersPath = PreparedHelpersPath;
+  }
 }
 
 /// Given an architecture name, loads the appropriate version of the PTC
@@ -188,7 +218,12 @@ int main(int argc, const char *argv[]) {
   ParseCommandLineOptions(argc, argv);
   installStatistics();
 
+  if (PhaseReportPath.size() != 0)
+    Phases->enable();
+
+  auto ELFParsing = Phases->scope("elf-parsing");
   BinaryFile TheBinary(InputPath, BaseAddress);
+  ELFParsing.end();
 
   findFiles(TheBinary.architecture().name());
 
@@ -205,10 +240,20 @@ int main(int argc, const char *argv[]) {
                           RevambGlobalContext,
                           std::string(OutputPath),
                           LibHelpersPath,
-                          EarlyLinkedPath);
+                          EarlyLinkedPath,
+                          LibTinycodePath);
 
   Generator.translate(EntryPointAddress);
-  Generator.serialize();
+
+  {
+    auto Serialization = Phases->scope("serialization");
+    Generator.serialize();
+  }
+
+  if (Phases->isEnabled()) {
+    std::ofstream PhaseReportOutput(PhaseReportPath);
+    Phases->serialize(PhaseReportOutput);
+  }
 
   return EXIT_SUCCESS;
 }
@@ -14,6 +14,8 @@
 #include <boost/icl/interval_set.hpp>
 
 // LLVM includes
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Analysis/ConstantFolding.h"
@@ -23,6 +25,7 @@
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/raw_os_ostream.h"
 
@@ -54,6 +57,8 @@ const BoundedValue::MergeType AndMerge = BoundedValue::And;
 const BoundedValue::MergeType OrMerge = BoundedValue::Or;
 
 using BVVector = SmallVector<BoundedValue, 2>;
+using BlockSet = DenseSet<BasicBlock *>;
+using ValueSet = DenseSet<const Value *>;
 
 static Logger<> OsrDump("osr");
 static Logger<> PSMLog("psm");
@@ -137,13 +142,26 @@ static bool mergeBVVectors(BVVector &Base,
   return Result;
 }
 
+/// \brief Bounded values of each value in the context of each basic block
+///
+/// The entries are allocated in an arena, which is released as a whole, and
+/// never move: the OSRs can point to their summaries. The entries concerning
+/// a basic block are linked together, in order of creation.
 class BVMap {
 private:
   using MapIndex = std::pair<BasicBlock *, const Value *>;
   using BVWithOrigin = std::pair<BasicBlock *, BoundedValue>;
   struct MapValue {
+    MapValue() : Key(nullptr), Next(nullptr) {}
+
     BoundedValue Summary;
-    std::vector<BVWithOrigin> Components;
+    /// One for each predecessor providing a constraint, usually a few
+    SmallVector<BVWithOrigin, 2> Components;
+
+    /// The value this entry concerns
+    const Value *Key;
+    /// The next entry concerning the same basic block
+    MapValue *Next;
 
     void dump() const debug_function { dump(dbg); }
 
@@ -162,6 +180,14 @@ private:
     }
   };
 
+  /// \brief First and last entry concerning a basic block
+  struct BlockEntries {
+    BlockEntries() : First(nullptr), Last(nullptr) {}
+
+    MapValue *First;
+    MapValue *Last;
+  };
+
 public:
   BVMap() :
     BlockBlackList(nullptr),
@@ -185,21 +211,19 @@ public:
     auto Index = std::make_pair(BB, V);
     auto MapIt = TheMap.find(Index);
     if (MapIt == TheMap.end()) {
-      MapValue NewBVOVector;
-      NewBVOVector.Summary = BoundedValue(V);
-      auto It = TheMap.insert(std::make_pair(Index, NewBVOVector)).first;
-      return summarize(BB, &It->second);
+      MapValue *NewBVOVector = create(Index);
+      NewBVOVector->Summary = BoundedValue(V);
+      return summarize(BB, NewBVOVector);
     }
 
-    MapValue &BVOs = MapIt->second;
-    return BVOs.Summary;
+    return MapIt->second->Summary;
   }
 
   BoundedValue *
   getEdge(BasicBlock *BB, BasicBlock *Predecessor, const Value *V) {
     auto MapIt = TheMap.find({ BB, V });
     if (MapIt != TheMap.end())
-      for (auto &Component : MapIt->second.Components)
+      for (auto &Component : MapIt->second->Components)
         if (Component.first == Predecessor)
           return &Component.second;
 
@@ -211,12 +235,12 @@ public:
     auto MapIt = TheMap.find(Index);
     revng_assert(MapIt != TheMap.end());
 
-    MapValue &BVOVector = MapIt->second;
+    MapValue &BVOVector = *MapIt->second;
     BVOVector.Summary.setSignedness(IsSigned);
     for (BVWithOrigin &BVO : BVOVector.Components)
       BVO.second.setSignedness(IsSigned);
 
-    summarize(BB, &MapIt->second);
+    summarize(BB, &BVOVector);
   }
 
   /// Associate to basic block \p Target a new constraint \p NewBV coming from
@@ -227,59 +251,191 @@ public:
   std::pair<bool, BoundedValue &>
   update(BasicBlock *Target, BasicBlock *Origin, BoundedValue NewBV);
 
-  void prepareDescribe() const {
-    BBMap.clear();
-    for (auto Pair : TheMap) {
-      auto *BB = Pair.first.first;
-      if (BBMap.find(BB) == BBMap.end())
-        BBMap[BB] = std::vector<MapValue>{ Pair.second };
-      else
-        BBMap[BB].push_back(Pair.second);
-    }
-  }
-
   BoundedValue &forceBV(Instruction *V, BoundedValue BV) {
-    MapIndex I{ V->getParent(), V };
-    MapValue NewValue;
-    NewValue.Summary = BV;
-    TheMap[I] = NewValue;
-    return TheMap[I].Summary;
+    return forceBV(V->getParent(), V, BV);
   }
 
   BoundedValue &forceBV(BasicBlock *BB, Value *V, BoundedValue BV) {
-    MapIndex I{ BB, V };
-    MapValue NewValue;
-    NewValue.Summary = BV;
-    TheMap[I] = NewValue;
-    return TheMap[I].Summary;
+    // Reuse the existing entry, if any, since OSRs might point to it
+    MapIndex Index{ BB, V };
+    auto MapIt = TheMap.find(Index);
+    MapValue *Entry = MapIt != TheMap.end() ? MapIt->second : create(Index);
+    Entry->Summary = BV;
+    Entry->Components.clear();
+    return Entry->Summary;
   }
 
   void clear() {
     freeContainer(TheMap);
-    freeContainer(BBMap);
+    freeContainer(Blocks);
+    freeContainer(Recycled);
+    Allocator.DestroyAll();
+  }
+
+  /// \brief Drop the information in the context of the basic blocks in
+  ///        \p ToErase, or concerning the values in \p Values
+  ///
+  /// \param Dropped set where the addresses of the dropped summaries are
+  ///        collected.
+  void erase(const BlockSet &ToErase,
+             const ValueSet &Values,
+             DenseSet<const BoundedValue *> &Dropped) {
+    std::vector<BasicBlock *> Emptied;
+    for (auto &P : Blocks) {
+      auto *BB = const_cast<BasicBlock *>(P.first);
+      bool WholeBlock = ToErase.count(BB) != 0;
+
+      // Rebuild the list of the entries of this basic block, recycling the
+      // dropped ones
+      MapValue *Entry = P.second.First;
+      P.second = BlockEntries();
+      while (Entry != nullptr) {
+        MapValue *Next = Entry->Next;
+        Entry->Next = nullptr;
+
+        if (WholeBlock or Values.count(Entry->Key) != 0) {
+          Dropped.insert(&Entry->Summary);
+          TheMap.erase({ BB, Entry->Key });
+          Recycled.push_back(Entry);
+        } else {
+          append(P.second, Entry);
+        }
+
+        Entry = Next;
+      }
+
+      if (P.second.First == nullptr)
+        Emptied.push_back(BB);
+    }
+
+    for (BasicBlock *BB : Emptied)
+      Blocks.erase(BB);
+  }
+
+  /// \brief Collect the constraints propagated to \p BB by its predecessors
+  BVVector propagated(BasicBlock *BB) const {
+    BVVector Result;
+    auto It = Blocks.find(BB);
+    if (It == Blocks.end())
+      return Result;
+
+    for (MapValue *Entry = It->second.First; Entry != nullptr;
+         Entry = Entry->Next)
+      if (Entry->Components.size() != 0)
+        Result.push_back(Entry->Summary);
+    return Result;
   }
 
 private:
   BoundedValue &
   summarize(BasicBlock *Target, MapValue *BVOVectorLoopInfoWrapperPass);
 
-  bool isForced(std::map<MapIndex, MapValue>::iterator &It) const {
-    const MapIndex &Index = It->first;
-
+  bool isForced(const MapIndex &Index, const MapValue &Entry) const {
     if (auto *I = dyn_cast<Instruction>(Index.second)) {
-      return I->getParent() == Index.first && It->second.Components.size() == 0;
+      return I->getParent() == Index.first && Entry.Components.size() == 0;
     } else {
       return false;
     }
   }
 
+  /// \brief Create a new, empty, entry for \p Index
+  MapValue *create(const MapIndex &Index) {
+    MapValue *Result = nullptr;
+    if (Recycled.empty()) {
+      Result = new (Allocator.Allocate()) MapValue();
+    } else {
+      Result = Recycled.back();
+      Recycled.pop_back();
+      *Result = MapValue();
+    }
+
+    Result->Key = Index.second;
+    bool New = TheMap.insert({ Index, Result }).second;
+    revng_assert(New);
+    append(Blocks[Index.first], Result);
+    return Result;
+  }
+
+  static void append(BlockEntries &List, MapValue *Entry) {
+    if (List.Last == nullptr)
+      List.First = Entry;
+    else
+      List.Last->Next = Entry;
+    List.Last = Entry;
+  }
+
 private:
   std::set<BasicBlock *> *BlockBlackList;
   const DataLayout *DL;
   Type *Int64;
-  std::map<MapIndex, MapValue> TheMap;
-  mutable std::map<const BasicBlock *, std::vector<MapValue>> BBMap;
   const CustomCFG *FilteredCFG;
+
+  /// Storage of the entries, they're destroyed all together
+  SpecificBumpPtrAllocator<MapValue> Allocator;
+  DenseMap<MapIndex, MapValue *> TheMap;
+  DenseMap<const BasicBlock *, BlockEntries> Blocks;
+  /// Dropped entries, available to be reused
+  std::vector<MapValue *> Recycled;
+};
+
+using InstructionOSRVector = std::vector<std::pair<Instruction *, OSR>>;
+using SubscribersType = SmallSet<Instruction *, 3>;
+
+/// \brief State of the OSRA DFA, possibly preserved across runs
+class OSRAState {
+public:
+  OSRAState() : Analyzed(false) {}
+
+  void clear();
+
+  /// \brief Extend \p Changed, initially holding the reported basic blocks,
+  ///        with the basic blocks affected by their changes
+  ///
+  /// These are the former successors of the changed basic blocks, which might
+  /// have lost a predecessor. The basic blocks no longer in the filtered CFG
+  /// are handled as changed ones. Only the basic blocks reachable from
+  /// \p Changed are inspected.
+  void collectChanged(const CustomCFG &FilteredCFG, BlockSet &Changed) const;
+
+  /// \brief Drop all the results concerning the basic blocks in \p Invalid
+  ///
+  /// \param Seeds where the instructions depending on the dropped results,
+  ///        but not belonging to \p Invalid, are collected.
+  ///
+  /// \return false if some of the remaining results refer to the dropped ones,
+  ///         in which case the state has to be cleared.
+  bool drop(const BlockSet &Invalid, std::vector<Instruction *> &Seeds);
+
+  /// \brief Record the information required by collectChanged and drop
+  ///
+  /// \param Analyzed the basic blocks analyzed by the last run, nullptr if it
+  ///        started from scratch. Only these basic blocks are recorded again.
+  void snapshot(Function &F,
+                const CustomCFG &FilteredCFG,
+                const BlockSet *Analyzed);
+
+public:
+  /// Has a run been completed on this state?
+  bool Analyzed;
+
+  // Final information (i.e., used by OSRAPass)
+  OSRAPass::OSRMap OSRs;
+  BVMap BVs;
+
+  // Temporary information, preserved for the incremental runs
+  std::map<const Instruction *, BVVector> Constraints;
+  std::map<const LoadInst *, InstructionOSRVector> LoadReachers;
+
+  /// Keeps track of those instruction that need to be updated when the reachers
+  /// of a certain Load are updated
+  std::map<const LoadInst *, SubscribersType> Subscriptions;
+
+private:
+  /// Instructions of each basic block at the last snapshot
+  DenseMap<BasicBlock *, std::vector<const Instruction *>> Contents;
+
+  /// Successors in the filtered CFG of each basic block at the last snapshot
+  DenseMap<BasicBlock *, SmallVector<BasicBlock *, 2>> Successors;
 };
 
 using CFGNode = CustomCFGNode;
@@ -301,20 +457,33 @@ public:
        SimplifyComparisonsPass &SCP,
        ConditionalReachedLoadsPass &RDP,
        FunctionCallIdentification &FCI,
-       std::map<const Value *, const OSR> &OSRs,
-       BVMap &BVs) :
+       OSRAState &State) :
     F(F),
     DL(F.getParent()->getDataLayout()),
     SCP(SCP),
     RDP(RDP),
     FCI(FCI),
     Int64(IntegerType::get(getContext(&F), 64)),
-    OSRs(OSRs),
-    BVs(BVs),
+    OSRs(State.OSRs),
+    BVs(State.BVs),
+    Constraints(State.Constraints),
+    LoadReachers(State.LoadReachers),
+    Subscriptions(State.Subscriptions),
     PDT(),
     FilteredCFG(FCI.cfg()) {}
 
-  void run();
+  /// \brief Run the DFA
+  ///
+  /// \param Invalid if not nullptr, the results of the previous run are
+  ///        preserved, except for those concerning these basic blocks.
+  /// \param Seeds instructions to analyze in addition to those in \p Invalid.
+  /// \param HasBudget if set, polled at each step of the DFA.
+  ///
+  /// \return false if the DFA has been interrupted since \p HasBudget returned
+  ///         false, in which case the results are not sound.
+  bool run(const BlockSet *Invalid,
+           ArrayRef<Instruction *> Seeds,
+           const OSRAPass::BudgetFunc &HasBudget);
   void dump();
 
   bool inBlackList(BasicBlock *BB) { return BlockBlackList.count(BB) > 0; }
@@ -330,6 +499,32 @@ public:
   void handleBranch(Instruction *I);
   void handleMemoryOperation(Instruction *I);
 
+  // Helper functions employed by handleBranch
+
+  /// \brief Constraints to propagate from \p Origin to \p Target
+  struct WLEntry {
+    WLEntry(BasicBlock *Target, BasicBlock *Origin, BVVector Constraints) :
+      Target(Target),
+      Origin(Origin),
+      Constraints(Constraints) {}
+
+    BasicBlock *Target;
+    BasicBlock *Origin;
+    BVVector Constraints;
+  };
+
+  /// \brief Compute the basic blocks affected by \p BranchConstraints, and
+  ///        not post-dominated by another affected basic block
+  SmallVector<const BasicBlock *, 3>
+  affectedBlocks(const BVVector &BranchConstraints);
+
+  /// \brief Propagate the constraints in \p ConstraintsWL along the filtered
+  ///        CFG, until all the \p RecursivelyAffected basic blocks are
+  ///        post-dominated
+  void
+  propagateBranchConstraints(std::vector<WLEntry> &ConstraintsWL,
+                             ArrayRef<const BasicBlock *> RecursivelyAffected);
+
   // Helper functions employed by handleComparison
 
   /// \brief Given an OSR, an predicate and a constant, produce a new
@@ -495,18 +690,13 @@ private:
   //
 
   // Final information (i.e., used by OSRAPass)
-  std::map<const Value *, const OSR> &OSRs;
+  OSRAPass::OSRMap &OSRs;
   BVMap &BVs;
 
   // Temporary
-  std::map<const Instruction *, BVVector> Constraints;
-  using InstructionOSRVector = std::vector<std::pair<Instruction *, OSR>>;
-  std::map<const LoadInst *, InstructionOSRVector> LoadReachers;
-
-  /// Keeps track of those instruction that need to be updated when the reachers
-  /// of a certain Load are updated
-  using SubscribersType = SmallSet<Instruction *, 3>;
-  std::map<const LoadInst *, SubscribersType> Subscriptions;
+  std::map<const Instruction *, BVVector> &Constraints;
+  std::map<const LoadInst *, InstructionOSRVector> &LoadReachers;
+  std::map<const LoadInst *, SubscribersType> &Subscriptions;
 
   DominatorTreeBase<BasicBlock, /* IsPostDom = */ true> PDT;
   const CustomCFG &FilteredCFG;
@@ -562,7 +752,7 @@ void OSRA::handleArithmeticOperator(Instruction *I) {
       auto ConstantBV = BoundedValue::createConstant(ConstantOp, Constant);
       auto &BV = BVs.forceBV(I, ConstantBV);
       OSR ConstantOSR(&BV);
-      OSRs.emplace(make_pair(I, ConstantOSR));
+      OSRs.insert({ I, ConstantOSR });
       enqueueUsers(I);
     }
 
@@ -620,7 +810,7 @@ void OSRA::handleArithmeticOperator(Instruction *I) {
     // Update the OSR and enqueue all I's uses
     if (!IsFree)
       OSRs.erase(I);
-    OSRs.emplace(make_pair(I, NewOSR));
+    OSRs.insert({ I, NewOSR });
     enqueueUsers(I);
   }
 }
@@ -1097,7 +1287,7 @@ void OSRA::handleUnaryOperator(Instruction *I) {
   if (NewOSR.isRelativeTo(I))
     return;
 
-  OSRs.emplace(make_pair(I, NewOSR));
+  OSRs.insert({ I, NewOSR });
   enqueueUsers(I);
 
   propagateConstraints(I, Operand, [](BVVector &BV) { return BV; });
@@ -1126,6 +1316,37 @@ void OSRA::handleBranch(Instruction *I) {
   for (auto &BranchConstraint : FlippedBranchConstraints)
     BranchConstraint.flip();
 
+  auto RecursivelyAffected = affectedBlocks(BranchConstraints);
+
+  // Create and initialize the worklist with the positive constraints for the
+  // true branch, and the negated constraints for the false branch
+  std::vector<WLEntry> ConstraintsWL;
+  BasicBlock *Source = Branch->getParent();
+  if (FilteredCFG.hasNode(Source)) {
+    const CFGNode *Node = FilteredCFG.getNode(Source);
+    SmallVector<const CFGNode *, 2> Successors;
+    std::copy(Node->succ_begin(),
+              Node->succ_end(),
+              std::back_inserter(Successors));
+    revng_assert(Successors.size() <= 2);
+
+    if (Successors.size() >= 1) {
+      BasicBlock *Successor = Successors[0]->block();
+      ConstraintsWL.push_back(WLEntry(Successor, Source, BranchConstraints));
+    }
+
+    if (Successors.size() >= 2) {
+      BasicBlock *Successor = Successors[1]->block();
+      auto FBC = FlippedBranchConstraints;
+      ConstraintsWL.push_back(WLEntry(Successor, Source, FBC));
+    }
+  }
+
+  propagateBranchConstraints(ConstraintsWL, RecursivelyAffected);
+}
+
+SmallVector<const BasicBlock *, 3>
+OSRA::affectedBlocks(const BVVector &BranchConstraints) {
   // Compute the set of interested basic blocks
   std::set<const BasicBlock *> AffectedSet;
 
@@ -1204,41 +1425,12 @@ void OSRA::handleBranch(Instruction *I) {
 
   freeContainer(AffectedSet);
 
-  // Create and initialize the worklist with the positive constraints for the
-  // true branch, and the negated constraints for the false branch
-  struct WLEntry {
-    WLEntry(BasicBlock *Target, BasicBlock *Origin, BVVector Constraints) :
-      Target(Target),
-      Origin(Origin),
-      Constraints(Constraints) {}
-
-    BasicBlock *Target;
-    BasicBlock *Origin;
-    BVVector Constraints;
-  };
-
-  std::vector<WLEntry> ConstraintsWL;
-  BasicBlock *Source = Branch->getParent();
-  if (FilteredCFG.hasNode(Source)) {
-    const CFGNode *Node = FilteredCFG.getNode(Source);
-    SmallVector<const CFGNode *, 2> Successors;
-    std::copy(Node->succ_begin(),
-              Node->succ_end(),
-              std::back_inserter(Successors));
-    revng_assert(Successors.size() <= 2);
-
-    if (Successors.size() >= 1) {
-      BasicBlock *Successor = Successors[0]->block();
-      ConstraintsWL.push_back(WLEntry(Successor, Source, BranchConstraints));
-    }
-
-    if (Successors.size() >= 2) {
-      BasicBlock *Successor = Successors[1]->block();
-      auto FBC = FlippedBranchConstraints;
-      ConstraintsWL.push_back(WLEntry(Successor, Source, FBC));
-    }
-  }
+  return RecursivelyAffected;
+}
 
+void OSRA::propagateBranchConstraints(
+  std::vector<WLEntry> &ConstraintsWL,
+  ArrayRef<const BasicBlock *> RecursivelyAffected) {
   // TODO: can we do this in a DFA way?
   // Process the worklist
   while (!ConstraintsWL.empty()) {
@@ -1457,10 +1649,184 @@ OSRAPass::~OSRAPass() {
 
 void OSRAPass::releaseMemory() {
   revng_log(ReleaseLog, "OSRAPass is releasing memory");
+
+  // The incremental state is released by its owner
+  if (Incremental == nullptr)
+    delete State;
+
+  State = nullptr;
+  OSRs = nullptr;
+}
+
+IncrementalOSRA::IncrementalOSRA() : State(new OSRAState()) {
+}
+
+IncrementalOSRA::~IncrementalOSRA() {
+  delete State;
+}
+
+void IncrementalOSRA::reset() {
+  State->clear();
+  freeContainer(Invalidated);
+}
+
+void OSRAState::clear() {
+  Analyzed = false;
   freeContainer(OSRs);
-  if (BVs) {
-    delete BVs;
-    BVs = nullptr;
+  BVs.clear();
+  freeContainer(Constraints);
+  freeContainer(LoadReachers);
+  freeContainer(Subscriptions);
+  freeContainer(Contents);
+  freeContainer(Successors);
+}
+
+void OSRAState::collectChanged(const CustomCFG &FilteredCFG,
+                               BlockSet &Changed) const {
+  // Note: the changed basic blocks might have been erased, we can only compare
+  //       their addresses
+  std::vector<BasicBlock *> WorkList(Changed.begin(), Changed.end());
+  while (not WorkList.empty()) {
+    BasicBlock *BB = WorkList.back();
+    WorkList.pop_back();
+
+    auto It = Successors.find(BB);
+    if (It == Successors.end())
+      continue;
+
+    // The successors that left the filtered CFG affect their own successors
+    for (BasicBlock *Successor : It->second)
+      if (Changed.insert(Successor).second
+          and not FilteredCFG.hasNode(Successor))
+        WorkList.push_back(Successor);
+  }
+}
+
+bool OSRAState::drop(const BlockSet &Invalid,
+                     std::vector<Instruction *> &Seeds) {
+  // Note: the invalid basic blocks and their instructions might have been
+  //       erased, we can only compare their addresses
+
+  ValueSet Dropped;
+  for (BasicBlock *BB : Invalid) {
+    auto It = Contents.find(BB);
+    if (It != Contents.end())
+      Dropped.insert(It->second.begin(), It->second.end());
+  }
+
+  DenseSet<const BoundedValue *> DroppedBVs;
+  BVs.erase(Invalid, Dropped, DroppedBVs);
+
+  auto IsDropped = [&Dropped](const Value *V) {
+    return Dropped.count(V) != 0;
+  };
+  auto IsDroppedBV = [&DroppedBVs](const OSR &TheOSR) {
+    return DroppedBVs.count(TheOSR.boundedValue()) != 0;
+  };
+
+  std::vector<const Value *> DroppedOSRs;
+  for (auto &P : OSRs) {
+    if (IsDropped(P.first))
+      DroppedOSRs.push_back(P.first);
+    else if (IsDroppedBV(P.second))
+      return false;
+  }
+  for (const Value *V : DroppedOSRs)
+    OSRs.erase(V);
+
+  for (auto It = Constraints.begin(); It != Constraints.end();) {
+    if (IsDropped(It->first)) {
+      It = Constraints.erase(It);
+    } else {
+      for (const BoundedValue &Constraint : It->second)
+        if (IsDropped(Constraint.value()))
+          return false;
+      ++It;
+    }
+  }
+
+  for (auto It = LoadReachers.begin(); It != LoadReachers.end();) {
+    if (IsDropped(It->first)) {
+      It = LoadReachers.erase(It);
+    } else {
+      for (auto &P : It->second)
+        if (IsDropped(P.first) or IsDroppedBV(P.second))
+          return false;
+      ++It;
+    }
+  }
+
+  for (auto It = Subscriptions.begin(); It != Subscriptions.end();) {
+    if (IsDropped(It->first)) {
+      // The preserved subscribers have to be notified again
+      for (Instruction *Subscriber : It->second)
+        if (not IsDropped(Subscriber))
+          Seeds.push_back(Subscriber);
+      It = Subscriptions.erase(It);
+    } else {
+      SmallVector<Instruction *, 3> ToErase;
+      for (Instruction *Subscriber : It->second)
+        if (IsDropped(Subscriber))
+          ToErase.push_back(Subscriber);
+      for (Instruction *Subscriber : ToErase)
+        It->second.erase(Subscriber);
+      ++It;
+    }
+  }
+
+  return true;
+}
+
+void OSRAState::snapshot(Function &F,
+                         const CustomCFG &FilteredCFG,
+                         const BlockSet *Analyzed) {
+  auto Record = [this, &FilteredCFG](BasicBlock *BB) {
+    auto &BlockContents = Contents[BB];
+    for (const Instruction &I : *BB)
+      BlockContents.push_back(&I);
+
+    if (not FilteredCFG.hasNode(BB))
+      return;
+
+    auto &BlockSuccessors = Successors[BB];
+    for (const CFGNode *Successor : FilteredCFG.getNode(BB)->successors())
+      BlockSuccessors.push_back(Successor->block());
+  };
+
+  if (Analyzed == nullptr) {
+    Contents.clear();
+    Successors.clear();
+    for (BasicBlock &BB : F)
+      Record(&BB);
+    return;
+  }
+
+  // The analyzed basic blocks not in the filtered CFG have been erased or are
+  // no longer considered, forget them
+  for (BasicBlock *BB : *Analyzed) {
+    Contents.erase(BB);
+    Successors.erase(BB);
+    if (FilteredCFG.hasNode(BB))
+      Record(BB);
+  }
+}
+
+/// \brief Extend \p Blocks with all the basic blocks reachable from them in
+///        \p FilteredCFG
+static void addReachable(const CustomCFG &FilteredCFG, BlockSet &Blocks) {
+  std::vector<BasicBlock *> WorkList(Blocks.begin(), Blocks.end());
+  while (not WorkList.empty()) {
+    BasicBlock *BB = WorkList.back();
+    WorkList.pop_back();
+
+    // Skip the basic blocks no longer in the filtered CFG, without
+    // dereferencing them
+    if (not FilteredCFG.hasNode(BB))
+      continue;
+
+    for (const CFGNode *Successor : FilteredCFG.getNode(BB)->successors())
+      if (Blocks.insert(Successor->block()).second)
+        WorkList.push_back(Successor->block());
   }
 }
 
@@ -1642,19 +2008,71 @@ private:
   OSRA &JTFC;
 };
 
-void OSRA::run() {
+bool OSRA::run(const BlockSet *Invalid,
+               ArrayRef<Instruction *> Seeds,
+               const OSRAPass::BudgetFunc &HasBudget) {
+  auto ToAnalyze = [Invalid](BasicBlock *BB) {
+    return Invalid == nullptr or Invalid->count(BB) != 0;
+  };
+
   // Populate the WorkList
-  for (BasicBlock &BB : F)
-    if (FilteredCFG.hasNode(&BB))
-      for (auto &I : make_range(BB.begin(), BB.end()))
-        WorkList.insert(&I);
+  for (BasicBlock &BB : F) {
+    if (not FilteredCFG.hasNode(&BB) or not ToAnalyze(&BB))
+      continue;
+
+    for (auto &I : make_range(BB.begin(), BB.end())) {
+      WorkList.insert(&I);
+
+      // The loads need their reaching definitions to be analyzed again
+      if (auto *Load = dyn_cast<LoadInst>(&I))
+        if (Invalid != nullptr)
+          for (Instruction *Definition : RDP.getReachingDefinitions(Load))
+            if (FilteredCFG.hasNode(Definition->getParent())
+                and not ToAnalyze(Definition->getParent()))
+              WorkList.insert(Definition);
+    }
+  }
+
+  for (Instruction *Seed : Seeds)
+    WorkList.insert(Seed);
 
   // TODO: drop BlockBlackList
   BVs.initialize(&BlockBlackList, &DL, Int64, &FilteredCFG);
   // TODO: compute on FilteredCFG?
+  // TODO: this spans the whole root function, regions are only split out of
+  //       it by ShardRoot after the lifting
   PDT.recalculate(F);
 
+  // Propagate again the constraints holding at the end of the preserved
+  // predecessors of the basic blocks to analyze
+  if (Invalid != nullptr) {
+    for (BasicBlock &BB : F) {
+      if (not FilteredCFG.hasNode(&BB) or not ToAnalyze(&BB))
+        continue;
+
+      for (BasicBlock *Predecessor : filtered_predecessors(&BB)) {
+        if (ToAnalyze(Predecessor))
+          continue;
+
+        // The constraints due to the branch of the predecessor
+        WorkList.insert(Predecessor->getTerminator());
+
+        // The constraints the predecessor received from its own predecessors
+        BVVector Propagated = BVs.propagated(Predecessor);
+        if (Propagated.size() == 0)
+          continue;
+
+        std::vector<WLEntry> ConstraintsWL;
+        ConstraintsWL.push_back(WLEntry(&BB, Predecessor, Propagated));
+        propagateBranchConstraints(ConstraintsWL, affectedBlocks(Propagated));
+      }
+    }
+  }
+
   while (not WorkList.empty()) {
+    if (HasBudget and not HasBudget())
+      return false;
+
     Instruction *I = WorkList.pop();
 
     unsigned Opcode = I->getOpcode();
@@ -1701,10 +2119,11 @@ void OSRA::run() {
   // TODO: this dumps on dbg directly to avoid serializing in a string
   if (OsrDump.isEnabled())
     dump();
+
+  return true;
 }
 
 void OSRA::dump() {
-  BVs.prepareDescribe();
   raw_os_ostream OutputStream(dbg);
   F.getParent()->print(OutputStream, new OSRAnnotationWriter(*this));
 }
@@ -1845,7 +2264,7 @@ OSR OSRA::createOSR(Value *V, BasicBlock *BB) const {
 /// only the first operand is constant.
 // TODO: this only works with commutative instructions
 std::pair<Constant *, Value *>
-OSRAPass::identifyOperands(std::map<const Value *, const OSR> &OSRs,
+OSRAPass::identifyOperands(OSRMap &OSRs,
                            const Instruction *I,
                            const DataLayout &DL) {
   revng_assert(I->getNumOperands() == 2);
@@ -2329,37 +2748,80 @@ bool OSRAPass::runOnModule(Module &M) {
   revng_log(PassesLog, "Starting OSRAPass");
 
   Function &F = *M.getFunction("root");
-  releaseMemory();
-  BVs = new BVMap();
+  auto &RDP = getAnalysis<ConditionalReachedLoadsPass>();
+  auto &FCI = getAnalysis<FunctionCallIdentification>();
+
+  BlockSet Invalid;
+  std::vector<Instruction *> Seeds;
+  bool FromScratch = true;
+  if (Incremental == nullptr) {
+    releaseMemory();
+    State = new OSRAState();
+  } else {
+    State = Incremental->State;
+    if (State->Analyzed) {
+      // Compute the basic blocks whose results are no longer valid, i.e., the
+      // changed ones and everything they can reach
+      Invalid.insert(Incremental->Invalidated.begin(),
+                     Incremental->Invalidated.end());
+      State->collectChanged(FCI.cfg(), Invalid);
+      addReachable(FCI.cfg(), Invalid);
+
+      FromScratch = not State->drop(Invalid, Seeds);
+      if (FromScratch) {
+        revng_log(PassesLog, "OSRAPass cannot preserve the previous results");
+        State->clear();
+        Seeds.clear();
+      } else {
+        revng_log(PassesLog,
+                  "OSRAPass is analyzing " << Invalid.size()
+                                           << " invalidated basic blocks");
+      }
+    }
 
-  OSRA TheOSRA(F,
-               getAnalysis<SimplifyComparisonsPass>(),
-               getAnalysis<ConditionalReachedLoadsPass>(),
-               getAnalysis<FunctionCallIdentification>(),
-               OSRs,
-               *BVs);
-  TheOSRA.run();
+    freeContainer(Incremental->Invalidated);
+  }
+
+  OSRs = &State->OSRs;
+
+  OSRA TheOSRA(F, getAnalysis<SimplifyComparisonsPass>(), RDP, FCI, *State);
+  if (not TheOSRA.run(FromScratch ? nullptr : &Invalid, Seeds, HasBudget)) {
+    revng_log(PassesLog, "OSRAPass exceeded its budget, dropping the results");
+    State->clear();
+    return false;
+  }
+
+  // The temporary information is needed only to run again incrementally
+  if (Incremental != nullptr) {
+    State->snapshot(F, FCI.cfg(), FromScratch ? nullptr : &Invalid);
+  } else {
+    freeContainer(State->Constraints);
+    freeContainer(State->LoadReachers);
+    freeContainer(State->Subscriptions);
+  }
+  State->Analyzed = true;
 
   revng_log(PassesLog, "Ending OSRAPass");
   return false;
 }
 
 void BVMap::describe(formatted_raw_ostream &O, const BasicBlock *BB) const {
-  if (BBMap.find(BB) != BBMap.end())
-    for (MapValue &MV : BBMap[BB]) {
+  auto It = Blocks.find(BB);
+  if (It != Blocks.end())
+    for (MapValue *MV = It->second.First; MV != nullptr; MV = MV->Next) {
       O << "  ; ";
 
       {
-        auto &BVO = MV.Summary;
+        auto &BVO = MV->Summary;
         O << "<";
         BVO.dump(O);
         O << ">";
       }
 
-      if (MV.Components.size() > 0)
+      if (MV->Components.size() > 0)
         O << " = ";
 
-      for (auto &BVO : MV.Components) {
+      for (auto &BVO : MV->Components) {
         O << "<";
         O << getName(BVO.first);
         O << ", ";
@@ -2382,7 +2844,7 @@ BVMap::update(BasicBlock *Target, BasicBlock *Origin, BoundedValue NewBV) {
         << " with " << NewBV.describe() << ": ";
   }
 
-  auto Index = make_pair(Target, NewBV.value());
+  MapIndex Index = make_pair(Target, NewBV.value());
   auto MapIt = TheMap.find(Index);
   MapValue *BVOVector = nullptr;
 
@@ -2391,17 +2853,16 @@ BVMap::update(BasicBlock *Target, BasicBlock *Origin, BoundedValue NewBV) {
     Log << "new";
 
     // No, just insert it
-    MapValue NewBVOVector;
-    NewBVOVector.Components.push_back({ make_pair(Origin, NewBV) });
-    BVOVector = &TheMap.insert({ Index, NewBVOVector }).first->second;
+    BVOVector = create(Index);
+    BVOVector->Components.push_back({ make_pair(Origin, NewBV) });
     return { true, summarize(Target, BVOVector) };
-  } else if (isForced(MapIt)) {
+  } else if (isForced(Index, *MapIt->second)) {
     Log << "forced";
 
-    return { false, MapIt->second.Summary };
+    return { false, MapIt->second->Summary };
   } else {
     bool Changed = true;
-    BVOVector = &MapIt->second;
+    BVOVector = MapIt->second;
 
     // Look for an entry with the given origin
     BoundedValue *Base = nullptr;
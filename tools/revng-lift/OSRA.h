@@ -7,9 +7,11 @@
 
 // Standard includes
 #include <cstdint>
-#include <map>
+#include <functional>
 
 // LLVM includes
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/Pass.h"
 
 // Local libraries includes
@@ -36,13 +38,64 @@ class Value;
 
 class BVMap;
 class BoundedValueHelpers;
+class OSRAState;
+
+/// \brief Results of OSRAPass preserved across its runs
+///
+/// Between two runs, the owner has to report through invalidate each basic
+/// block whose instructions have been changed, including its terminator, or
+/// that is about to be erased. The results of the basic blocks reachable from
+/// the reported ones, and of the former successors of the reported ones, are
+/// considered invalid too.
+class IncrementalOSRA {
+public:
+  IncrementalOSRA();
+  ~IncrementalOSRA();
+
+  void invalidate(llvm::BasicBlock *BB) { Invalidated.insert(BB); }
+
+  /// \brief Discard all the results, the next run will start from scratch
+  void reset();
+
+private:
+  friend class OSRAPass;
+
+  OSRAState *State;
+
+  /// Basic blocks reported since the last run, possibly erased
+  llvm::DenseSet<llvm::BasicBlock *> Invalidated;
+};
 
 /// \brief DFA to represent values as a + b * x, with c < x < d
 class OSRAPass : public llvm::ModulePass {
 public:
   static char ID;
 
-  OSRAPass() : llvm::ModulePass(ID), BVs(nullptr) {}
+  /// \brief Polled while the DFA runs, returns false to have it give up
+  using BudgetFunc = std::function<bool()>;
+
+  OSRAPass() :
+    llvm::ModulePass(ID),
+    Incremental(nullptr),
+    State(nullptr),
+    OSRs(nullptr) {}
+
+  /// \brief Create an OSRAPass keeping its results in \p Incremental
+  ///
+  /// Each run analyzes only the basic blocks that changed since the previous
+  /// one, and the ones affected by them. If \p Incremental is nullptr, each
+  /// run starts from scratch.
+  ///
+  /// \param HasBudget if set, polled during the analysis. As soon as it
+  ///        returns false the analysis is interrupted and, since partial
+  ///        results are not sound, no OSR is provided.
+  explicit OSRAPass(IncrementalOSRA *Incremental,
+                    BudgetFunc HasBudget = BudgetFunc()) :
+    llvm::ModulePass(ID),
+    Incremental(Incremental),
+    HasBudget(HasBudget),
+    State(nullptr),
+    OSRs(nullptr) {}
 
   bool runOnModule(llvm::Module &M) override;
 
@@ -685,6 +738,9 @@ public:
     const BoundedValue *BV;
   };
 
+public:
+  using OSRMap = llvm::DenseMap<const llvm::Value *, OSR>;
+
 public:
   const OSR *getOSR(const llvm::Value *V) {
     auto *I = llvm::dyn_cast<llvm::Instruction>(V);
@@ -692,8 +748,8 @@ public:
     if (I == nullptr)
       return nullptr;
 
-    auto It = OSRs.find(I);
-    if (It == OSRs.end())
+    auto It = OSRs->find(I);
+    if (It == OSRs->end())
       return nullptr;
     else
       return &It->second;
@@ -701,12 +757,12 @@ public:
 
   std::pair<llvm::Constant *, llvm::Value *>
   identifyOperands(const llvm::Instruction *I, const llvm::DataLayout &DL) {
-    return identifyOperands(OSRs, I, DL);
+    return identifyOperands(*OSRs, I, DL);
   }
 
   // TODO: make me private?
   static std::pair<llvm::Constant *, llvm::Value *>
-  identifyOperands(std::map<const llvm::Value *, const OSR> &OSRs,
+  identifyOperands(OSRMap &OSRs,
                    const llvm::Instruction *I,
                    const llvm::DataLayout &DL);
 
@@ -716,9 +772,13 @@ private:
   ~OSRAPass() override;
 
 private:
+  /// Where the results are preserved across runs, if any
+  IncrementalOSRA *Incremental;
+  BudgetFunc HasBudget;
+  /// The state of the DFA, owned by this pass if Incremental is nullptr
+  OSRAState *State;
   // TODO: why value and not instruction?
-  std::map<const llvm::Value *, const OSR> OSRs;
-  BVMap *BVs;
+  OSRMap *OSRs;
 };
 
 #endif // OSRA_H
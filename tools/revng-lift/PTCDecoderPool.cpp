@@ -0,0 +1,237 @@
+/// \file ptcdecoderpool.cpp
+/// \brief This file implements a pool of threads decoding code with private
+///        instances of libtinycode.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+extern "C" {
+#include <dlfcn.h>
+}
+
+// LLVM includes
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+#include "revng/Support/Debug.h"
+
+// Local includes
+#include "PTCDecoderPool.h"
+
+static Logger<> DecoderLog("ptc-decoder");
+
+static void mapExecutableSegments(PTCInterface &Interface,
+                                  const BinaryFile &Binary) {
+  for (const SegmentInfo &Segment : Binary.segments()) {
+    if (Segment.IsExecutable) {
+      Interface.mmap(Segment.StartVirtualAddress,
+                     static_cast<const void *>(Segment.Data.data()),
+                     static_cast<size_t>(Segment.Data.size()));
+    }
+  }
+}
+
+PTCDecoderPool::PTCDecoderPool(const std::string &LibraryPath,
+                               const BinaryFile &Binary,
+                               unsigned WorkersCount) :
+  Quit(false) {
+
+  for (unsigned I = 0; I < WorkersCount; I++) {
+    Workers.emplace_back(new Worker);
+    Worker &W = *Workers.back();
+    loadWorker(W, LibraryPath);
+    mapExecutableSegments(W.Interface, Binary);
+    registerPTCInstance(&W.Interface);
+  }
+
+  // Start the threads only once all the instances are ready
+  for (std::unique_ptr<Worker> &W : Workers)
+    W->Thread = std::thread(&PTCDecoderPool::run, this, std::ref(*W));
+}
+
+PTCDecoderPool::~PTCDecoderPool() {
+  {
+    std::unique_lock<std::mutex> Guard(Lock);
+    Quit = true;
+  }
+  NewRequest.notify_all();
+
+  for (std::unique_ptr<Worker> &W : Workers)
+    W->Thread.join();
+
+  // Release the instruction lists before unloading the libraries
+  Entries.clear();
+
+  for (std::unique_ptr<Worker> &W : Workers) {
+    unregisterPTCInstance(&W->Interface);
+    dlclose(W->Library);
+  }
+}
+
+void PTCDecoderPool::loadWorker(Worker &W, const std::string &LibraryPath) {
+  // dlopen returns the same handle for the same path, therefore we have to
+  // load a private copy of the library to get a new instance of its state
+  auto Source = llvm::MemoryBuffer::getFile(LibraryPath);
+  revng_check(Source, "Couldn't read libtinycode");
+
+  int FD = -1;
+  llvm::SmallString<128> TemporaryPath;
+  std::error_code EC = llvm::sys::fs::createTemporaryFile("libtinycode",
+                                                          "so",
+                                                          FD,
+                                                          TemporaryPath);
+  revng_check(not EC, "Couldn't create a copy of libtinycode");
+
+  {
+    llvm::raw_fd_ostream Destination(FD, true);
+    Destination << (*Source)->getBuffer();
+    Destination.close();
+    revng_check(not Destination.has_error());
+  }
+
+  // RTLD_DEEPBIND ensures the copy binds to its own symbols first
+  const char *Path = TemporaryPath.c_str();
+  W.Library = dlopen(Path, RTLD_NOW | RTLD_LOCAL | RTLD_DEEPBIND);
+  llvm::sys::fs::remove(TemporaryPath);
+  revng_check(W.Library != nullptr, "Couldn't load a copy of libtinycode");
+
+  auto PTCLoad = reinterpret_cast<ptc_load_ptr_t>(dlsym(W.Library,
+                                                        "ptc_load"));
+  revng_check(PTCLoad != nullptr);
+
+  W.Interface = {};
+  revng_check(PTCLoad(W.Library, &W.Interface) == 0);
+}
+
+void PTCDecoderPool::run(Worker &W) {
+  std::unique_lock<std::mutex> Guard(Lock);
+
+  while (true) {
+    NewRequest.wait(Guard, [this] { return Quit or not Requests.empty(); });
+    if (Quit)
+      return;
+
+    uint64_t VirtualAddress = Requests.front();
+    Requests.pop_front();
+    if (Requests.empty())
+      NewResult.notify_all();
+
+    auto It = Entries.find(VirtualAddress);
+    if (It == Entries.end() or It->second.State != Queued)
+      continue;
+    It->second.State = Decoding;
+
+    // Decode without holding the lock
+    Guard.unlock();
+    PTCInstructionListPtr Instructions(new PTCInstructionList);
+    size_t ConsumedSize = W.Interface.translate(VirtualAddress,
+                                                Instructions.get());
+    Guard.lock();
+
+    // Nobody removes an entry while it's being decoded
+    It = Entries.find(VirtualAddress);
+    revng_assert(It != Entries.end() and It->second.State == Decoding);
+
+    if (It->second.Wanted) {
+      It->second.Result = { std::move(Instructions), ConsumedSize };
+      It->second.State = Ready;
+    } else {
+      Entries.erase(It);
+    }
+
+    NewResult.notify_all();
+  }
+}
+
+PTCDecoderPool::DecodedBlock PTCDecoderPool::decode(uint64_t VirtualAddress) {
+  if (not Workers.empty()) {
+    std::unique_lock<std::mutex> Guard(Lock);
+
+    auto It = Entries.find(VirtualAddress);
+    if (It != Entries.end()) {
+      if (It->second.State == Decoding) {
+        It->second.Wanted = true;
+        NewResult.wait(Guard, [this, VirtualAddress] {
+          return Entries.at(VirtualAddress).State == Ready;
+        });
+        It = Entries.find(VirtualAddress);
+      }
+
+      if (It->second.State == Ready) {
+        revng_log(DecoderLog, "Hit 0x" << std::hex << VirtualAddress);
+        DecodedBlock Result = std::move(It->second.Result);
+        Entries.erase(It);
+        return Result;
+      }
+
+      // It's still in the queue, it's faster to do it ourselves
+      Entries.erase(It);
+    }
+
+    revng_log(DecoderLog, "Miss 0x" << std::hex << VirtualAddress);
+  }
+
+  DecodedBlock Result{ PTCInstructionListPtr(new PTCInstructionList), 0 };
+  PTCInstructionList *Instructions = Result.Instructions.get();
+  Result.ConsumedSize = ptc.translate(VirtualAddress, Instructions);
+  return Result;
+}
+
+void PTCDecoderPool::wait() {
+  std::unique_lock<std::mutex> Guard(Lock);
+  NewResult.wait(Guard, [this] {
+    if (not Requests.empty())
+      return false;
+
+    for (auto &P : Entries)
+      if (P.second.State == Decoding)
+        return false;
+
+    return true;
+  });
+}
+
+void PTCDecoderPool::prefetch(llvm::ArrayRef<uint64_t> Addresses) {
+  if (Workers.empty())
+    return;
+
+  {
+    std::unique_lock<std::mutex> Guard(Lock);
+
+    for (auto &P : Entries)
+      P.second.Wanted = false;
+
+    for (uint64_t VirtualAddress : Addresses) {
+      auto It = Entries.find(VirtualAddress);
+      if (It != Entries.end())
+        It->second.Wanted = true;
+    }
+
+    // Drop everything is no longer interesting, except what's being decoded,
+    // the worker will take care of it
+    for (auto It = Entries.begin(); It != Entries.end();) {
+      if (not It->second.Wanted and It->second.State != Decoding)
+        It = Entries.erase(It);
+      else
+        It++;
+    }
+
+    // Enqueue the new addresses, as long as we have room
+    for (uint64_t VirtualAddress : Addresses) {
+      if (Entries.size() >= capacity())
+        break;
+
+      if (Entries.count(VirtualAddress) == 0) {
+        Entries[VirtualAddress] = { Queued, true, { nullptr, 0 } };
+        Requests.push_back(VirtualAddress);
+      }
+    }
+  }
+
+  NewRequest.notify_all();
+}
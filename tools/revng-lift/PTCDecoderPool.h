@@ -0,0 +1,109 @@
+#ifndef PTCDECODERPOOL_H
+#define PTCDECODERPOOL_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/ArrayRef.h"
+
+// Local includes
+#include "BinaryFile.h"
+#include "PTCInterface.h"
+
+/// \brief Pool of threads decoding jump targets ahead of the IR emission
+///
+/// libtinycode keeps its state in global variables, therefore it can't be used
+/// from multiple threads. To work around this, each worker loads a private copy
+/// of libtinycode, with its own state, and maps in it the executable segments
+/// of the input binary.
+///
+/// The IR emission is not affected: it keeps running on the main thread and it
+/// keeps consuming jump targets in the order dictated by the JumpTargetManager.
+/// The workers simply decode in advance the addresses that are expected to be
+/// requested next (see prefetch). If an address has not been decoded in
+/// advance, it is decoded on the spot using the main PTC instance. Since
+/// decoding only depends on the address and on the content of the executable
+/// segments, the result is the same independently of who performed it.
+class PTCDecoderPool {
+public:
+  /// \brief The outcome of the decoding of a jump target
+  struct DecodedBlock {
+    PTCInstructionListPtr Instructions;
+    size_t ConsumedSize;
+  };
+
+public:
+  /// \param LibraryPath path of the libtinycode to load in each worker.
+  /// \param Binary the input binary, whose executable segments will be mapped
+  ///        in each worker.
+  /// \param WorkersCount number of workers to spawn. If 0, all the decoding
+  ///        takes place on the calling thread.
+  PTCDecoderPool(const std::string &LibraryPath,
+                 const BinaryFile &Binary,
+                 unsigned WorkersCount);
+
+  ~PTCDecoderPool();
+
+  /// \brief Obtain the decoded instructions for \p VirtualAddress
+  ///
+  /// If \p VirtualAddress has already been decoded by a worker, its result is
+  /// returned immediately, if it's being decoded, wait for it. Otherwise,
+  /// decode it on the calling thread.
+  DecodedBlock decode(uint64_t VirtualAddress);
+
+  /// \brief Inform the pool of the addresses that will likely be requested
+  ///        next, in order of priority
+  ///
+  /// Any previously prefetched address not in \p Addresses is dropped.
+  void prefetch(llvm::ArrayRef<uint64_t> Addresses);
+
+  /// \brief Wait for the workers to process all the prefetched addresses
+  void wait();
+
+  /// \brief Maximum number of addresses worth prefetching
+  unsigned capacity() const { return 2 * Workers.size(); }
+
+private:
+  enum EntryState { Queued, Decoding, Ready };
+
+  struct Entry {
+    EntryState State;
+    bool Wanted;
+    DecodedBlock Result;
+  };
+
+  struct Worker {
+    void *Library;
+    PTCInterface Interface;
+    std::thread Thread;
+  };
+
+private:
+  void loadWorker(Worker &W, const std::string &LibraryPath);
+  void run(Worker &W);
+
+private:
+  std::vector<std::unique_ptr<Worker>> Workers;
+
+  std::mutex Lock;
+  std::condition_variable NewRequest;
+  std::condition_variable NewResult;
+  std::deque<uint64_t> Requests;
+  std::map<uint64_t, Entry> Entries;
+  bool Quit;
+};
+
+#endif // PTCDECODERPOOL_H
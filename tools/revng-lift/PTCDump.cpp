@@ -68,7 +68,7 @@ int dumpInstruction(std::ostream &Result,
                                                              1);
     size_t OutArgsCount = ptc_call_instruction_out_arg_count(&ptc,
                                                              &Instruction);
-    PTCHelperDef *Helper = ptc_find_helper(&ptc, FunctionPointer);
+    PTCHelperDef *Helper = findHelper(FunctionPointer);
     const char *HelperName = "unknown_helper";
 
     if (Helper != nullptr && Helper->name != nullptr)
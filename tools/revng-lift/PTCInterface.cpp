@@ -0,0 +1,47 @@
+/// \file ptcinterface.cpp
+/// \brief This file keeps track of the instances of the PTC library loaded in
+///        the process.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <algorithm>
+#include <vector>
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+
+// Local includes
+#include "PTCInterface.h"
+
+/// All the PTC instances other than the main one, used to resolve pointers to
+/// helpers appearing in the instruction lists they produced
+static std::vector<PTCInterface *> Instances;
+
+void registerPTCInstance(PTCInterface *Interface) {
+  Instances.push_back(Interface);
+}
+
+void unregisterPTCInstance(PTCInterface *Interface) {
+  auto It = std::find(Instances.begin(), Instances.end(), Interface);
+  revng_assert(It != Instances.end());
+  Instances.erase(It);
+}
+
+PTCHelperDef *findHelper(uint64_t FunctionPointer) {
+  PTCHelperDef *Result = ptc_find_helper(&ptc, FunctionPointer);
+  if (Result != nullptr)
+    return Result;
+
+  // Each instance has its own copy of the helpers, so the addresses can't
+  // overlap
+  for (PTCInterface *Interface : Instances) {
+    Result = ptc_find_helper(Interface, FunctionPointer);
+    if (Result != nullptr)
+      return Result;
+  }
+
+  return nullptr;
+}
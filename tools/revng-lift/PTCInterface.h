@@ -26,4 +26,17 @@ using PTCInstructionListPtr = std::unique_ptr<PTCInstructionList,
 
 extern PTCInterface ptc;
 
+/// \brief Make the helpers of \p Interface visible to findHelper
+void registerPTCInstance(PTCInterface *Interface);
+
+/// \brief Undo registerPTCInstance
+void unregisterPTCInstance(PTCInterface *Interface);
+
+/// \brief Find the definition of the helper at \p FunctionPointer
+///
+/// Unlike ptc_find_helper, this considers all the instances of the PTC library
+/// loaded in the process and registered through registerPTCInstance, such
+/// as those of PTCDecoderPool.
+PTCHelperDef *findHelper(uint64_t FunctionPointer);
+
 #endif // PTCINTERFACE_H
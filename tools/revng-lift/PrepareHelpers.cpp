@@ -0,0 +1,96 @@
+/// \file preparehelpers.cpp
+/// \brief This file implements a tool preparing ahead of time the QEMU helpers
+///        module for revng-lift, along with the results of the analyses on the
+///        helpers that do not depend on the input binary.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+
+// LLVM includes
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/Debug.h"
+
+// Local includes
+#include "CSVAccessSummaries.h"
+#include "HelpersModule.h"
+#include "PTCInterface.h"
+
+using namespace llvm;
+using namespace llvm::cl;
+
+using std::string;
+
+// The analyses share their code with revng-lift, but they never use libptc
+PTCInterface ptc = {};
+
+namespace {
+
+OptionCategory PrepareHelpersCategory("revng-prepare-helpers options");
+
+opt<string> InputPath(Positional,
+                      Required,
+                      desc("<helpers module>"),
+                      cat(PrepareHelpersCategory));
+opt<string> OutputPath(Positional,
+                       Required,
+                       desc("<output path>"),
+                       cat(PrepareHelpersCategory));
+opt<string> SummariesPath("csv-access-summaries",
+                          desc("path where the results of the CPU state "
+                               "access analysis on the helpers should be "
+                               "stored."),
+                          value_desc("path"),
+                          cat(PrepareHelpersCategory));
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  HideUnrelatedOptions({ &PrepareHelpersCategory });
+  ParseCommandLineOptions(argc, argv);
+
+  LLVMContext Context;
+  SMDiagnostic Errors;
+  std::unique_ptr<Module> HelpersModule = parseIRFile(InputPath,
+                                                      Errors,
+                                                      Context);
+  if (HelpersModule.get() == nullptr) {
+    Errors.print("revng-prepare-helpers", dbgs());
+    return EXIT_FAILURE;
+  }
+
+  prepareHelpersModule(*HelpersModule);
+  revng_check(not verifyModule(*HelpersModule, &dbgs()));
+
+  std::error_code EC;
+  raw_fd_ostream Output(OutputPath, EC, sys::fs::F_None);
+  revng_check(not EC, "Couldn't open the output file");
+  WriteBitcodeToFile(*HelpersModule, Output);
+
+  if (SummariesPath.size() != 0) {
+    CSVAccessSummaries Summaries;
+    computeCSVAccessSummaries(*HelpersModule, Summaries);
+    std::ofstream SummariesOutput(SummariesPath);
+    Summaries.serialize(SummariesOutput);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,345 @@
+/// \file regioncleanup.cpp
+/// \brief Cleanup of a subset of the basic blocks of a function
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// Standard includes
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// LLVM includes
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/SSAUpdater.h"
+
+// Local libraries includes
+#include "revng/Support/Assert.h"
+
+// Local includes
+#include "RegionCleanup.h"
+
+using namespace llvm;
+
+using BlockSet = SmallPtrSet<BasicBlock *, 32>;
+
+/// \brief Record in \p Affected the blocks outside \p InRegion using \p I
+static void recordUsers(Instruction *I,
+                        const BlockSet &InRegion,
+                        BlockSet &Affected) {
+  for (User *U : I->users()) {
+    BasicBlock *Parent = cast<Instruction>(U)->getParent();
+    if (InRegion.count(Parent) == 0)
+      Affected.insert(Parent);
+  }
+}
+
+/// \brief Collect the accesses to \p Alloca, if it can be promoted
+///
+/// \return true if all the users of \p Alloca are simple loads and stores of
+///         the allocated type in \p InRegion.
+static bool collectAccesses(AllocaInst *Alloca,
+                            const BlockSet &InRegion,
+                            SmallVectorImpl<Instruction *> &Accesses) {
+  if (Alloca->isArrayAllocation())
+    return false;
+
+  Type *AllocatedType = Alloca->getAllocatedType();
+  Accesses.clear();
+  for (User *U : Alloca->users()) {
+    auto *I = cast<Instruction>(U);
+    if (InRegion.count(I->getParent()) == 0)
+      return false;
+
+    if (auto *Load = dyn_cast<LoadInst>(I)) {
+      if (not Load->isSimple() or Load->getType() != AllocatedType)
+        return false;
+    } else if (auto *Store = dyn_cast<StoreInst>(I)) {
+      if (not Store->isSimple() or Store->getValueOperand() == Alloca
+          or Store->getValueOperand()->getType() != AllocatedType)
+        return false;
+    } else {
+      return false;
+    }
+
+    Accesses.push_back(I);
+  }
+
+  return true;
+}
+
+/// \brief Promote to SSA values the allocas accessed only in \p Region
+///
+/// The PHIs required to merge the values might be placed outside \p Region,
+/// their blocks are recorded in \p Affected.
+static bool promoteAllocas(ArrayRef<BasicBlock *> Region,
+                           const BlockSet &InRegion,
+                           BlockSet &Affected) {
+  // Consider only the allocas accessed in the region, the entry block might
+  // contain many more
+  SmallVector<AllocaInst *, 16> Candidates;
+  SmallPtrSet<AllocaInst *, 16> Seen;
+  for (BasicBlock *BB : Region) {
+    for (Instruction &I : *BB) {
+      Value *Pointer = nullptr;
+      if (auto *Load = dyn_cast<LoadInst>(&I))
+        Pointer = Load->getPointerOperand();
+      else if (auto *Store = dyn_cast<StoreInst>(&I))
+        Pointer = Store->getPointerOperand();
+
+      auto *Alloca = dyn_cast_or_null<AllocaInst>(Pointer);
+      if (Alloca != nullptr and Seen.insert(Alloca).second)
+        Candidates.push_back(Alloca);
+    }
+  }
+
+  bool Changed = false;
+  SmallVector<Instruction *, 16> Accesses;
+  SmallVector<PHINode *, 8> InsertedPHIs;
+  for (AllocaInst *Alloca : Candidates) {
+    if (not collectAccesses(Alloca, InRegion, Accesses))
+      continue;
+
+    InsertedPHIs.clear();
+    SSAUpdater Updater(&InsertedPHIs);
+    LoadAndStorePromoter(Accesses, Updater).run(Accesses);
+    for (PHINode *PHI : InsertedPHIs)
+      if (InRegion.count(PHI->getParent()) == 0)
+        Affected.insert(PHI->getParent());
+
+    // The entry block loses an instruction
+    revng_assert(Alloca->use_empty());
+    if (InRegion.count(Alloca->getParent()) == 0)
+      Affected.insert(Alloca->getParent());
+    Alloca->eraseFromParent();
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+/// \brief Values available at a certain point of the code
+class AvailableValues {
+public:
+  /// \brief Find a side effect free instruction identical to \p I
+  Instruction *findIdentical(Instruction *I) const {
+    auto Range = Computations.equal_range(hash(I));
+    for (auto It = Range.first; It != Range.second; ++It)
+      if (It->second->isIdenticalTo(I))
+        return It->second;
+    return nullptr;
+  }
+
+  void addComputation(Instruction *I) { Computations.insert({ hash(I), I }); }
+
+  /// \brief Get the value of type \p T known to be stored at \p Pointer
+  Value *findLoaded(Value *Pointer, Type *T) const {
+    auto It = Memory.find(Pointer);
+    if (It == Memory.end() or It->second->getType() != T)
+      return nullptr;
+    return It->second;
+  }
+
+  void addLoaded(Value *Pointer, Value *V) { Memory[Pointer] = V; }
+
+  /// \brief Forget the values in memory that a store to \p Pointer might
+  ///        overwrite
+  void clobber(Value *Pointer, const DataLayout &DL) {
+    // Stores to distinct globals and allocas don't alias
+    Value *Object = GetUnderlyingObject(Pointer, DL);
+    if (not isIdentified(Object)) {
+      clobberAll();
+      return;
+    }
+
+    SmallVector<Value *, 8> ToErase;
+    for (auto &P : Memory) {
+      Value *Other = GetUnderlyingObject(P.first, DL);
+      if (Other == Object or not isIdentified(Other))
+        ToErase.push_back(P.first);
+    }
+
+    for (Value *Erase : ToErase)
+      Memory.erase(Erase);
+  }
+
+  void clobberAll() { Memory.clear(); }
+
+private:
+  static bool isIdentified(Value *Object) {
+    return isa<GlobalVariable>(Object) or isa<AllocaInst>(Object);
+  }
+
+  static size_t hash(Instruction *I) {
+    hash_code Result = hash_combine(I->getOpcode(), I->getType());
+    if (auto *Compare = dyn_cast<CmpInst>(I))
+      Result = hash_combine(Result, Compare->getPredicate());
+    for (Value *Operand : I->operands())
+      Result = hash_combine(Result, Operand);
+    return Result;
+  }
+
+private:
+  std::unordered_multimap<size_t, Instruction *> Computations;
+  DenseMap<Value *, Value *> Memory;
+};
+
+static bool isComputation(Instruction *I) {
+  return isa<BinaryOperator>(I) or isa<CastInst>(I) or isa<CmpInst>(I)
+         or isa<GetElementPtrInst>(I) or isa<SelectInst>(I)
+         or isa<ExtractValueInst>(I) or isa<InsertValueInst>(I);
+}
+
+/// \brief Region being cleaned up, along with the blocks affected outside it
+struct RegionInfo {
+  const BlockSet &InRegion;
+  BlockSet &Affected;
+  const DataLayout &DL;
+};
+
+static void replace(Instruction *I, Value *With, RegionInfo &Info) {
+  recordUsers(I, Info.InRegion, Info.Affected);
+  I->replaceAllUsesWith(With);
+  I->eraseFromParent();
+}
+
+/// \brief Simplify the instructions of \p BB and eliminate the redundant ones
+///
+/// \param Available the values available at the beginning of \p BB, updated
+///        with the ones available at its end.
+static bool cleanupBlock(BasicBlock *BB,
+                         RegionInfo &Info,
+                         AvailableValues &Available) {
+  const DataLayout &DL = Info.DL;
+  bool Changed = false;
+
+  for (auto It = BB->begin(); It != BB->end();) {
+    Instruction *I = &*It++;
+
+    Value *Simplified = SimplifyInstruction(I, SimplifyQuery(DL, I));
+    if (Simplified != nullptr and Simplified != I) {
+      recordUsers(I, Info.InRegion, Info.Affected);
+      I->replaceAllUsesWith(Simplified);
+      Changed = true;
+    }
+
+    if (isInstructionTriviallyDead(I)) {
+      I->eraseFromParent();
+      Changed = true;
+      continue;
+    }
+
+    if (auto *Load = dyn_cast<LoadInst>(I)) {
+      if (Load->isSimple()) {
+        Value *Pointer = Load->getPointerOperand();
+        if (Value *Loaded = Available.findLoaded(Pointer, Load->getType())) {
+          replace(Load, Loaded, Info);
+          Changed = true;
+        } else {
+          Available.addLoaded(Pointer, Load);
+        }
+        continue;
+      }
+    }
+
+    if (auto *Store = dyn_cast<StoreInst>(I)) {
+      if (Store->isSimple()) {
+        Value *Pointer = Store->getPointerOperand();
+        Available.clobber(Pointer, DL);
+        Available.addLoaded(Pointer, Store->getValueOperand());
+        continue;
+      }
+    }
+
+    if (I->mayWriteToMemory()) {
+      Available.clobberAll();
+      continue;
+    }
+
+    if (isComputation(I)) {
+      if (Instruction *Identical = Available.findIdentical(I)) {
+        replace(I, Identical, Info);
+        Changed = true;
+      } else {
+        Available.addComputation(I);
+      }
+    }
+  }
+
+  return Changed;
+}
+
+bool cleanupRegion(ArrayRef<BasicBlock *> Region,
+                   SmallVectorImpl<BasicBlock *> &Affected) {
+  if (Region.empty())
+    return false;
+
+  BlockSet InRegion(Region.begin(), Region.end());
+  BlockSet AffectedSet;
+  const DataLayout &DL = Region.front()->getModule()->getDataLayout();
+  RegionInfo Info = { InRegion, AffectedSet, DL };
+
+  bool Changed = promoteAllocas(Region, InRegion, AffectedSet);
+
+  // Visit the region depth-first, propagating the available values from each
+  // block to the successors of which it's the only predecessor
+  BlockSet Visited;
+  auto Visit = [&](BasicBlock *Start) {
+    std::vector<std::pair<BasicBlock *, AvailableValues>> Stack;
+    Stack.emplace_back(Start, AvailableValues());
+    while (not Stack.empty()) {
+      BasicBlock *BB = Stack.back().first;
+      AvailableValues Available = std::move(Stack.back().second);
+      Stack.pop_back();
+
+      if (not Visited.insert(BB).second)
+        continue;
+
+      Changed = cleanupBlock(BB, Info, Available) or Changed;
+
+      for (BasicBlock *Successor : successors(BB))
+        if (InRegion.count(Successor) != 0 and Visited.count(Successor) == 0
+            and Successor->getSinglePredecessor() == BB)
+          Stack.emplace_back(Successor, Available);
+    }
+  };
+
+  // Start from the blocks that can't inherit values from a predecessor, then
+  // handle the remaining ones (e.g., cycles of single-predecessor blocks)
+  for (BasicBlock *BB : Region) {
+    BasicBlock *Predecessor = BB->getSinglePredecessor();
+    if (Predecessor == nullptr or InRegion.count(Predecessor) == 0)
+      Visit(BB);
+  }
+
+  for (BasicBlock *BB : Region)
+    if (Visited.count(BB) == 0)
+      Visit(BB);
+
+  // Purge the instructions left without users
+  for (BasicBlock *BB : Region) {
+    for (auto It = BB->rbegin(); It != BB->rend();) {
+      Instruction *I = &*It++;
+      if (isInstructionTriviallyDead(I)) {
+        I->eraseFromParent();
+        Changed = true;
+      }
+    }
+  }
+
+  for (BasicBlock *BB : AffectedSet)
+    if (InRegion.count(BB) == 0)
+      Affected.push_back(BB);
+
+  return Changed;
+}
@@ -0,0 +1,38 @@
+#ifndef REGIONCLEANUP_H
+#define REGIONCLEANUP_H
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+// LLVM includes
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace llvm {
+class BasicBlock;
+}
+
+/// \brief Clean up the code of a set of basic blocks of the same function
+///
+/// This performs a subset of what SROA, constant propagation and EarlyCSE do,
+/// but its cost is proportional to the size of \p Region, not of the whole
+/// function:
+///
+/// * the allocas accessed only through loads and stores in \p Region are
+///   promoted to SSA values;
+/// * instructions are constant folded and simplified;
+/// * redundant computations and loads are eliminated, and stored values are
+///   forwarded to the loads, within each block and across the blocks with a
+///   single predecessor in \p Region.
+///
+/// \param Affected populated with the blocks outside \p Region whose code has
+///        been changed too, e.g., the entry block, which loses the promoted
+///        allocas, the blocks receiving the PHIs introduced by the promotion
+///        or those using the values replaced in \p Region.
+///
+/// \return true if the code has been changed.
+bool cleanupRegion(llvm::ArrayRef<llvm::BasicBlock *> Region,
+                   llvm::SmallVectorImpl<llvm::BasicBlock *> &Affected);
+
+#endif // REGIONCLEANUP_H
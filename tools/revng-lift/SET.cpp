@@ -11,14 +11,19 @@
 
 // Standard includes
 #include <iterator>
+#include <map>
+#include <thread>
 
 // LLVM includes
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 
 // Local libraries includes
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/revng.h"
@@ -33,6 +38,17 @@ using std::make_pair;
 
 static Logger<> NewEdgesLog("new-edges");
 
+static cl::opt<unsigned> SETThreads("set-threads",
+                                    cl::desc("number of additional threads "
+                                             "materializing the values of "
+                                             "large ranges in SET"),
+                                    cl::value_desc("threads"),
+                                    cl::cat(MainCategory),
+                                    cl::init(0));
+
+/// Ranges with fewer values are materialized on the current thread only
+static const size_t MinParallelValues = 512;
+
 class MaterializedValue {
 private:
   bool IsValid;
@@ -66,6 +82,33 @@ public:
   }
 };
 
+/// \brief Value materialized without creating LLVM constants
+///
+/// Unlike MaterializedValue, it is produced without touching the LLVM context
+/// or the JumpTargetManager, and therefore can be computed on any thread.
+struct FastMaterialization {
+  enum Kinds {
+    Invalid, ///< The value cannot be materialized
+    Valid, ///< The value has been materialized
+    Unsupported ///< The value has to be materialized through materialize
+  };
+
+  FastMaterialization() : Kind(Invalid), Value(0) {}
+
+  Kinds Kind;
+  uint64_t Value;
+  /// Address and size of the reads from the binary
+  SmallVector<std::pair<uint64_t, unsigned>, 2> Reads;
+};
+
+/// \brief Strided range of PCs to register as jump targets
+struct PCRange {
+  uint64_t Base;
+  uint64_t Stride;
+  uint64_t Count;
+  bool IsPCStore;
+};
+
 /// \brief Stack to keep track of the operations generating a specific value
 ///
 /// The OperationsStacks offers the following features:
@@ -103,6 +146,11 @@ public:
   }
   MaterializedValue materialize(Constant *NewOperand, bool HandleSymbols);
 
+  /// \brief Explore all the values in \p Values, of type \p Int64
+  ///
+  /// If possible, the values are materialized in parallel.
+  void exploreAll(Type *Int64, const std::vector<uint64_t> &Values);
+
   /// \brief What values should be tracked
   enum TrackingType {
     None, ///< Don't track anything
@@ -139,21 +187,48 @@ public:
     Target = Store;
   }
 
+  /// \brief Register the new PCs, in ascending order
+  ///
+  /// The PCs and the ranges are registered as if all the values of the ranges
+  /// were in NewPCs: a range is split where a PC falls in the middle of it.
   void registerPCs() const {
-    const auto SETToPC = JTReason::SETToPC;
-    const auto SETNotToPC = JTReason::SETNotToPC;
-    for (auto &P : NewPCs) {
-
-      if (not JTM->hasJT(P.first) and NewEdgesLog.isEnabled()) {
-        uint64_t Source = JTM->getPC(Target).first;
-        uint64_t Destination = P.first;
-        NewEdgesLog << std::hex << "0x" << Source << " -> 0x" << Destination
-                    << " (" << getName(Target->getParent()) << " -> "
-                    << JTM->nameForAddress(Destination) << ")" << DoLog;
-      }
+    using PCPair = std::pair<uint64_t, bool>;
+    auto It = NewPCs.begin();
+    auto End = NewPCs.end();
+
+    for (auto &P : NewPCRanges) {
+      const PCRange &Range = P.second;
+      uint64_t Registered = 0;
+      while (Registered < Range.Count) {
+        uint64_t Address = Range.Base + Registered * Range.Stride;
+        PCPair Element = { Address, Range.IsPCStore };
+
+        // Register the PCs preceding the next value of the range
+        for (; It != End and *It < Element; ++It)
+          registerPC(It->first, It->second);
+
+        // A PC equal to the value will be registered as part of the range
+        if (It != End and *It == Element)
+          ++It;
+
+        // Register the values of the range preceding the next PC
+        uint64_t Count = Range.Count - Registered;
+        if (It != End) {
+          uint64_t Distance = It->first - Address;
+          uint64_t Preceding = (Distance + Range.Stride - 1) / Range.Stride;
+          uint64_t Next = Address + Preceding * Range.Stride;
+          if (Next == It->first and Range.IsPCStore < It->second)
+            Preceding++;
+          Count = std::min(Count, Preceding);
+        }
 
-      JTM->registerJT(P.first, P.second ? SETToPC : SETNotToPC);
+        registerRange(Address, Range.Stride, Count, Range.IsPCStore);
+        Registered += Count;
+      }
     }
+
+    for (; It != End; ++It)
+      registerPC(It->first, It->second);
   }
 
   void registerLoadAddresses() const {
@@ -264,6 +339,54 @@ public:
       Output << dumpToString(I) << "\n";
   }
 
+private:
+  /// \brief Record a materialized value, which is not relative to a symbol
+  void record(uint64_t Value);
+
+  void registerPC(uint64_t PC, bool IsPCStore) const {
+    logNewEdge(PC);
+    JTM->registerJT(PC, IsPCStore ? JTReason::SETToPC : JTReason::SETNotToPC);
+  }
+
+  void registerRange(uint64_t Base,
+                     uint64_t Stride,
+                     uint64_t Count,
+                     bool IsPCStore) const {
+    if (NewEdgesLog.isEnabled())
+      for (uint64_t I = 0; I < Count; I++)
+        logNewEdge(Base + I * Stride);
+
+    JTM->registerJTRange(Base,
+                         Stride,
+                         Count,
+                         IsPCStore ? JTReason::SETToPC : JTReason::SETNotToPC);
+  }
+
+  void logNewEdge(uint64_t Destination) const {
+    if (JTM->hasJT(Destination) or not NewEdgesLog.isEnabled())
+      return;
+
+    uint64_t Source = JTM->getPC(Target).first;
+    NewEdgesLog << std::hex << "0x" << Source << " -> 0x" << Destination
+                << " (" << getName(Target->getParent()) << " -> "
+                << JTM->nameForAddress(Destination) << ")" << DoLog;
+  }
+
+  /// \brief Record \p Results at once, if they are a strided range of PCs
+  ///
+  /// \return true if \p Results have been recorded.
+  bool recordPCRange(ArrayRef<FastMaterialization> Results);
+
+  /// \brief Check if all the operations are supported by materializeFast
+  bool isFastMaterializable() const;
+
+  /// \brief Thread-safe version of materialize, for integers only
+  FastMaterialization materializeFast(uint64_t Start) const;
+
+  /// \brief Find a label describing the \p Size bytes at \p Address
+  const Label *
+  findLabel(uint64_t Address, unsigned Size, bool HandleSymbols) const;
+
 private:
   JumpTargetManager *JTM;
   const DataLayout &DL;
@@ -271,6 +394,8 @@ private:
   std::vector<Instruction *> Operations;
   std::set<Instruction *> OperationsSet;
   std::set<std::pair<uint64_t, bool>> NewPCs;
+  /// Disjoint ranges of new PCs, by base address
+  std::map<uint64_t, PCRange> NewPCRanges;
   std::set<uint64_t> TrackedValues;
   std::set<uint64_t> LoadAddresses;
 
@@ -324,45 +449,28 @@ OperationsStack::materialize(Constant *NewOperand, bool HandleSymbols) {
         return MaterializedValue::invalid();
       }
 
-      const auto &Labels = JTM->binary().labels();
-      using interval = boost::icl::interval<uint64_t>;
-      auto Interval = interval::right_open(LoadAddress, LoadAddress + LoadSize);
-      auto It = Labels.find(Interval);
-      if (It != Labels.end()) {
-        const Label *Match = nullptr;
-        for (const Label *Candidate : It->second) {
-          if (Candidate->size() == LoadSize
-              and (Candidate->isAbsoluteValue()
-                   or Candidate->isBaseRelativeValue()
-                   or (HandleSymbols and Candidate->isSymbolRelativeValue()))) {
-            revng_assert(Match == nullptr,
-                         "Multiple value labels at the same location");
-            Match = Candidate;
-          }
-        }
-
-        if (Match != nullptr) {
-          uint64_t Value;
-          switch (Match->type()) {
-          case LabelType::AbsoluteValue:
-            Value = Match->value();
-            break;
-
-          case LabelType::BaseRelativeValue:
-            Value = JTM->binary().relocate(Match->value());
-            break;
+      const Label *Match = findLabel(LoadAddress, LoadSize, HandleSymbols);
+      if (Match != nullptr) {
+        uint64_t Value;
+        switch (Match->type()) {
+        case LabelType::AbsoluteValue:
+          Value = Match->value();
+          break;
 
-          case LabelType::SymbolRelativeValue:
-            Value = Match->offset();
-            SymbolName = Match->symbolName();
-            break;
+        case LabelType::BaseRelativeValue:
+          Value = JTM->binary().relocate(Match->value());
+          break;
 
-          default:
-            revng_abort();
-          }
+        case LabelType::SymbolRelativeValue:
+          Value = Match->offset();
+          SymbolName = Match->symbolName();
+          break;
 
-          NewOperand = ConstantInt::get(Load->getType(), Value);
+        default:
+          revng_abort();
         }
+
+        NewOperand = ConstantInt::get(Load->getType(), Value);
       }
 
       if (NewOperand == nullptr)
@@ -441,6 +549,333 @@ OperationsStack::materialize(Constant *NewOperand, bool HandleSymbols) {
   return MaterializedValue::invalid();
 }
 
+const Label *OperationsStack::findLabel(uint64_t LoadAddress,
+                                        unsigned LoadSize,
+                                        bool HandleSymbols) const {
+  const auto &Labels = JTM->binary().labels();
+  using interval = boost::icl::interval<uint64_t>;
+  auto Interval = interval::right_open(LoadAddress, LoadAddress + LoadSize);
+  auto It = Labels.find(Interval);
+  if (It == Labels.end())
+    return nullptr;
+
+  const Label *Match = nullptr;
+  for (const Label *Candidate : It->second) {
+    if (Candidate->size() == LoadSize
+        and (Candidate->isAbsoluteValue() or Candidate->isBaseRelativeValue()
+             or (HandleSymbols and Candidate->isSymbolRelativeValue()))) {
+      revng_assert(Match == nullptr,
+                   "Multiple value labels at the same location");
+      Match = Candidate;
+    }
+  }
+
+  return Match;
+}
+
+bool OperationsStack::isFastMaterializable() const {
+  auto IsSupportedType = [](Type *T) {
+    return T->isIntegerTy() and T->getIntegerBitWidth() <= 64;
+  };
+
+  for (Instruction *I : Operations) {
+    if (not IsSupportedType(I->getType()))
+      return false;
+
+    // Loads and calls to bswap are always supported
+    if (isa<LoadInst>(I) or isa<CallInst>(I))
+      continue;
+
+    switch (I->getOpcode()) {
+    case Instruction::Add:
+    case Instruction::Sub:
+    case Instruction::Mul:
+    case Instruction::UDiv:
+    case Instruction::SDiv:
+    case Instruction::URem:
+    case Instruction::SRem:
+    case Instruction::Shl:
+    case Instruction::LShr:
+    case Instruction::AShr:
+    case Instruction::And:
+    case Instruction::Or:
+    case Instruction::Xor:
+    case Instruction::ZExt:
+    case Instruction::SExt:
+    case Instruction::Trunc:
+      break;
+    default:
+      return false;
+    }
+
+    for (Value *Op : I->operand_values()) {
+      if (isa<Constant>(Op) and not isa<ConstantInt>(Op))
+        return false;
+      if (not IsSupportedType(Op->getType()))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+FastMaterialization OperationsStack::materializeFast(uint64_t Start) const {
+  using Endianess = BinaryFile::Endianess;
+  FastMaterialization Result;
+  const BinaryFile &Binary = JTM->binary();
+  APInt Current(64, Start);
+
+  for (Instruction *I : make_range(Operations.rbegin(), Operations.rend())) {
+    if (auto *Load = dyn_cast<LoadInst>(I)) {
+      uint64_t LoadAddress = Current.getZExtValue();
+      unsigned LoadSize = Load->getType()->getPrimitiveSizeInBits() / 8;
+      revng_assert(LoadSize != 0);
+
+      Endianess E = (DL.isLittleEndian() ? Endianess::LittleEndian :
+                                           Endianess::BigEndian);
+      Result.Reads.push_back({ LoadAddress, LoadSize });
+      Optional<uint64_t> Read = Binary.readRawValue(LoadAddress, LoadSize, E);
+
+      // Prevent overflow when computing the label interval
+      if (LoadAddress + LoadSize < LoadAddress)
+        return Result;
+
+      if (const Label *Match = findLabel(LoadAddress, LoadSize, true)) {
+        switch (Match->type()) {
+        case LabelType::AbsoluteValue:
+          Read = Match->value();
+          break;
+
+        case LabelType::BaseRelativeValue:
+          Read = Binary.relocate(Match->value());
+          break;
+
+        default:
+          // Symbols can be handled only by materialize
+          Result.Kind = FastMaterialization::Unsupported;
+          return Result;
+        }
+      }
+
+      if (not Read.hasValue())
+        return Result;
+
+      Current = APInt(LoadSize * 8, *Read);
+
+    } else if (isa<CallInst>(I)) {
+      // A call to bswap
+      unsigned Width = Current.getBitWidth();
+      if (Width != 16 and Width != 32 and Width != 64) {
+        Result.Kind = FastMaterialization::Unsupported;
+        return Result;
+      }
+
+      Current = Current.byteSwap();
+
+    } else {
+      // Replace the free operand with the current value
+      SmallVector<APInt, 2> Operands;
+      for (Value *Op : I->operand_values()) {
+        if (auto *Const = dyn_cast<ConstantInt>(Op)) {
+          Operands.push_back(Const->getValue());
+        } else {
+          unsigned Width = Op->getType()->getIntegerBitWidth();
+          if (Width > Current.getBitWidth()) {
+            Result.Kind = FastMaterialization::Unsupported;
+            return Result;
+          }
+          Operands.push_back(Current.zextOrTrunc(Width));
+        }
+      }
+
+      // Fold the operation, giving up where constant folding would produce
+      // undef
+      unsigned Width = I->getType()->getIntegerBitWidth();
+      const APInt &A = Operands[0];
+      switch (I->getOpcode()) {
+      case Instruction::ZExt:
+        Current = A.zext(Width);
+        break;
+      case Instruction::SExt:
+        Current = A.sext(Width);
+        break;
+      case Instruction::Trunc:
+        Current = A.trunc(Width);
+        break;
+      default: {
+        const APInt &B = Operands[1];
+        bool Overflows = A.isMinSignedValue() and B.isAllOnesValue();
+        switch (I->getOpcode()) {
+        case Instruction::Add:
+          Current = A + B;
+          break;
+        case Instruction::Sub:
+          Current = A - B;
+          break;
+        case Instruction::Mul:
+          Current = A * B;
+          break;
+        case Instruction::UDiv:
+          if (B == 0)
+            return Result;
+          Current = A.udiv(B);
+          break;
+        case Instruction::SDiv:
+          if (B == 0 or Overflows)
+            return Result;
+          Current = A.sdiv(B);
+          break;
+        case Instruction::URem:
+          if (B == 0)
+            return Result;
+          Current = A.urem(B);
+          break;
+        case Instruction::SRem:
+          if (B == 0 or Overflows)
+            return Result;
+          Current = A.srem(B);
+          break;
+        case Instruction::Shl:
+          if (B.uge(Width))
+            return Result;
+          Current = A.shl(B.getZExtValue());
+          break;
+        case Instruction::LShr:
+          if (B.uge(Width))
+            return Result;
+          Current = A.lshr(B.getZExtValue());
+          break;
+        case Instruction::AShr:
+          if (B.uge(Width))
+            return Result;
+          Current = A.ashr(B.getZExtValue());
+          break;
+        case Instruction::And:
+          Current = A & B;
+          break;
+        case Instruction::Or:
+          Current = A | B;
+          break;
+        case Instruction::Xor:
+          Current = A ^ B;
+          break;
+        default:
+          revng_abort();
+        }
+      } break;
+      }
+    }
+  }
+
+  Result.Kind = FastMaterialization::Valid;
+  Result.Value = Current.getZExtValue();
+  return Result;
+}
+
+void OperationsStack::exploreAll(Type *Int64,
+                                 const std::vector<uint64_t> &Values) {
+  if (not isFastMaterializable()) {
+    for (uint64_t Value : Values)
+      explore(ConstantInt::get(Int64, Value));
+    return;
+  }
+
+  // Materialize the values, splitting them among the threads
+  std::vector<FastMaterialization> Results(Values.size());
+  auto Materialize = [this, &Values, &Results](size_t Begin, size_t End) {
+    for (size_t I = Begin; I < End; I++)
+      Results[I] = materializeFast(Values[I]);
+  };
+
+  size_t Threads = Values.size() >= MinParallelValues ? SETThreads + 1 : 1;
+  size_t ChunkSize = (Values.size() + Threads - 1) / Threads;
+  std::vector<std::thread> Workers;
+  for (size_t Begin = ChunkSize; Begin < Values.size(); Begin += ChunkSize) {
+    size_t End = std::min(Begin + ChunkSize, Values.size());
+    Workers.emplace_back(Materialize, Begin, End);
+  }
+  Materialize(0, std::min(ChunkSize, Values.size()));
+
+  for (std::thread &Worker : Workers)
+    Worker.join();
+
+  for (const FastMaterialization &Materialized : Results)
+    for (auto &Read : Materialized.Reads)
+      JTM->registerRead(Read.first, Read.second);
+
+  if (recordPCRange(Results))
+    return;
+
+  // Record the results in order, so that they do not depend on the number of
+  // threads
+  for (size_t I = 0; I < Values.size(); I++) {
+    const FastMaterialization &Materialized = Results[I];
+    switch (Materialized.Kind) {
+    case FastMaterialization::Valid:
+      record(Materialized.Value);
+      break;
+
+    case FastMaterialization::Unsupported:
+      explore(ConstantInt::get(Int64, Values[I]));
+      break;
+
+    case FastMaterialization::Invalid:
+      break;
+    }
+  }
+}
+
+bool OperationsStack::recordPCRange(ArrayRef<FastMaterialization> Results) {
+  // Syscall numbers have to be registered one by one
+  if (Target == nullptr or SetsSyscallNumber or Results.size() < 2)
+    return false;
+
+  for (const FastMaterialization &Result : Results)
+    if (Result.Kind != FastMaterialization::Valid)
+      return false;
+
+  // Check the values are strictly monotonic with a constant stride
+  uint64_t First = Results[0].Value;
+  uint64_t Second = Results[1].Value;
+  bool Ascending = Second > First;
+  uint64_t Stride = Ascending ? Second - First : First - Second;
+  for (size_t I = 1; I < Results.size(); I++) {
+    uint64_t Previous = Results[I - 1].Value;
+    uint64_t Current = Results[I].Value;
+    if (Ascending) {
+      if (Current <= Previous or Current - Previous != Stride)
+        return false;
+    } else {
+      if (Current >= Previous or Previous - Current != Stride)
+        return false;
+    }
+  }
+
+  uint64_t Base = Ascending ? First : Results.back().Value;
+  uint64_t Count = Results.size();
+  if (Base == 0 or not JTM->isPCRange(Base, Stride, Count))
+    return false;
+
+  // The ranges must not overlap, so that they can be registered in order
+  uint64_t Last = Base + Stride * (Count - 1);
+  auto Next = NewPCRanges.lower_bound(Base);
+  if (Next != NewPCRanges.end() and Next->first <= Last)
+    return false;
+  if (Next != NewPCRanges.begin()) {
+    const PCRange &Previous = std::prev(Next)->second;
+    if (Previous.Base + Previous.Stride * (Previous.Count - 1) >= Base)
+      return false;
+  }
+
+  NewPCRanges[Base] = { Base, Stride, Count, IsPCStore };
+
+  if (Tracking == PCsOnly)
+    for (const FastMaterialization &Result : Results)
+      TrackedValues.insert(Result.Value);
+
+  return true;
+}
+
 void OperationsStack::explore(Constant *NewOperand) {
   MaterializedValue SymbolicValue = materialize(NewOperand, true);
 
@@ -490,8 +925,10 @@ void OperationsStack::explore(Constant *NewOperand) {
     return;
   }
 
-  uint64_t Value = SymbolicValue.value();
+  record(SymbolicValue.value());
+}
 
+void OperationsStack::record(uint64_t Value) {
   bool IsStore = Target != nullptr;
   revng_assert(!(!IsStore && (Tracking == PCsOnly || SetsSyscallNumber)));
 
@@ -523,6 +960,7 @@ public:
       OSRAPass *OSRA,
       FunctionCallIdentification *FCI,
       std::set<BasicBlock *> *Visited,
+      SETCache *Cache,
       std::vector<SETPass::JumpInfo> &Jumps) :
     DL(F.getParent()->getDataLayout()),
     JTM(JTM),
@@ -530,6 +968,7 @@ public:
     F(F),
     OSRA(OSRA),
     Visited(Visited),
+    Cache(Cache),
     Jumps(Jumps) {}
 
   /// \brief Run the Simple Expression Tracker on F
@@ -560,6 +999,9 @@ private:
   Function &F;
   OSRAPass *OSRA;
   std::set<BasicBlock *> *Visited;
+  SETCache *Cache;
+  /// Basic blocks went through while exploring the current instruction
+  SmallSetVector<BasicBlock *, 8> Slice;
   std::vector<std::pair<Value *, unsigned>> WorkList;
   std::vector<SETPass::JumpInfo> &Jumps;
   std::map<GlobalVariable *, uint64_t> CanonicalValues;
@@ -589,6 +1031,7 @@ bool SET::enqueueStores(LoadInst *Start) {
     }
 
     Visited.insert(BB);
+    Slice.insert(BB);
     BasicBlock::reverse_iterator It(++I->getReverseIterator());
     BasicBlock::reverse_iterator Begin(BB->rend());
 
@@ -656,6 +1099,7 @@ bool SET::run() {
   collectMetadata();
 
   // Run the actual analysis
+  bool Stopped = false;
   for (BasicBlock &BB : make_range(F.begin(), F.end())) {
 
     if (Visited->find(&BB) != Visited->end())
@@ -678,7 +1122,24 @@ bool SET::run() {
                   || isa<AllocaInst>(Load->getPointerOperand()))))
         continue;
 
+      // Skip the instructions explored in a previous run, if nothing they
+      // depend on has changed
+      if (Cache != nullptr and Cache->isValid(&Instr))
+        continue;
+
+      // Once the SET + OSRA budget is exceeded, apply the fallback: proceed
+      // without OSRA or stop here
+      if (OSRA != nullptr and not JTM->pollOSRABudget()) {
+        OSRA = nullptr;
+        if (JTM->harvestStopped()) {
+          Stopped = true;
+          break;
+        }
+      }
+
       revng_assert(WorkList.empty());
+      Slice.clear();
+      Slice.insert(&BB);
       if (IsStore) {
         // Clean the OperationsStack and, if we're dealing with a store to the
         // PC, ask it to track all the possible values that the PC will assume.
@@ -704,14 +1165,31 @@ bool SET::run() {
         // Discard operations we no longer need
         OS.cut(Height);
 
-        while (V != nullptr)
+        while (V != nullptr) {
+          auto *I = dyn_cast<Instruction>(V);
+          if (I != nullptr and I->getParent() != nullptr)
+            Slice.insert(I->getParent());
           V = handleInstruction(&Instr, V);
+        }
       }
 
       if (IsPCStore && OS.hasTrackedValues()) {
         bool IsApproximate = OS.isApproximate();
         Jumps.emplace_back(Store, IsApproximate, OS.trackedValues());
       }
+
+      // The killer basic blocks are collected from scratch at each run, so
+      // the stores of syscall numbers have to be explored again
+      bool SetsSyscallNumber = IsStore
+                               and JTM->noReturn().setsSyscallNumber(Store);
+      if (Cache != nullptr and not SetsSyscallNumber)
+        Cache->record(&Instr, Slice.getArrayRef());
+    }
+
+    // BB has not been fully explored
+    if (Stopped) {
+      Visited->erase(&BB);
+      break;
     }
   }
 
@@ -723,6 +1201,37 @@ bool SET::run() {
 
 char SETPass::ID = 0;
 
+bool SETCache::isValid(Instruction *I) const {
+  auto It = Entries.find(I);
+  if (It == Entries.end())
+    return false;
+
+  unsigned EntryGeneration = It->second.Generation;
+  auto IsChanged = [this, EntryGeneration](BasicBlock *BB) {
+    auto ChangeIt = LastChange.find(BB);
+    return ChangeIt != LastChange.end() and ChangeIt->second >= EntryGeneration;
+  };
+
+  // New edges come from new or changed basic blocks, check the predecessors
+  // too
+  for (BasicBlock *BB : It->second.Blocks) {
+    if (IsChanged(BB))
+      return false;
+
+    for (BasicBlock *Predecessor : predecessors(BB))
+      if (IsChanged(Predecessor))
+        return false;
+  }
+
+  return true;
+}
+
+void SETCache::record(Instruction *I, ArrayRef<BasicBlock *> Blocks) {
+  Entry &Result = Entries[I];
+  Result.Generation = Generation;
+  Result.Blocks.assign(Blocks.begin(), Blocks.end());
+}
+
 void SETPass::getAnalysisUsage(AnalysisUsage &AU) const {
   if (UseOSRA) {
     AU.addRequired<OSRAPass>();
@@ -746,7 +1255,10 @@ bool SETPass::runOnModule(Module &M) {
 
   FunctionCallIdentification &FCI = getAnalysis<FunctionCallIdentification>();
 
-  SET SimpleExpressionTracker(F, JTM, OSRA, &FCI, Visited, Jumps);
+  if (Cache != nullptr)
+    Cache->startRun();
+
+  SET SimpleExpressionTracker(F, JTM, OSRA, &FCI, Visited, Cache, Jumps);
 
   revng_log(PassesLog, "Ending SETPass");
   return SimpleExpressionTracker.run();
@@ -808,9 +1320,10 @@ bool SET::handleInstructionWithOSRA(Instruction *Target, Value *V) {
 
     // Note: addition and comparison for equality are all sign-safe
     // operations, no need to use Constants in this case.
-    for (uint64_t Address : O->bounds(OS.topType())) {
-      OS.explore(CI::get(Int64, Address));
-    }
+    std::vector<uint64_t> Addresses;
+    for (uint64_t Address : O->bounds(OS.topType()))
+      Addresses.push_back(Address);
+    OS.exploreAll(Int64, Addresses);
   }
 
   return true;
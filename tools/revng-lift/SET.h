@@ -10,6 +10,9 @@
 #include <vector>
 
 // LLVM includes
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
 
 // Forward declarations
@@ -17,12 +20,56 @@ namespace llvm {
 class BasicBlock;
 class AnalysisUsage;
 class Function;
+class Instruction;
 class LoadInst;
 class Value;
 } // namespace llvm
 
 class JumpTargetManager;
 
+/// \brief Results of SET preserved across the harvesting rounds
+///
+/// For each explored load or store, SET records the basic blocks it went
+/// through while tracking the value. As long as none of them is invalidated,
+/// the results of the exploration, which have already been registered, are
+/// still valid and the instruction is not explored again.
+///
+/// Between two runs, the owner has to report through invalidate each basic
+/// block whose instructions have been changed, or that is about to be erased.
+class SETCache {
+public:
+  SETCache() : Generation(0) {}
+
+  void invalidate(llvm::BasicBlock *BB) { LastChange[BB] = Generation; }
+
+  /// \brief Discard all the results
+  void reset() {
+    Entries.clear();
+    LastChange.clear();
+  }
+
+  /// \brief Start a new run, later invalidations affect the results it records
+  void startRun() { Generation++; }
+
+  /// \brief Return true if the results of the exploration of \p I are valid
+  bool isValid(llvm::Instruction *I) const;
+
+  /// \brief Record the exploration of \p I, which went through \p Blocks
+  void record(llvm::Instruction *I, llvm::ArrayRef<llvm::BasicBlock *> Blocks);
+
+private:
+  struct Entry {
+    unsigned Generation;
+    llvm::SmallVector<llvm::BasicBlock *, 4> Blocks;
+  };
+
+private:
+  unsigned Generation;
+  llvm::DenseMap<llvm::Instruction *, Entry> Entries;
+  /// Generation in which each basic block has been invalidated last
+  llvm::DenseMap<llvm::BasicBlock *, unsigned> LastChange;
+};
+
 class SETPass : public llvm::ModulePass {
 public:
   /// \brief Information about the possible destination of a jump instruction
@@ -46,15 +93,21 @@ public:
     llvm::ModulePass(ID),
     JTM(nullptr),
     Visited(nullptr),
-    UseOSRA(false) {}
+    UseOSRA(false),
+    Cache(nullptr) {}
 
+  /// \param Cache if not `nullptr`, the loads and stores whose results in
+  ///        \p Cache are valid are not explored again, and the results of the
+  ///        others are recorded there.
   SETPass(JumpTargetManager *JTM,
           bool UseOSRA,
-          std::set<llvm::BasicBlock *> *Visited) :
+          std::set<llvm::BasicBlock *> *Visited,
+          SETCache *Cache = nullptr) :
     llvm::ModulePass(ID),
     JTM(JTM),
     Visited(Visited),
-    UseOSRA(UseOSRA) {}
+    UseOSRA(UseOSRA),
+    Cache(Cache) {}
 
   bool runOnModule(llvm::Module &M) override;
 
@@ -71,6 +124,7 @@ private:
   JumpTargetManager *JTM;
   std::set<llvm::BasicBlock *> *Visited;
   bool UseOSRA;
+  SETCache *Cache;
   std::vector<JumpInfo> Jumps;
 };
 
@@ -104,8 +104,9 @@ public:
   /// Returns true if the given variable is the env variable
   bool isEnv(llvm::Value *TheValue);
 
-  CPUStateAccessAnalysisPass *createCPUStateAccessAnalysisPass() {
-    return new CPUStateAccessAnalysisPass(this);
+  CPUStateAccessAnalysisPass *
+  createCPUStateAccessAnalysisPass(const CSVAccessSummaries *Summaries) {
+    return new CPUStateAccessAnalysisPass(this, Summaries);
   }
 
   llvm::Value *computeEnvAddress(llvm::Type *TargetType,